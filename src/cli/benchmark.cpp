@@ -0,0 +1,237 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <cli/self_test.hpp>
+#include <cli/text_io_handler.hpp>
+#include <gfx/gfx.hpp>
+#include <gfx/combine_image_simd.hpp>
+#include <data/set.hpp>
+#include <data/card.hpp>
+#include <data/symbol_font.hpp>
+#include <data/format/formats.hpp>
+#include <wx/stopwatch.h>
+#include <wx/mstream.h>
+#include <wx/filename.h>
+#include <wx/ffile.h>
+
+// ----------------------------------------------------------------------------- : combine_image
+
+// in combine_image.cpp
+void combine_bytes(Byte* a, const Byte* b, size_t size, ImageCombine combine, bool vectorized);
+size_t combine_bytes_avx2(Byte* a, const Byte* b, size_t size, ImageCombine combine);
+
+/// Throughput of the combining functions, with and without vector instructions
+static void bench_combine_image(const vector<String>& args) {
+  // a card sized image
+  size_t size = 375 * 523 * 3;
+  vector<Byte> a, b, work;
+  random_bytes(a, size, 1);
+  random_bytes(b, size, 2);
+  double megabytes = size / 1e6;
+  cli << _("MB/s per mode, ") << String::Format(_("%.1f"), megabytes) << _(" MB per run") << ENDL;
+  cli << _("mode                 scalar      SSE2      AVX2") << ENDL;
+  FOR_EACH_CONST(mode, combine_modes) {
+    double scalar = time_ms([&]{ work = a; combine_bytes(&work[0], &b[0], size, mode.first, false); });
+    double sse2 = 0, avx2 = 0;
+    #ifdef MSE_SIMD_SSE2
+      sse2 = time_ms([&]{ work = a; combine_bytes_simd<SimdSSE2>(&work[0], &b[0], size, mode.first); });
+      if (cpu_has_avx2()) {
+        avx2 = time_ms([&]{ work = a; combine_bytes_avx2(&work[0], &b[0], size, mode.first); });
+      }
+    #endif
+    cli << String::Format(_("%-18s %8.0f  %8.0f  %8.0f"), mode.second,
+                          megabytes * 1000 / scalar,
+                          sse2 ? megabytes * 1000 / sse2 : 0.,
+                          avx2 ? megabytes * 1000 / avx2 : 0.) << ENDL;
+  }
+  cli << _("(the times include copying the input, 0 = not available)") << ENDL;
+}
+
+// ----------------------------------------------------------------------------- : gaussian_blur
+
+/// Time and error of gaussian_blur for different radii, compared to convolving with the kernel
+static void bench_gaussian_blur(const vector<String>& args) {
+  long size = 1000;
+  if (!args.empty()) args[0].ToLong(&size);
+  int n = (int)size;
+  Image img = test_image(n, n, true, 3);
+  vector<Byte> input(img.GetAlpha(), img.GetAlpha() + n * n), fast, exact;
+  cli << String::Format(_("%dx%d bytes"), n, n) << ENDL;
+  cli << _("sigma      fast (ms)   kernel (ms)   max error") << ENDL;
+  double sigmas[] = {1, 5, 20, 50, 100};
+  FOR_EACH_CONST(sigma, sigmas) {
+    double t_fast  = time_ms([&]{ fast  = input; gaussian_blur(&fast[0], n, n, sigma, sigma, true); });
+    double t_exact = time_ms([&]{ exact = input; gaussian_blur_reference(&exact[0], n, n, sigma, sigma, true); }, 0);
+    int max_error = 0;
+    for (size_t i = 0 ; i < input.size() ; ++i) {
+      max_error = max(max_error, abs(fast[i] - exact[i]));
+    }
+    cli << String::Format(_("%5.0f %14.1f %13.1f %11d"), sigma, t_fast, t_exact, max_error) << ENDL;
+  }
+}
+
+// ----------------------------------------------------------------------------- : QOI
+
+/// Size and encoding/decoding time of QOI compared to PNG
+static void bench_qoi(const vector<String>& args) {
+  // card renders from sets, or image files
+  vector<pair<String,Image>> images;
+  FOR_EACH_CONST(arg, args) {
+    wxFileName fn(arg);
+    if (fn.GetExt() == _("mse-set") || fn.GetExt() == _("mse") || fn.GetExt() == _("set")) {
+      SetP set = import_set(arg);
+      CardExporter exporter(set);
+      for (size_t i = 0 ; i < set->cards.size() && i < 10 ; ++i) {
+        images.emplace_back(fn.GetName() + String::Format(_(" card %d"), (int)i), exporter.exportBitmap(set->cards[i]).ConvertToImage());
+      }
+    } else {
+      Image img;
+      if (img.LoadFile(arg)) images.emplace_back(fn.GetFullName(), img);
+    }
+  }
+  if (images.empty()) {
+    images.emplace_back(_("generated 375x523"), test_image(375, 523, false, 1));
+    images.emplace_back(_("generated 375x523 with alpha"), test_image(375, 523, true, 2));
+  }
+  cli << _("                          size (KB)      encode (ms)     decode (ms)") << ENDL;
+  cli << _("image                     PNG     QOI     PNG     QOI     PNG     QOI") << ENDL;
+  double totals[6] = {0};
+  FOR_EACH(image, images) {
+    Image& img = image.second;
+    // PNG
+    vector<Byte> png;
+    double png_encode = time_ms([&]{
+      wxMemoryOutputStream out;
+      img.SaveFile(out, wxBITMAP_TYPE_PNG);
+      png.resize(out.GetSize());
+      out.CopyTo(&png[0], png.size());
+    });
+    double png_decode = time_ms([&]{
+      wxMemoryInputStream in(&png[0], png.size());
+      Image decoded;
+      decoded.LoadFile(in, wxBITMAP_TYPE_PNG);
+    });
+    // QOI
+    vector<Byte> qoi;
+    double qoi_encode_ms = time_ms([&]{ qoi_encode(img, qoi); });
+    double qoi_decode_ms = time_ms([&]{
+      Image decoded;
+      qoi_decode(&qoi[0], qoi.size(), decoded);
+    });
+    double row[6] = {png.size() / 1024., qoi.size() / 1024., png_encode, qoi_encode_ms, png_decode, qoi_decode_ms};
+    cli << String::Format(_("%-22s %6.0f  %6.0f  %6.1f  %6.1f  %6.1f  %6.1f"), image.first.Left(22), row[0], row[1], row[2], row[3], row[4], row[5]) << ENDL;
+    cli.flush();
+    for (int i = 0 ; i < 6 ; ++i) totals[i] += row[i];
+  }
+  cli << String::Format(_("%-22s %6.0f  %6.0f  %6.1f  %6.1f  %6.1f  %6.1f"), _("total"), totals[0], totals[1], totals[2], totals[3], totals[4], totals[5]) << ENDL;
+}
+
+// ----------------------------------------------------------------------------- : Symbol fonts
+
+/// Splitting texts into symbols, the time per character should not grow with the length of the text
+static void bench_symbol_font(const vector<String>& args) {
+  if (args.empty()) throw Error(_("Specify a symbol font, for example magic-mana-small"));
+  SymbolFontP font = SymbolFont::byName(args[0]);
+  vector<String> texts;
+  if (args.size() >= 2) {
+    wxFFile file(args[1]);
+    String text;
+    if (!file.IsOpened() || !file.ReadAll(&text)) throw Error(_("Can't read ") + args[1]);
+    texts.push_back(text);
+  } else {
+    // characters that are common in symbol codes, and some that are not
+    String alphabet = _("0123456789XYZWUBRGCSTQE/ {}()+-");
+    vector<Byte> noise;
+    random_bytes(noise, 20000, 5);
+    String text;
+    FOR_EACH_CONST(b, noise) text += alphabet[b % alphabet.size()];
+    int lengths[] = {1000, 5000, 20000};
+    FOR_EACH_CONST(length, lengths) texts.push_back(text.substr(0, length));
+  }
+  cli << _("length   symbols   split (ms)   per character (us)") << ENDL;
+  FOR_EACH_CONST(text, texts) {
+    SymbolFont::SplitSymbols symbols;
+    double split_ms = time_ms([&]{
+      symbols.clear();
+      font->split(text, symbols);
+    });
+    cli << String::Format(_("%6d %9d %12.2f %20.3f"), (int)text.size(), (int)symbols.size(), split_ms, 1000 * split_ms / max((size_t)1, text.size())) << ENDL;
+    cli.flush();
+  }
+}
+
+// ----------------------------------------------------------------------------- : Card export
+
+/// Rendering cards for an export, with a new viewer for each card and with a CardExporter
+static void bench_export(const vector<String>& args) {
+  if (args.empty()) throw Error(_("Specify a set file"));
+  SetP set = import_set(args[0]);
+  if (set->cards.empty()) throw Error(_("The set has no cards"));
+  size_t count = args.size() >= 2 ? (size_t)wxAtoi(args[1]) : 1000;
+  // the cards of the set, repeated until there are enough
+  vector<CardP> cards;
+  while (cards.size() < count) {
+    cards.push_back(set->cards[cards.size() % set->cards.size()]);
+  }
+  cli << String::Format(_("Rendering %d cards"), (int)cards.size()) << ENDL;
+  cli.flush();
+  // a new viewer and bitmap for every card, as export_bitmap does
+  wxStopWatch timer;
+  FOR_EACH(card, cards) {
+    export_bitmap(set, card);
+  }
+  double separate = timer.TimeInMicro().ToDouble() / 1000;
+  cli << String::Format(_("  viewer per card:       %8.0f ms, %6.2f ms per card"), separate, separate / cards.size()) << ENDL;
+  cli.flush();
+  // one viewer and bitmap per stylesheet
+  timer.Start();
+  CardExporter exporter(set);
+  FOR_EACH(card, cards) {
+    exporter.exportBitmap(card);
+  }
+  double reused = timer.TimeInMicro().ToDouble() / 1000;
+  cli << String::Format(_("  viewer per stylesheet: %8.0f ms, %6.2f ms per card"), reused, reused / cards.size()) << ENDL;
+}
+
+// ----------------------------------------------------------------------------- : Running benchmarks
+
+struct Benchmark {
+  const Char* name;
+  const Char* args;
+  const Char* description;
+  void (*run)(const vector<String>& args);
+};
+
+static const Benchmark benchmarks[] = {
+  {_("combine_image"), _(""), _("Throughput of the combining modes"), bench_combine_image},
+  {_("gaussian_blur"), _("[SIZE]"), _("Time and error of the blur for drop shadows and text, on a SIZExSIZE array (default 1000)"), bench_gaussian_blur},
+  {_("qoi"), _("[SETFILE|IMAGE ...]"), _("Size and speed of QOI compared to PNG, on card renders, image files or generated images"), bench_qoi},
+  {_("symbol_font"), _("SYMBOLFONT [TEXTFILE]"), _("Time to split a text file, or generated texts of different lengths, into the symbols of a font"), bench_symbol_font},
+  {_("export"), _("SETFILE [COUNT]"), _("Time to render COUNT cards for an export (default 1000), with and without reusing the viewer"), bench_export},
+};
+
+bool run_benchmark(const vector<String>& args) {
+  FOR_EACH_CONST(bench, benchmarks) {
+    if (!args.empty() && args[0] == bench.name) {
+      bench.run(vector<String>(args.begin() + 1, args.end()));
+      cli.flush();
+      return true;
+    }
+  }
+  if (!args.empty()) {
+    cli << RED << _("Unknown benchmark: ") << NORMAL << args[0] << ENDL;
+  }
+  cli << _("Benchmarks:") << ENDL;
+  FOR_EACH_CONST(bench, benchmarks) {
+    cli << _("  ") << BRIGHT << bench.name << NORMAL << PARAM << _(" ") << bench.args << NORMAL << ENDL;
+    cli << _("         \t") << bench.description << ENDL;
+  }
+  cli.flush();
+  return args.empty();
+}
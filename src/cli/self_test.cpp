@@ -0,0 +1,708 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <cli/self_test.hpp>
+#include <cli/text_io_handler.hpp>
+#include <gfx/gfx.hpp>
+#include <gfx/combine_image_simd.hpp>
+#include <gfx/generated_image.hpp>
+#include <gfx/color.hpp>
+#include <data/symbol.hpp>
+#include <data/set.hpp>
+#include <data/game.hpp>
+#include <data/card.hpp>
+#include <data/field/text.hpp>
+#include <data/search_index.hpp>
+#include <data/action/value.hpp>
+#include <render/symbol/viewer.hpp>
+#include <util/error.hpp>
+#include <util/sorted_list.hpp>
+#include <wx/stopwatch.h>
+
+// ----------------------------------------------------------------------------- : Utilities
+
+bool check(bool ok, const String& what) {
+  if (!ok) cli << RED << _("  failed: ") << NORMAL << what << ENDL;
+  return ok;
+}
+
+bool check_same_bytes(const vector<Byte>& expected, const vector<Byte>& actual, size_t size, const String& what) {
+  for (size_t i = 0 ; i < size ; ++i) {
+    if (expected[i] != actual[i]) {
+      return check(false, String::Format(_("%s: byte %d is %d instead of %d"), what, (int)i, (int)actual[i], (int)expected[i]));
+    }
+  }
+  return true;
+}
+
+bool check_similar_images(const Image& expected, const Image& actual, int tolerance, const String& what) {
+  if (!check(expected.GetWidth() == actual.GetWidth() && expected.GetHeight() == actual.GetHeight(), what + _(": wrong size"))) return false;
+  if (!check(expected.HasAlpha() == actual.HasAlpha(), what + _(": alpha channel added or lost"))) return false;
+  size_t n = expected.GetWidth() * expected.GetHeight();
+  int max_diff = 0;
+  size_t differences = 0;
+  for (size_t i = 0 ; i < 3 * n ; ++i) {
+    int d = abs(expected.GetData()[i] - actual.GetData()[i]);
+    max_diff = max(max_diff, d);
+    differences += d > 0;
+  }
+  if (expected.HasAlpha()) {
+    for (size_t i = 0 ; i < n ; ++i) {
+      int d = abs(expected.GetAlpha()[i] - actual.GetAlpha()[i]);
+      max_diff = max(max_diff, d);
+      differences += d > 0;
+    }
+  }
+  return check(max_diff <= tolerance, String::Format(_("%s: %d components differ, by up to %d"), what, (int)differences, max_diff));
+}
+
+void random_bytes(vector<Byte>& out, size_t size, UInt seed) {
+  out.resize(size);
+  UInt x = seed * 2654435761u + 1;
+  for (size_t i = 0 ; i < size ; ++i) {
+    // xorshift
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    out[i] = Byte(x >> 24);
+  }
+}
+
+Image test_image(int width, int height, bool alpha, UInt seed) {
+  Image img(width, height, false);
+  vector<Byte> noise;
+  random_bytes(noise, width * height * 4, seed);
+  Byte* data = img.GetData();
+  if (alpha) img.InitAlpha();
+  for (int y = 0 ; y < height ; ++y) {
+    for (int x = 0 ; x < width ; ++x) {
+      int i = y * width + x;
+      bool flat  = y < height / 4;
+      bool noisy = y > height * 3 / 4;
+      data[3*i+0] = flat ? 40 : noisy ? noise[4*i+0] : Byte(x * 255 / max(1, width - 1));
+      data[3*i+1] = flat ? 80 : noisy ? noise[4*i+1] : Byte(y * 255 / max(1, height - 1));
+      data[3*i+2] = flat ? 120 : noisy ? noise[4*i+2] : Byte((x + y) / 2);
+      if (alpha) img.GetAlpha()[i] = x < width / 3 ? 255 : x < width * 2 / 3 ? noise[4*i+3] : 0;
+    }
+  }
+  return img;
+}
+
+double time_ms(const function<void()>& f, long min_ms) {
+  f(); // warm up caches
+  int runs = 0;
+  wxStopWatch timer;
+  do {
+    f();
+    runs++;
+  } while (timer.Time() < min_ms);
+  return timer.TimeInMicro().ToDouble() / 1000 / runs;
+}
+
+const vector<pair<ImageCombine,String>> combine_modes = {
+  {COMBINE_NORMAL,      _("normal")},
+  {COMBINE_ADD,         _("add")},
+  {COMBINE_SUBTRACT,    _("subtract")},
+  {COMBINE_STAMP,       _("stamp")},
+  {COMBINE_DIFFERENCE,  _("difference")},
+  {COMBINE_NEGATION,    _("negation")},
+  {COMBINE_MULTIPLY,    _("multiply")},
+  {COMBINE_DARKEN,      _("darken")},
+  {COMBINE_LIGHTEN,     _("lighten")},
+  {COMBINE_COLOR_DODGE, _("color dodge")},
+  {COMBINE_COLOR_BURN,  _("color burn")},
+  {COMBINE_SCREEN,      _("screen")},
+  {COMBINE_OVERLAY,     _("overlay")},
+  {COMBINE_HARD_LIGHT,  _("hard light")},
+  {COMBINE_SOFT_LIGHT,  _("soft light")},
+  {COMBINE_REFLECT,     _("reflect")},
+  {COMBINE_GLOW,        _("glow")},
+  {COMBINE_FREEZE,      _("freeze")},
+  {COMBINE_HEAT,        _("heat")},
+  {COMBINE_AND,         _("and")},
+  {COMBINE_OR,          _("or")},
+  {COMBINE_XOR,         _("xor")},
+  {COMBINE_SHADOW,      _("shadow")},
+  {COMBINE_SYMMETRIC_OVERLAY, _("symmetric overlay")},
+};
+
+// ----------------------------------------------------------------------------- : combine_image
+
+// in combine_image.cpp
+void combine_bytes(Byte* a, const Byte* b, size_t size, ImageCombine combine, bool vectorized);
+size_t combine_bytes_avx2(Byte* a, const Byte* b, size_t size, ImageCombine combine);
+
+/// The vectorized combining functions must give exactly the same results as the scalar ones
+static bool test_combine_image() {
+  // every pair of bytes, and a tail that is not a multiple of the vector size
+  size_t size = 256 * 256 + 13;
+  vector<Byte> a(size), b(size);
+  for (size_t i = 0 ; i < size ; ++i) {
+    a[i] = Byte(i >> 8);
+    b[i] = Byte(i);
+  }
+  bool ok = true;
+  FOR_EACH_CONST(mode, combine_modes) {
+    vector<Byte> expected = a;
+    combine_bytes(&expected[0], &b[0], size, mode.first, false);
+    // what combine_image uses
+    vector<Byte> actual = a;
+    combine_bytes(&actual[0], &b[0], size, mode.first, true);
+    ok &= check_same_bytes(expected, actual, size, mode.second);
+    #ifdef MSE_SIMD_SSE2
+      // each instruction set on its own
+      actual = a;
+      size_t done = combine_bytes_simd<SimdSSE2>(&actual[0], &b[0], size, mode.first);
+      ok &= check(done + SimdSSE2::size > size, mode.second + _(": SSE2 kernel missing"));
+      ok &= check_same_bytes(expected, actual, done, mode.second + _(" (SSE2)"));
+      if (cpu_has_avx2()) {
+        actual = a;
+        done = combine_bytes_avx2(&actual[0], &b[0], size, mode.first);
+        ok &= check(done + 32 > size, mode.second + _(": AVX2 kernel missing"));
+        ok &= check_same_bytes(expected, actual, done, mode.second + _(" (AVX2)"));
+      }
+    #endif
+  }
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : QOI
+
+/// Images must survive encoding and decoding unchanged, invalid data must be rejected
+static bool test_qoi() {
+  bool ok = true;
+  int sizes[][2] = {{1,1}, {7,3}, {64,64}, {257,13}, {375,523}};
+  FOR_EACH_CONST(size, sizes) {
+    for (int alpha = 0 ; alpha < 2 ; ++alpha) {
+      String what = String::Format(_("%dx%d%s"), size[0], size[1], alpha ? _(" with alpha") : _(""));
+      Image img = test_image(size[0], size[1], alpha, size[0] + size[1]);
+      vector<Byte> encoded;
+      qoi_encode(img, encoded);
+      ok &= check(qoi_is_image(&encoded[0], encoded.size()), what + _(": not recognized as QOI"));
+      Image decoded;
+      if (!check(qoi_decode(&encoded[0], encoded.size(), decoded), what + _(": can't be decoded"))) {
+        ok = false;
+        continue;
+      }
+      if (!check(decoded.GetWidth() == size[0] && decoded.GetHeight() == size[1], what + _(": wrong size"))) {
+        ok = false;
+        continue;
+      }
+      size_t n = size[0] * size[1];
+      ok &= check_same_bytes(vector<Byte>(img.GetData(), img.GetData() + 3 * n),
+                             vector<Byte>(decoded.GetData(), decoded.GetData() + 3 * n), 3 * n, what + _(" rgb"));
+      ok &= check((bool)alpha == decoded.HasAlpha(), what + _(": alpha channel added or lost"));
+      if (alpha && decoded.HasAlpha()) {
+        ok &= check_same_bytes(vector<Byte>(img.GetAlpha(), img.GetAlpha() + n),
+                               vector<Byte>(decoded.GetAlpha(), decoded.GetAlpha() + n), n, what + _(" alpha"));
+      }
+      // truncated data
+      if (n > 16) {
+        Image truncated;
+        ok &= check(!qoi_decode(&encoded[0], encoded.size() / 2, truncated), what + _(": truncated data is accepted"));
+      }
+    }
+  }
+  // not QOI
+  Byte png_magic[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+  ok &= check(!qoi_is_image(png_magic, sizeof(png_magic)), _("PNG data is recognized as QOI"));
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : gaussian_blur
+
+void gaussian_blur_reference(Byte* data, int width, int height, double sigma_x, double sigma_y, bool clamp_edges) {
+  // blur along one direction, from in to out, n lines of length values that are step apart
+  auto blur = [&](const vector<double>& in, vector<double>& out, int length, int lines, size_t step, size_t line_step, double sigma) {
+    int r = (int)ceil(4 * sigma);
+    vector<double> kernel(2 * r + 1);
+    double total = 0;
+    for (int k = -r ; k <= r ; ++k) {
+      total += kernel[k + r] = sigma > 0 ? exp(-k * k / (2 * sigma * sigma)) : 1;
+    }
+    for (int l = 0 ; l < lines ; ++l) {
+      for (int i = 0 ; i < length ; ++i) {
+        double sum = 0;
+        for (int k = -r ; k <= r ; ++k) {
+          int j = i + k;
+          if (j < 0 || j >= length) {
+            if (!clamp_edges) continue;
+            j = j < 0 ? 0 : length - 1;
+          }
+          sum += kernel[k + r] * in[l * line_step + j * step];
+        }
+        out[l * line_step + i * step] = sum / total;
+      }
+    }
+  };
+  size_t n = (size_t)width * height;
+  vector<double> a(data, data + n), b(n);
+  blur(a, b, width, height, 1, width, sigma_x);
+  blur(b, a, height, width, width, 1, sigma_y);
+  for (size_t i = 0 ; i < n ; ++i) {
+    data[i] = (Byte)min(255., max(0., a[i]) + 0.5);
+  }
+}
+
+/// The box filter approximation must be close to a real gaussian blur
+static bool test_gaussian_blur() {
+  bool ok = true;
+  double sigmas[][2] = {{1,1}, {2,2}, {5,5}, {15,15}, {40,40}, {3,20}, {0,8}};
+  FOR_EACH_CONST(sigma, sigmas) {
+    for (int clamp = 0 ; clamp < 2 ; ++clamp) {
+      String what = String::Format(_("sigma %gx%g%s"), sigma[0], sigma[1], clamp ? _(" clamped") : _(""));
+      // blur the alpha channel of a test image, it has sharp edges, noise and transparent areas
+      Image img = test_image(300, 200, true, 7);
+      Image expected(300, 200), actual(300, 200);
+      expected.InitAlpha();
+      actual.InitAlpha();
+      memcpy(expected.GetAlpha(), img.GetAlpha(), 300 * 200);
+      memcpy(actual.GetAlpha(), img.GetAlpha(), 300 * 200);
+      gaussian_blur_reference(expected.GetAlpha(), 300, 200, sigma[0], sigma[1], clamp);
+      gaussian_blur(actual.GetAlpha(), 300, 200, sigma[0], sigma[1], clamp);
+      ok &= check_similar_images(expected, actual, 5, what);
+    }
+  }
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : resample
+
+/// The resampling code before the weights were precomputed, to compare against
+/** Resample an image only in a single direction, either horizontally or vertically, see resample_pass in
+ *  the history of resample_image.cpp.
+ */
+static void resample_pass_reference(const Image& img_in, Image& img_out, int offset_in, int offset_out,
+                                    int length_in, int delta_in, int length_out, int delta_out,
+                                    int lines, int line_delta_in, int line_delta_out)
+{
+  const int shift = 32-10-8;
+  bool alpha = img_in.HasAlpha();
+  if (alpha && !img_out.HasAlpha()) img_out.InitAlpha();
+  int out_fact = (length_out << shift) / length_in;
+  int out_rest = (length_out << shift) % length_in;
+  for (int l = 0 ; l < lines ; ++l) {
+    Byte* in  = img_in .GetData() + 3 * (offset_in  + l * line_delta_in);
+    Byte* out = img_out.GetData() + 3 * (offset_out + l * line_delta_out);
+    Byte* in_a  = alpha ? img_in .GetAlpha() + (offset_in  + l * line_delta_in)  : nullptr;
+    Byte* out_a = alpha ? img_out.GetAlpha() + (offset_out + l * line_delta_out) : nullptr;
+    UInt in_rem = out_fact + out_rest;
+    for (int x = 0 ; x < length_out ; ++x) {
+      UInt out_rem = 1 << shift;
+      UInt totR = 0, totG = 0, totB = 0, totA = 0;
+      while (out_rem >= in_rem) {
+        UInt w = alpha ? in_rem * in_a[0] : in_rem;
+        totR += in[0] * w;
+        totG += in[1] * w;
+        totB += in[2] * w;
+        totA += w;
+        out_rem -= in_rem;
+        in_rem = out_fact;
+        in += 3*delta_in;
+        if (alpha) in_a += delta_in;
+      }
+      if (out_rem > 0) {
+        UInt w = alpha ? out_rem * in_a[0] : out_rem;
+        totR += in[0] * w;
+        totG += in[1] * w;
+        totB += in[2] * w;
+        totA += w;
+        in_rem -= out_rem;
+      }
+      if (!alpha) {
+        out[0] = totR >> shift;
+        out[1] = totG >> shift;
+        out[2] = totB >> shift;
+      } else if (totA) {
+        out[0] = totR / totA;
+        out[1] = totG / totA;
+        out[2] = totB / totA;
+        out_a[0] = totA >> shift;
+      } else {
+        out[0] = out[1] = out[2] = out_a[0] = 0;
+      }
+      out += 3*delta_out;
+      if (alpha) out_a += delta_out;
+    }
+  }
+}
+
+static Image resample_reference(const Image& img_in, const wxRect& rect, int width, int height) {
+  Image img_out(width, height, false);
+  int offset_in = rect.x + img_in.GetWidth() * rect.y;
+  if (height == rect.height) {
+    resample_pass_reference(img_in, img_out, offset_in, 0, rect.width, 1, width, 1, rect.height, img_in.GetWidth(), width);
+  } else {
+    Image img_temp(width, rect.height, false);
+    resample_pass_reference(img_in, img_temp, offset_in, 0, rect.width, 1, width, 1, rect.height, img_in.GetWidth(), width);
+    resample_pass_reference(img_temp, img_out, 0, 0, rect.height, width, height, width, width, 1, 1);
+  }
+  return img_out;
+}
+
+static Image resample_preserve_aspect_reference(const Image& img_in, int width, int height) {
+  int rheight = img_in.GetHeight() * width  / img_in.GetWidth();
+  int rwidth  = img_in.GetWidth()  * height / img_in.GetHeight();
+  if      (rheight < height) rwidth  = width;
+  else if (rwidth  < width)  rheight = height;
+  else                      {rwidth  = width; rheight = height;}
+  int dx = (width  - rwidth)  / 2;
+  int dy = (height - rheight) / 2;
+  Image img_out(width, height, false);
+  img_out.InitAlpha();
+  memset(img_out.GetAlpha(), 0, width * height);
+  Image img_temp(rwidth, img_in.GetHeight(), false);
+  img_temp.InitAlpha();
+  resample_pass_reference(img_in,   img_temp, 0, 0,                  img_in.GetWidth(),  1,      rwidth,  1,     img_in.GetHeight(), img_in.GetWidth(), rwidth);
+  resample_pass_reference(img_temp, img_out,  0, dx + width * dy,    img_in.GetHeight(), rwidth, rheight, width, rwidth,             1,                 1);
+  return img_out;
+}
+
+/// Resampled images must look exactly like they did before resampling was split over threads
+/** The sizes are large enough for parallel_for to use multiple threads */
+static bool test_resample() {
+  bool ok = true;
+  int sizes[][4] = { // in, out
+    {375,523, 375,523}, {375,523, 187,261}, {375,523, 750,1000}, {375,523, 100,523}, {375,523, 375,97},
+    {1,1, 13,7}, {640,480, 33,900}, {17,900, 900,17},
+  };
+  FOR_EACH_CONST(size, sizes) {
+    for (int alpha = 0 ; alpha < 2 ; ++alpha) {
+      String what = String::Format(_("%dx%d to %dx%d%s"), size[0], size[1], size[2], size[3], alpha ? _(" with alpha") : _(""));
+      Image in = test_image(size[0], size[1], alpha, size[2] + size[3]);
+      wxRect all(0, 0, size[0], size[1]);
+      if (size[0] != size[2] || size[1] != size[3]) {
+        ok &= check_similar_images(resample_reference(in, all, size[2], size[3]), resample(in, size[2], size[3]), 0, what);
+        ok &= check_similar_images(resample_preserve_aspect_reference(in, size[2], size[3]), resample_preserve_aspect(in, size[2], size[3]), 0, what + _(" preserving aspect"));
+      }
+      // a part of the image
+      wxRect clip(size[0] / 5, size[1] / 3, max(1, size[0] / 2), max(1, size[1] / 2));
+      Image clipped(size[2], size[3], false);
+      resample_and_clip(in, clipped, clip);
+      ok &= check_similar_images(resample_reference(in, clip, size[2], size[3]), clipped, 0, what + _(" clipped"));
+    }
+  }
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : Pointwise filters
+
+/// A generated image that is always the same image, to start a chain of filters with
+class FixedImage : public GeneratedImage {
+public:
+  FixedImage(const Image& image) : image(image) {}
+  Image generate(const Options&) const override { return image.Copy(); } // filters change the image in place
+  bool operator == (const GeneratedImage& that) const override { return this == &that; }
+  size_t hash() const override { return (size_t)this; }
+private:
+  Image image;
+};
+
+/// Fused chains of pointwise filters must give the same images as applying the filters one by one
+/** The images are large enough to be split into multiple blocks, and over multiple threads */
+static bool test_pointwise_filters() {
+  bool ok = true;
+  for (int kind = 0 ; kind < 3 ; ++kind) {
+    String what = kind == 0 ? _("opaque") : kind == 1 ? _("masked") : _("with alpha");
+    Image in = test_image(375, 523, kind == 2, 34);
+    if (kind == 1) in.SetMaskColour(40, 80, 120); // the flat part of the test image
+    GeneratedImageP base = make_intrusive<FixedImage>(in);
+    GeneratedImage::Options opt;
+    
+    // saturate, invert, recolor
+    Image expected = in.Copy();
+    saturate(expected, 0.5);
+    invert(expected);
+    recolor(expected, Color(200, 30, 90));
+    GeneratedImageP chain = make_intrusive<RecolorImage>(make_intrusive<InvertImage>(make_intrusive<SaturateImage>(base, 0.5)), Color(200, 30, 90));
+    ok &= check_similar_images(expected, chain->generate(opt), 0, what + _(": saturate, invert, recolor"));
+    
+    // set_alpha adds an alpha channel, recolor with custom colors, set_combine doesn't change any pixels
+    expected = in.Copy();
+    set_alpha(expected, 0.6);
+    recolor(expected, Color(255,0,0), Color(0,255,0), Color(0,0,255), Color(255,255,255));
+    saturate(expected, -0.3);
+    chain = make_intrusive<SaturateImage>(make_intrusive<SetCombineImage>(make_intrusive<RecolorImage2>(make_intrusive<SetAlphaImage>(base, 0.6),
+              Color(255,0,0), Color(0,255,0), Color(0,0,255), Color(255,255,255)), COMBINE_MULTIPLY), -0.3);
+    ok &= check_similar_images(expected, chain->generate(opt), 0, what + _(": set_alpha, recolor, set_combine, saturate"));
+    
+    // a filter that is not pointwise in the middle of the chain
+    expected = in.Copy();
+    set_alpha(expected, 0.25);
+    expected = flip_image_horizontal(expected);
+    invert(expected);
+    chain = make_intrusive<InvertImage>(make_intrusive<FlipImageHorizontal>(make_intrusive<SetAlphaImage>(base, 0.25)));
+    ok &= check_similar_images(expected, chain->generate(opt), 0, what + _(": set_alpha, flip, invert"));
+  }
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : Image views
+
+/// Cropping, flipping and rotating views must give the same images as copying the pixels each time
+static bool test_image_view() {
+  bool ok = true;
+  int sizes[][2] = {{1,1}, {7,3}, {64,64}, {257,13}, {375,523}};
+  FOR_EACH_CONST(size, sizes) {
+    for (int alpha = 0 ; alpha < 2 ; ++alpha) {
+      String what = String::Format(_("%dx%d%s"), size[0], size[1], alpha ? _(" with alpha") : _(""));
+      Image in = test_image(size[0], size[1], alpha, size[0] * size[1]);
+      ImageView view(in);
+      ok &= check_similar_images(in, view.toImage(), 0, what);
+      ok &= check_similar_images(flip_image_horizontal(in), view.flipHorizontal().toImage(), 0, what + _(" flipped horizontally"));
+      ok &= check_similar_images(flip_image_vertical(in),   view.flipVertical().toImage(),   0, what + _(" flipped vertically"));
+      ok &= check_similar_images(rotate_image(in, rad90),  view.rotate90().toImage(),  0, what + _(" rotated 90"));
+      ok &= check_similar_images(rotate_image(in, rad180), view.rotate180().toImage(), 0, what + _(" rotated 180"));
+      ok &= check_similar_images(rotate_image(in, rad270), view.rotate270().toImage(), 0, what + _(" rotated 270"));
+      // a part of the image
+      wxRect clip(size[0] / 5, size[1] / 3, max(1, size[0] / 2), max(1, size[1] / 2));
+      Image clipped = in.GetSubImage(clip);
+      ImageView crop = view.crop(clip.x, clip.y, clip.width, clip.height);
+      ok &= check_similar_images(clipped, crop.toImage(), 0, what + _(" cropped"));
+      // chains of views, the way nested crop_image, flip and rotate_image calls build them
+      ok &= check_similar_images(flip_image_horizontal(rotate_image(clipped, rad90)), crop.rotate90().flipHorizontal().toImage(), 0, what + _(" cropped, rotated 90, flipped"));
+      ok &= check_similar_images(rotate_image(flip_image_vertical(clipped), rad270), crop.flipVertical().rotate270().toImage(), 0, what + _(" cropped, flipped, rotated 270"));
+      Image rotated = rotate_image(in, rad90);
+      wxRect clip2(clip.y, clip.x, clip.height, clip.width);
+      ok &= check_similar_images(rotated.GetSubImage(clip2), view.rotate90().crop(clip2.x, clip2.y, clip2.width, clip2.height).toImage(), 0, what + _(" rotated 90, cropped"));
+    }
+  }
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : Symbols
+
+static SymbolShapeP square_part(double from, double to) {
+  auto square = make_intrusive<SymbolShape>();
+  square->points.push_back(make_intrusive<ControlPoint>(from, from));
+  square->points.push_back(make_intrusive<ControlPoint>(from, to));
+  square->points.push_back(make_intrusive<ControlPoint>(to,   to));
+  square->points.push_back(make_intrusive<ControlPoint>(to,   from));
+  return square;
+}
+
+/// Symbols with the different kinds of parts
+static SymbolP test_symbol(int which, String& name) {
+  auto symbol = make_intrusive<Symbol>();
+  if (which == 0) {
+    name = _("square");
+    symbol->parts.push_back(square_part(0.2, 0.8));
+  } else if (which == 1) {
+    name = _("square with a hole");
+    SymbolShapeP hole = square_part(0.35, 0.65);
+    hole->combine = SYMBOL_COMBINE_SUBTRACT;
+    symbol->parts.push_back(hole);
+    symbol->parts.push_back(square_part(0.2, 0.8));
+  } else if (which == 2) {
+    name = _("circle");
+    double k = 0.3 * 0.5523; // bezier approximation of a circle with radius 0.3
+    auto circle = make_intrusive<SymbolShape>();
+    circle->points.push_back(make_intrusive<ControlPoint>(0.5, 0.2, -k, 0, k, 0));
+    circle->points.push_back(make_intrusive<ControlPoint>(0.8, 0.5, 0, -k, 0, k));
+    circle->points.push_back(make_intrusive<ControlPoint>(0.5, 0.8, k, 0, -k, 0));
+    circle->points.push_back(make_intrusive<ControlPoint>(0.2, 0.5, 0, k, 0, -k));
+    symbol->parts.push_back(circle);
+  } else if (which == 3) {
+    name = _("overlapping squares");
+    SymbolShapeP top = square_part(0.4, 0.9);
+    top->combine = SYMBOL_COMBINE_OVERLAP;
+    symbol->parts.push_back(top);
+    symbol->parts.push_back(square_part(0.1, 0.6));
+  } else if (which == 4) {
+    name = _("intersecting squares");
+    SymbolShapeP top = square_part(0.35, 0.9);
+    top->combine = SYMBOL_COMBINE_INTERSECTION;
+    symbol->parts.push_back(top);
+    symbol->parts.push_back(square_part(0.1, 0.65));
+  } else {
+    name = _("rotation symmetry");
+    auto triangle = make_intrusive<SymbolShape>();
+    triangle->points.push_back(make_intrusive<ControlPoint>(0.45, 0.15));
+    triangle->points.push_back(make_intrusive<ControlPoint>(0.55, 0.15));
+    triangle->points.push_back(make_intrusive<ControlPoint>(0.5, 0.45));
+    auto symmetry = make_intrusive<SymbolSymmetry>();
+    symmetry->copies = 3;
+    symmetry->clip   = false;
+    symmetry->center = Vector2D(0.5, 0.5);
+    symmetry->handle = Vector2D(0, -0.2);
+    symmetry->parts.push_back(triangle);
+    symbol->parts.push_back(symmetry);
+  }
+  symbol->updateBounds();
+  return symbol;
+}
+
+/// Average difference of the color components of two images of the same size
+static double mean_difference(const Image& a, const Image& b) {
+  size_t n = 3 * a.GetWidth() * a.GetHeight();
+  double total = 0;
+  for (size_t i = 0 ; i < n ; ++i) {
+    total += abs(a.GetData()[i] - b.GetData()[i]);
+  }
+  return total / max((size_t)1, n);
+}
+
+/// How much of a pixel of an unfiltered symbol image is inside the symbol, the way filter_symbol sees it
+static double inside_fraction(const Byte* rgb) {
+  double border  = rgb[0] / 255.;
+  double outside = min(1 - border, max(0, rgb[1] - rgb[0]) / 128.);
+  return 1 - border - outside;
+}
+
+/// Symbols drawn by the rasterizer must look like the ones drawn on a DC
+/** The DC is not anti-aliased, so it draws at 4 times the size, and that is scaled down.
+ *  Edges differ a bit, and the DC uses other line joins, so the colors are only compared on average.
+ *  But in each pixel, also on the edges, the part that is inside the symbol must be about the same.
+ */
+static bool test_symbol_render() {
+  bool ok = true;
+  int sizes[] = {60, 200};
+  for (int which = 0 ; which < 6 ; ++which) {
+    String name;
+    SymbolP symbol = test_symbol(which, name);
+    FOR_EACH_CONST(size, sizes) {
+      Image actual    = render_symbol(symbol, 0.05, size, size);
+      Image reference = render_symbol_with_dc(symbol, 0.05, 4 * size, 4 * size);
+      reference = resample(reference, actual.GetWidth(), actual.GetHeight());
+      double diff = mean_difference(reference, actual);
+      ok &= check(diff <= 6, String::Format(_("%s at %d pixels: differs by %.2f on average"), name, size, diff));
+      // per pixel
+      int w = actual.GetWidth(), h = actual.GetHeight();
+      double worst = 0; int worst_x = 0, worst_y = 0;
+      for (int y = 0 ; y < h ; ++y) {
+        for (int x = 0 ; x < w ; ++x) {
+          size_t i = 3 * ((size_t)y * w + x);
+          double d = fabs(inside_fraction(actual.GetData() + i) - inside_fraction(reference.GetData() + i));
+          if (d > worst) { worst = d; worst_x = x; worst_y = y; }
+        }
+      }
+      ok &= check(worst <= 0.35, String::Format(_("%s at %d pixels: inside differs by %.2f at (%d,%d)"), name, size, worst, worst_x, worst_y));
+    }
+  }
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : Search index
+
+/// The cards found by a quick search, as indices in the set
+static vector<size_t> quick_search(const SetP& set, const String& query) {
+  vector<VoidP> found;
+  CardQuickFilter(set, query).getItems(set->cards, found);
+  vector<size_t> out;
+  FOR_EACH(item, found) {
+    out.push_back(find(set->cards.begin(), set->cards.end(), item) - set->cards.begin());
+  }
+  return out;
+}
+
+/// Quick searches must see changes to the notes, which are edited without a card in the action
+static bool test_search_index() {
+  bool ok = true;
+  auto game = make_intrusive<Game>();
+  auto field = make_intrusive<TextField>();
+  field->index = 0;
+  field->name  = _("name");
+  game->card_fields.push_back(field);
+  auto set = make_intrusive<Set>(game);
+  for (int i = 0 ; i < 20 ; ++i) {
+    auto card = make_intrusive<Card>(*game);
+    card->notes = String::Format(_("note number %d"), i);
+    set->cards.push_back(card);
+  }
+  ok &= check(quick_search(set, _("zebra")).empty(), _("no card has a zebra before editing"));
+  ok &= check(quick_search(set, _("number 7")) == vector<size_t>{7}, _("the notes are searched"));
+  // edit the notes the way the notes box of the cards panel does: through a fake value, without a card.
+  // The action is given to the index directly, the set has no stylesheet for running scripts.
+  CardP card = set->cards[7];
+  card->notes = _("a zebra crossing");
+  ValueAction edit(make_intrusive<FakeTextValue>(field, &card->notes, true, true));
+  set->searchIndex().onAction(edit, false);
+  ok &= check(quick_search(set, _("zebra")) == vector<size_t>{7}, _("the card is found by its new notes"));
+  ok &= check(quick_search(set, _("number 7")).empty(), _("the card is no longer found by its old notes"));
+  return ok;
+}
+
+// ----------------------------------------------------------------------------- : Sorted lists
+
+/// Moving single changed items must give the same list as filtering and sorting everything again
+static bool test_sorted_list() {
+  const int n = 200, steps = 500;
+  vector<Byte> random;
+  random_bytes(random, 3 * steps, 45);
+  vector<int> key(n);
+  vector<int> shown(n); // note: vector<bool> is evil
+  for (int i = 0 ; i < n ; ++i) {
+    key[i]   = i % 7;      // many equal keys
+    shown[i] = i % 3 != 0; // a filtered list
+  }
+  // like the card list: equal keys are ordered by position
+  auto before = [&key](int a, int b) { return key[a] != key[b] ? key[a] < key[b] : a < b; };
+  auto sort_all = [&key, &shown]() {
+    vector<int> list;
+    for (int i = 0 ; i < n ; ++i) {
+      if (shown[i]) list.push_back(i);
+    }
+    stable_sort(list.begin(), list.end(), [&key](int a, int b) { return key[a] < key[b]; });
+    return list;
+  };
+  vector<int> list = sort_all();
+  for (int step = 0 ; step < steps ; ++step) {
+    int item = random[3 * step] % n;
+    key[item]   = random[3 * step + 1] % 7;
+    shown[item] = random[3 * step + 2] % 4 != 0;
+    pair<long,long> pos = move_sorted_item(list, item, shown[item] != 0, before);
+    vector<int> expected = sort_all();
+    if (!check(list == expected, String::Format(_("step %d: moving item %d gives a different order than sorting"), step, item))) {
+      return false;
+    }
+    long expected_pos = shown[item] ? (long)(find(expected.begin(), expected.end(), item) - expected.begin()) : -1;
+    if (!check(pos.second == expected_pos, String::Format(_("step %d: wrong new position for item %d"), step, item))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------- : Running tests
+
+struct SelfTest {
+  const Char* name;
+  bool (*run)();
+};
+
+static const SelfTest self_tests[] = {
+  {_("combine_image"), test_combine_image},
+  {_("qoi"),           test_qoi},
+  {_("resample"),      test_resample},
+  {_("pointwise_filters"), test_pointwise_filters},
+  {_("image_view"),    test_image_view},
+  {_("gaussian_blur"), test_gaussian_blur},
+  {_("symbol_render"), test_symbol_render},
+  {_("search_index"),  test_search_index},
+  {_("sorted_list"),   test_sorted_list},
+};
+
+bool run_self_tests(const vector<String>& names) {
+  bool all_ok = true;
+  FOR_EACH_CONST(test, self_tests) {
+    if (!names.empty() && find(names.begin(), names.end(), String(test.name)) == names.end()) continue;
+    cli << _("test ") << BRIGHT << test.name << NORMAL << ENDL;
+    cli.flush();
+    bool ok = false;
+    try {
+      ok = test.run();
+    } catch (const Error& e) {
+      check(false, e.what());
+    }
+    cli << (ok ? _("  ok") : _("  FAILED")) << ENDL;
+    cli.flush();
+    all_ok &= ok;
+  }
+  return all_ok;
+}
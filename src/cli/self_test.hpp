@@ -0,0 +1,55 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/gfx.hpp>
+#include <functional>
+
+// ----------------------------------------------------------------------------- : Self tests
+
+/// Run the self tests: checks of optimized code against the straightforward implementations
+/** If names is not empty, only the tests with those names are run.
+ *  Returns false if any of the tests fails.
+ */
+bool run_self_tests(const vector<String>& names);
+
+// ----------------------------------------------------------------------------- : Benchmarks
+
+/// Run a benchmark, and print the timings
+/** args[0] is the name of the benchmark, the remaining arguments are passed to it.
+ *  Without arguments the available benchmarks are listed.
+ *  Returns false if the benchmark doesn't exist or can't be run.
+ */
+bool run_benchmark(const vector<String>& args);
+
+// ----------------------------------------------------------------------------- : Utilities
+
+/// Report a failure if !ok, returns ok
+bool check(bool ok, const String& what);
+/// Check that the first size bytes of two buffers are the same, reports the first difference
+bool check_same_bytes(const vector<Byte>& expected, const vector<Byte>& actual, size_t size, const String& what);
+/// Check that two images have the same size and alpha channel, and no component differs by more than tolerance
+/** Reports the largest difference and the number of differing components */
+bool check_similar_images(const Image& expected, const Image& actual, int tolerance, const String& what);
+/// Fill a buffer with pseudo random bytes, the same ones for the same seed
+void random_bytes(vector<Byte>& out, size_t size, UInt seed);
+
+/// An image with pseudo random contents: smooth gradients, flat areas and noise, like a card
+Image test_image(int width, int height, bool alpha, UInt seed);
+
+/// Time a function, returns the average time of a call in milliseconds
+/** The function is called repeatedly, for at least min_ms milliseconds in total */
+double time_ms(const function<void()>& f, long min_ms = 200);
+
+/// A gaussian blur computed the slow way, by convolving with the kernel, to compare gaussian_blur with
+void gaussian_blur_reference(Byte* data, int width, int height, double sigma_x, double sigma_y, bool clamp_edges);
+
+/// All combining modes, with their names
+extern const vector<pair<ImageCombine,String>> combine_modes;
@@ -111,7 +111,7 @@ unique_ptr<ValueAction> value_action(const MultipleChoiceValueP& value, const De
 
 TextValueAction::TextValueAction(const TextValueP& value, size_t start, size_t end, size_t new_end, const Defaultable<String>& new_value, const String& name)
   : ValueAction(value)
-  , selection_start(start), selection_end(end), new_selection_end(new_end)
+  , selection_start(start), selection_end(end), delay_dependents(false), new_selection_end(new_end)
   , new_value(new_value)
   , name(name)
 {}
@@ -247,6 +247,14 @@ void ScriptValueEvent::perform(bool) {
   assert(false); // this action is just an event, it should not be performed
 }
 
+String DelayedScriptsEvent::getName(bool) const {
+  assert(false); // this action is just an event, getName shouldn't be called
+  throw InternalError(_("DelayedScriptsEvent::getName"));
+}
+void DelayedScriptsEvent::perform(bool) {
+  assert(false); // this action is just an event, it should not be performed
+}
+
 
 String ScriptStyleEvent::getName(bool) const {
   assert(false); // this action is just an event, getName shouldn't be called
@@ -76,6 +76,8 @@ public:
   
   /// The modified selection
   size_t selection_start, selection_end;
+  /// Can updating scripts that depend on this value wait until the user stops typing?
+  bool delay_dependents;
 private:
   inline TextValue& value() const;
   
@@ -144,6 +146,16 @@ public:
   const Value* value; ///< The modified value
 };
 
+/// Notification that scripts depending on typed text have been updated
+/** These updates are done some time after the typing, views that show the results of such scripts
+ *  may need to be refreshed.
+ */
+class DelayedScriptsEvent : public Action {
+public:
+  String getName(bool to_undo) const override;
+  void perform(bool to_undo) override;
+};
+
 /// Notification that a script caused a style to change
 class ScriptStyleEvent : public Action {
 public:
@@ -18,6 +18,7 @@ DECLARE_POINTER_TYPE(Field);
 DECLARE_POINTER_TYPE(Style);
 DECLARE_POINTER_TYPE(ExportTemplate);
 DECLARE_POINTER_TYPE(Package);
+DECLARE_SHARED_POINTER_TYPE(CardExporter);
 
 // ----------------------------------------------------------------------------- : ExportTemplate
 
@@ -56,6 +57,7 @@ struct ExportInfo {
                                          ///  This is just the directory name
   String             directory_absolute; ///< The absolute path of the directory
   map<String,wxSize> exported_images;     ///< Images (from symbol font) already exported, and their size
+  CardExporterP      card_exporter;       ///< For rendering card images, created when needed
   bool               allow_writes_outside; ///< Can files outside the directory be written to?
 };
 
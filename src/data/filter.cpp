@@ -39,4 +39,23 @@ vector<QuickFilterPart> parse_quicksearch_query(String const& query) {
     parts.push_back(part);
   }
   return parts;
-}
\ No newline at end of file
+}
+
+bool quicksearch_query_refines(vector<QuickFilterPart> const& query, vector<QuickFilterPart> const& previous) {
+  for (auto const& prev : previous) {
+    bool implied = false;
+    for (auto const& part : query) {
+      if (part.need_match != prev.need_match) continue;
+      if (part.need_match) {
+        // a longer query and type only match less
+        implied = find_i(part.type, prev.type) != String::npos && find_i(part.query, prev.query) != String::npos;
+      } else {
+        // excluding a shorter query or type excludes more
+        implied = find_i(prev.type, part.type) != String::npos && find_i(prev.query, part.query) != String::npos;
+      }
+      if (implied) break;
+    }
+    if (!implied) return false;
+  }
+  return true;
+}
@@ -23,6 +23,12 @@ public:
   virtual bool keep(T const& x) const {
     return false;
   }
+  /// Does getItems() select exactly the objects for which keep() is true, in order?
+  /** If so, an object that has changed can be tested on its own.
+   *  Filters that override getItems() can only say so if they are known to qualify. */
+  virtual bool selectsWithKeep() const {
+    return false;
+  }
   /// Select objects from a list
   virtual void getItems(vector<TP> const& in, vector<VoidP>& out) const {
     for (typename vector<TP>::const_iterator it = in.begin() ; it != in.end() ; ++it) {
@@ -50,6 +56,11 @@ struct QuickFilterPart : QuickFilterQuery  {
 /// Parse a quick filter string
 vector<QuickFilterPart> parse_quicksearch_query(String const& query);
 
+/// Does everything that matches query also match previous?
+/** True when every part of previous is implied by some part of query,
+ *  for example when query was made by typing more characters after previous. */
+bool quicksearch_query_refines(vector<QuickFilterPart> const& query, vector<QuickFilterPart> const& previous);
+
 /// Does the given object match the quick search query?
 template <typename T>
 bool match_quicksearch_query(vector<QuickFilterPart> const& query, T const& object) {
@@ -67,7 +78,10 @@ public:
   bool keep(T const& x) const override {
     return match_quicksearch_query(query, x);
   }
-private:
+  bool selectsWithKeep() const override {
+    return true;
+  }
+protected:
   vector<QuickFilterPart> query;
 };
 
@@ -15,6 +15,7 @@
 class Game;
 DECLARE_POINTER_TYPE(Set);
 DECLARE_POINTER_TYPE(Card);
+DECLARE_POINTER_TYPE(StyleSheet);
 
 // ----------------------------------------------------------------------------- : FileFormat
 
@@ -92,15 +93,49 @@ FileFormatP mtg_editor_file_format();
 void export_images(Window* parent, const SetP& set);
 
 /// Export the image for each card in a list of cards
+/** The images are encoded and written to files by 'jobs' threads, jobs <= 0 means one thread per cpu.
+ *  Meanwhile the main thread renders the next cards.
+ */
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts);
+                   const String& path, const String& filename_template, FilenameConflicts conflicts, int jobs = 1);
 
 /// Export the image of a single card
 void export_image(const SetP& set, const CardP& card, const String& filename);
 
+/// Set the options for writing an exported image file, such as the PNG compression level
+void set_export_image_options(Image& img);
+
 /// Generate a bitmap image of a card
 Bitmap export_bitmap(const SetP& set, const CardP& card);
 
+class UnzoomedDataViewer;
+
+/// Generates images of many cards from a set
+/** Keeps a viewer and a bitmap for each stylesheet, so for cards with the same stylesheet
+ *  the value viewers and the images cached in the styles are reused.
+ */
+class CardExporter {
+public:
+  CardExporter(const SetP& set);
+  ~CardExporter();
+  
+  /// Generate a bitmap image of a card
+  /** The bitmap is drawn over when exporting the next card with the same stylesheet,
+   *  so it should be converted or copied before that.
+   */
+  const Bitmap& exportBitmap(const CardP& card);
+  
+  inline const SetP& getSet() const { return set; }
+  
+private:
+  SetP set;
+  struct Target {
+    unique_ptr<UnzoomedDataViewer> viewer;
+    Bitmap bitmap;
+  };
+  map<StyleSheetP,Target> targets;
+};
+
 /// Export a set to Magic Workstation format
 void export_mws(Window* parent, const SetP& set);
 
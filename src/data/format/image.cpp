@@ -15,21 +15,42 @@
 #include <data/settings.hpp>
 #include <render/card/viewer.hpp>
 #include <wx/filename.h>
+#include <wx/thread.h>
+#include <deque>
 
 // ----------------------------------------------------------------------------- : Single card export
 
 void export_image(const SetP& set, const CardP& card, const String& filename) {
   Image img = export_bitmap(set, card).ConvertToImage();
+  set_export_image_options(img);
   img.SaveFile(filename);  // can't use Bitmap::saveFile, it wants to know the file type
               // but image.saveFile determines it automagicly
 }
 
+void set_export_image_options(Image& img) {
+  if (settings.images_export_png_compression >= 0) {
+    img.SetOption(wxIMAGE_OPTION_PNG_COMPRESSION_LEVEL, min(9, settings.images_export_png_compression));
+  }
+  // the PNG_FILTER_* flags from png.h
+  switch (settings.images_export_png_filter) {
+    case PNG_FILTERS_DEFAULT: break;
+    case PNG_FILTERS_NONE:    img.SetOption(wxIMAGE_OPTION_PNG_FILTER, 0x08); break;
+    case PNG_FILTERS_SUB:     img.SetOption(wxIMAGE_OPTION_PNG_FILTER, 0x10); break;
+    case PNG_FILTERS_UP:      img.SetOption(wxIMAGE_OPTION_PNG_FILTER, 0x20); break;
+    case PNG_FILTERS_AVERAGE: img.SetOption(wxIMAGE_OPTION_PNG_FILTER, 0x40); break;
+    case PNG_FILTERS_PAETH:   img.SetOption(wxIMAGE_OPTION_PNG_FILTER, 0x80); break;
+    case PNG_FILTERS_ALL:     img.SetOption(wxIMAGE_OPTION_PNG_FILTER, 0xF8); break;
+  }
+}
+
 class UnzoomedDataViewer : public DataViewer {
 public:
   UnzoomedDataViewer(bool use_zoom_settings)
     : use_zoom_settings(use_zoom_settings)
   {}
   Rotation getRotation() const override;
+  // exports draw the whole card on a bitmap of its own
+  bool useCompositingSurface() const override { return true; }
 private:
   bool use_zoom_settings;
   double zoom  = 1.0;
@@ -45,29 +66,188 @@ Rotation UnzoomedDataViewer::getRotation() const {
 }
 
 Bitmap export_bitmap(const SetP& set, const CardP& card) {
+  // the exporter is thrown away, so the bitmap is not shared with anything else
+  CardExporter exporter(set);
+  return exporter.exportBitmap(card);
+}
+
+// ----------------------------------------------------------------------------- : CardExporter
+
+CardExporter::CardExporter(const SetP& set)
+  : set(set)
+{
   if (!set) throw Error(_("no set"));
+}
+CardExporter::~CardExporter() {}
+
+const Bitmap& CardExporter::exportBitmap(const CardP& card) {
+  StyleSheetP stylesheet = set->stylesheetForP(card);
+  Target& target = targets[stylesheet];
   // create viewer
-  UnzoomedDataViewer viewer(!settings.stylesheetSettingsFor(set->stylesheetFor(card)).card_normal_export());
-  viewer.setSet(set);
+  if (!target.viewer) {
+    target.viewer = make_unique<UnzoomedDataViewer>(!settings.stylesheetSettingsFor(*stylesheet).card_normal_export());
+    target.viewer->setSet(set);
+  }
+  // with the same stylesheet the value viewers are kept, only the values are swapped
+  UnzoomedDataViewer& viewer = *target.viewer;
   viewer.setCard(card);
   // size of cards
   RealSize size = viewer.getRotation().getExternalSize();
   // create bitmap & dc
-  Bitmap bitmap((int) size.width, (int) size.height);
-  if (!bitmap.Ok()) throw InternalError(_("Unable to create bitmap"));
+  if (!target.bitmap.Ok() || target.bitmap.GetWidth() != (int) size.width || target.bitmap.GetHeight() != (int) size.height) {
+    target.bitmap = Bitmap((int) size.width, (int) size.height);
+    if (!target.bitmap.Ok()) throw InternalError(_("Unable to create bitmap"));
+  }
   wxMemoryDC dc;
-  dc.SelectObject(bitmap);
-  // draw
+  dc.SelectObject(target.bitmap);
+  // draw, this clears the bitmap first
   viewer.draw(dc);
   dc.SelectObject(wxNullBitmap);
-  return bitmap;
+  return target.bitmap;
 }
 
 // ----------------------------------------------------------------------------- : Multiple card export
 
+/// Number of threads to use for an export, jobs <= 0 means one per cpu
+int export_jobs(int jobs) {
+  if (jobs <= 0) jobs = wxThread::GetCPUCount();
+  return max(1, jobs);
+}
+
+/// Queue of rendered card images, that are encoded and written to files by worker threads
+/** Rendering stays on the main thread: styles are shared by all cards using a stylesheet,
+ *  and not all platforms can draw to a DC from another thread.
+ *  Encoding and writing an image doesn't touch any shared state, so that is what the workers do,
+ *  while the main thread renders the next card.
+ *
+ *  At most max_queued images wait for a worker, add() blocks when the queue is full.
+ *  This bounds the memory used by images that are rendered but not yet written.
+ */
+class ExportImageQueue {
+public:
+  ExportImageQueue(int jobs, size_t max_queued);
+  /// Waits until all images are written
+  ~ExportImageQueue();
+  
+  /// Write an image to a file, takes over the image
+  void add(Image& image, const String& filename);
+  /// Wait until all images are written, throws an error if some of them could not be written
+  void finish();
+  
+private:
+  class Worker;
+  wxMutex     mutex;
+  wxCondition available; ///< Signaled when an image is added, or when we are finished
+  wxCondition space;     ///< Signaled when a worker takes an image from the queue
+  deque<pair<Image,String>> todo; ///< Images that still have to be written
+  size_t max_queued;
+  bool finished;
+  vector<unique_ptr<Worker>> workers;
+  vector<String> failed; ///< Files that could not be written
+  
+  /// Let the workers finish and wait for them
+  void stop();
+  /// Write an image, remembers the file name if that fails. Can be called from any thread
+  void save(Image& image, const String& filename);
+};
+
+class ExportImageQueue::Worker : public wxThread {
+public:
+  Worker(ExportImageQueue& queue)
+    : wxThread(wxTHREAD_JOINABLE), queue(queue)
+  {}
+  ExitCode Entry() override;
+private:
+  ExportImageQueue& queue;
+};
+
+wxThread::ExitCode ExportImageQueue::Worker::Entry() {
+  while (true) {
+    pair<Image,String> job;
+    {
+      wxMutexLocker lock(queue.mutex);
+      while (queue.todo.empty() && !queue.finished) {
+        queue.available.Wait();
+      }
+      if (queue.todo.empty()) return 0; // finished
+      job = queue.todo.front();
+      queue.todo.pop_front();
+      queue.space.Signal();
+    }
+    queue.save(job.first, job.second);
+  }
+}
+
+ExportImageQueue::ExportImageQueue(int jobs, size_t max_queued)
+  : available(mutex)
+  , space(mutex)
+  , max_queued(max(max_queued, (size_t)1))
+  , finished(false)
+{
+  for (int i = 0 ; i < jobs ; ++i) {
+    auto worker = make_unique<Worker>(*this);
+    if (worker->Create() != wxTHREAD_NO_ERROR || worker->Run() != wxTHREAD_NO_ERROR) break;
+    workers.push_back(move(worker));
+  }
+}
+
+ExportImageQueue::~ExportImageQueue() {
+  stop();
+}
+
+void ExportImageQueue::stop() {
+  {
+    wxMutexLocker lock(mutex);
+    finished = true;
+    available.Broadcast();
+  }
+  FOR_EACH(worker, workers) {
+    worker->Wait();
+  }
+  workers.clear();
+}
+
+void ExportImageQueue::finish() {
+  stop();
+  if (failed.empty()) return;
+  String message = _ERROR_("unable to store file");
+  FOR_EACH(filename, failed) {
+    message += _("\n  ") + filename;
+  }
+  throw Error(message);
+}
+
+void ExportImageQueue::save(Image& image, const String& filename) {
+  bool ok;
+  {
+    wxLogNull no_log; // the failures are reported together by finish()
+    ok = image.SaveFile(filename);
+  }
+  if (!ok) {
+    wxMutexLocker lock(mutex);
+    failed.push_back(filename);
+  }
+}
+
+void ExportImageQueue::add(Image& image, const String& filename) {
+  set_export_image_options(image);
+  if (workers.empty()) {
+    // no threads, write from the main thread
+    save(image, filename);
+    return;
+  }
+  wxMutexLocker lock(mutex);
+  while (todo.size() >= max_queued) {
+    space.Wait();
+  }
+  todo.push_back(make_pair(image, filename));
+  // wxImage reference counts are not thread safe, so the worker must get the only reference
+  image.Destroy();
+  available.Signal();
+}
 
 void export_images(const SetP& set, const vector<CardP>& cards,
-                   const String& path, const String& filename_template, FilenameConflicts conflicts)
+                   const String& path, const String& filename_template, FilenameConflicts conflicts, int jobs)
 {
   wxBusyCursor busy;
   // Script
@@ -75,7 +255,11 @@ void export_images(const SetP& set, const vector<CardP>& cards,
   // Path
   wxFileName fn(path);
   // Export
-  std::set<String> used; // for CONFLICT_NUMBER_OVERWRITE
+  CardExporter exporter(set);
+  // two images per worker is enough to keep every worker busy
+  int workers = export_jobs(jobs);
+  ExportImageQueue queue(workers, 2 * workers);
+  std::set<String> used; // files we are going to write, conflicts are resolved in the order of the cards
   FOR_EACH_CONST(card, cards) {
     // filename for this card
     Context& ctx = set->getContext(card);
@@ -88,6 +272,8 @@ void export_images(const SetP& set, const vector<CardP>& cards,
     // write image
     filename = fn.GetFullPath();
     used.insert(filename);
-    export_image(set, card, filename);
+    Image img = exporter.exportBitmap(card).ConvertToImage();
+    queue.add(img, filename);
   }
+  queue.finish();
 }
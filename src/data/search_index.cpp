@@ -0,0 +1,302 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <data/search_index.hpp>
+#include <data/set.hpp>
+#include <data/game.hpp>
+#include <data/field.hpp>
+#include <data/field/text.hpp>
+#include <data/action/set.hpp>
+#include <data/action/value.hpp>
+
+// ----------------------------------------------------------------------------- : Trigrams
+
+/// Hash of three lower case characters
+static inline UInt trigram_hash(Char a, Char b, Char c) {
+  return ((UInt(a) * 0x01000193u) ^ UInt(b)) * 0x01000193u ^ UInt(c);
+}
+
+/// The distinct trigrams in a string, ignoring case, sorted
+/** Uses the same case folding as find_i, so a string that contains the query contains all its trigrams */
+static void get_trigrams(const String& text, vector<UInt>& out) {
+  out.clear();
+  if (text.size() < 3) return;
+  out.reserve(text.size() - 2);
+  String::const_iterator it = text.begin();
+  Char a = toLower(*it++);
+  Char b = toLower(*it++);
+  for ( ; it != text.end() ; ++it) {
+    Char c = toLower(*it);
+    out.push_back(trigram_hash(a, b, c));
+    a = b;
+    b = c;
+  }
+  sort(out.begin(), out.end());
+  out.erase(unique(out.begin(), out.end()), out.end());
+}
+
+// ----------------------------------------------------------------------------- : CardSearchIndex
+
+CardSearchIndex::CardSearchIndex(Set& set)
+  : set(set)
+  , field_count(0)
+  , built(false)
+  , cards_changed(false)
+  , version(0)
+  , last_version(0)
+{
+  set.actions.addListener(this);
+}
+
+CardSearchIndex::~CardSearchIndex() {
+  set.actions.removeListener(this);
+}
+
+void CardSearchIndex::onAction(const Action& action, bool undone) {
+  ++version;
+  if (!built) return; // everything is indexed when building
+  TYPE_CASE_(action, AddCardAction) {
+    cards_changed = true;
+    return;
+  }
+  TYPE_CASE(action, ScriptValueEvent) {
+    if (action.card) addChangedCard(action.card);
+    return;
+  }
+  TYPE_CASE(action, ValueAction) {
+    if (action.card) {
+      addChangedCard(action.card.get());
+    } else if (const Card* card = cardWithNotes(*action.valueP)) {
+      // the notes box edits a fake value, its actions don't know the card
+      addChangedCard(card);
+    }
+  }
+}
+
+const Card* CardSearchIndex::cardWithNotes(const Value& value) const {
+  const FakeTextValue* fake = dynamic_cast<const FakeTextValue*>(&value);
+  if (!fake || !fake->underlying) return nullptr;
+  FOR_EACH_CONST(card, set.cards) {
+    if (&card->notes == fake->underlying) return card.get();
+  }
+  return nullptr;
+}
+
+void CardSearchIndex::addChangedCard(const Card* card) {
+  if (!changed_cards.empty() && changed_cards.back() == card) return;
+  changed_cards.push_back(card);
+  if (changed_cards.size() > 2 * set.cards.size() + 16) {
+    // don't grow without bound when there are no searches
+    sort(changed_cards.begin(), changed_cards.end());
+    changed_cards.erase(unique(changed_cards.begin(), changed_cards.end()), changed_cards.end());
+  }
+}
+
+void CardSearchIndex::update() {
+  if (!built) {
+    field_count = set.game->card_fields.size() + 1;
+  }
+  if (!built || cards_changed) {
+    // remove cards that are no longer in the set, add new ones
+    unordered_map<const Card*,bool> in_set;
+    FOR_EACH(card, set.cards) in_set[card.get()] = true;
+    for (UInt slot = 0 ; slot < slots.size() ; ++slot) {
+      if (slots[slot].card && !in_set.count(slots[slot].card.get())) {
+        removeCard(slot);
+      }
+    }
+    FOR_EACH(card, set.cards) {
+      if (slot_of.count(card.get())) continue;
+      UInt slot;
+      if (free_slots.empty()) {
+        slot = (UInt)slots.size();
+        slots.push_back(Slot());
+      } else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+      }
+      slots[slot].card = card;
+      slots[slot].trigrams.resize(field_count);
+      slot_of[card.get()] = slot;
+      indexCard(slot);
+    }
+    built = true;
+    cards_changed = false;
+  }
+  // re-index changed cards
+  sort(changed_cards.begin(), changed_cards.end());
+  changed_cards.erase(unique(changed_cards.begin(), changed_cards.end()), changed_cards.end());
+  FOR_EACH(card, changed_cards) {
+    auto it = slot_of.find(card);
+    if (it != slot_of.end()) indexCard(it->second);
+  }
+  changed_cards.clear();
+}
+
+void CardSearchIndex::indexCard(UInt slot) {
+  Slot& s = slots[slot];
+  vector<UInt> new_trigrams, added, removed;
+  for (size_t field = 0 ; field < field_count ; ++field) {
+    // the same values as Card::contains
+    if (field + 1 < field_count) {
+      ValueP value = field < s.card->data.size() ? s.card->data.at(field) : ValueP();
+      get_trigrams(value ? value->toString() : String(), new_trigrams);
+    } else {
+      get_trigrams(s.card->notes, new_trigrams);
+    }
+    vector<UInt>& old_trigrams = s.trigrams[field];
+    if (new_trigrams == old_trigrams) continue;
+    // update only the postings of trigrams that changed
+    added.clear();
+    removed.clear();
+    set_difference(new_trigrams.begin(), new_trigrams.end(), old_trigrams.begin(), old_trigrams.end(), back_inserter(added));
+    set_difference(old_trigrams.begin(), old_trigrams.end(), new_trigrams.begin(), new_trigrams.end(), back_inserter(removed));
+    UInt entry = UInt(slot * field_count + field);
+    FOR_EACH(t, added) {
+      vector<UInt>& posting = postings[t];
+      posting.insert(lower_bound(posting.begin(), posting.end(), entry), entry);
+    }
+    FOR_EACH(t, removed) {
+      auto it = postings.find(t);
+      if (it == postings.end()) continue;
+      vector<UInt>& posting = it->second;
+      auto pos = lower_bound(posting.begin(), posting.end(), entry);
+      if (pos != posting.end() && *pos == entry) posting.erase(pos);
+      if (posting.empty()) postings.erase(it);
+    }
+    swap(old_trigrams, new_trigrams);
+  }
+}
+
+void CardSearchIndex::removeCard(UInt slot) {
+  Slot& s = slots[slot];
+  for (size_t field = 0 ; field < field_count ; ++field) {
+    UInt entry = UInt(slot * field_count + field);
+    FOR_EACH(t, s.trigrams[field]) {
+      auto it = postings.find(t);
+      if (it == postings.end()) continue;
+      vector<UInt>& posting = it->second;
+      auto pos = lower_bound(posting.begin(), posting.end(), entry);
+      if (pos != posting.end() && *pos == entry) posting.erase(pos);
+      if (posting.empty()) postings.erase(it);
+    }
+  }
+  slot_of.erase(s.card.get());
+  s.card = CardP();
+  s.trigrams.clear();
+  free_slots.push_back(slot);
+}
+
+bool CardSearchIndex::candidates(const QuickFilterPart& part, vector<UInt>& out) const {
+  out.clear();
+  vector<UInt> query_trigrams;
+  get_trigrams(part.query, query_trigrams);
+  if (query_trigrams.empty()) return false;
+  // which fields can match the type?
+  vector<bool> allowed;
+  if (!part.type.empty()) {
+    const vector<FieldP>& fields = set.game->card_fields;
+    allowed.resize(field_count);
+    for (size_t field = 0 ; field + 1 < field_count ; ++field) {
+      allowed[field] = find_i(fields[field]->name, part.type) != String::npos;
+    }
+    allowed[field_count - 1] = find_i(_("notes"), part.type) != String::npos;
+  }
+  // the postings of all trigrams, rarest first
+  vector<const vector<UInt>*> lists;
+  FOR_EACH(t, query_trigrams) {
+    auto it = postings.find(t);
+    if (it == postings.end()) return true; // no card contains this trigram
+    lists.push_back(&it->second);
+  }
+  sort(lists.begin(), lists.end(), [](const vector<UInt>* a, const vector<UInt>* b) { return a->size() < b->size(); });
+  // intersect the slots
+  vector<UInt> list_slots, intersection;
+  bool first = true;
+  FOR_EACH(list, lists) {
+    list_slots.clear();
+    FOR_EACH(entry, *list) {
+      if (!allowed.empty() && !allowed[entry % field_count]) continue;
+      UInt slot = UInt(entry / field_count);
+      if (list_slots.empty() || list_slots.back() != slot) list_slots.push_back(slot);
+    }
+    if (first) {
+      swap(out, list_slots);
+      first = false;
+    } else {
+      intersection.clear();
+      set_intersection(out.begin(), out.end(), list_slots.begin(), list_slots.end(), back_inserter(intersection));
+      swap(out, intersection);
+    }
+    if (out.empty()) break;
+  }
+  return true;
+}
+
+void CardSearchIndex::find(const vector<QuickFilterPart>& query, vector<VoidP>& out) {
+  update();
+  size_t start = out.size();
+  if (!last_query.empty() && last_version == version && quicksearch_query_refines(query, last_query)) {
+    // only the cards that matched the previous query can match this one
+    FOR_EACH(item, last_result) {
+      if (match_quicksearch_query(query, *static_cast<Card*>(item.get()))) {
+        out.push_back(item);
+      }
+    }
+  } else {
+    // narrow down the cards using the index
+    bool use_index = false;
+    vector<UInt> cands, part_cands, intersection;
+    FOR_EACH(part, query) {
+      if (!part.need_match || !candidates(part, part_cands)) continue;
+      if (!use_index) {
+        swap(cands, part_cands);
+        use_index = true;
+      } else {
+        intersection.clear();
+        set_intersection(cands.begin(), cands.end(), part_cands.begin(), part_cands.end(), back_inserter(intersection));
+        swap(cands, intersection);
+      }
+    }
+    vector<bool> is_candidate;
+    if (use_index) {
+      is_candidate.resize(slots.size());
+      FOR_EACH(slot, cands) is_candidate[slot] = true;
+    }
+    // check the cards, in order
+    FOR_EACH(card, set.cards) {
+      if (use_index) {
+        auto it = slot_of.find(card.get());
+        if (it != slot_of.end() && !is_candidate[it->second]) continue;
+      }
+      if (match_quicksearch_query(query, *card)) {
+        out.push_back(card);
+      }
+    }
+  }
+  // remember for next time
+  last_query = query;
+  last_result.assign(out.begin() + start, out.end());
+  last_version = version;
+}
+
+// ----------------------------------------------------------------------------- : CardQuickFilter
+
+CardQuickFilter::CardQuickFilter(const SetP& set, String const& query)
+  : QuickFilter<Card>(query)
+  , set(set)
+{}
+
+void CardQuickFilter::getItems(vector<CardP> const& in, vector<VoidP>& out) const {
+  if (set && &in == &set->cards) {
+    set->searchIndex().find(query, out);
+  } else {
+    QuickFilter<Card>::getItems(in, out);
+  }
+}
@@ -0,0 +1,90 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/action_stack.hpp>
+#include <data/filter.hpp>
+#include <data/card.hpp>
+
+DECLARE_POINTER_TYPE(Set);
+
+// ----------------------------------------------------------------------------- : CardSearchIndex
+
+/// An index of the text on the cards of a set, for quick searches
+/** For every trigram (three consecutive characters, ignoring case) in the text of the values,
+ *  the index lists the values that contain it. A quick search only checks the cards that contain
+ *  all trigrams of the query, in fields that match the type of the query.
+ *  Trigrams are stored as hashes, collisions only lead to more cards being checked.
+ *
+ *  The index listens to the actions on the set, changed cards are indexed again before the next search.
+ *  It is created together with the set, so it hears about changes before any view of the set does.
+ *  The index itself is built by the first search. Should only be used from the main thread.
+ */
+class CardSearchIndex : public ActionListener {
+public:
+  CardSearchIndex(Set& set);
+  ~CardSearchIndex();
+
+  /// Find the cards in the set that match a query, in the order of the set
+  /** If the query refines the previous one, and nothing has changed since, only the previous results are checked. */
+  void find(const vector<QuickFilterPart>& query, vector<VoidP>& out);
+
+  void onAction(const Action& action, bool undone) override;
+
+private:
+  /// An indexed card
+  struct Slot {
+    CardP                card;     ///< null if the slot is free
+    vector<vector<UInt>> trigrams; ///< Sorted trigrams of each value, by field index, the notes come last
+  };
+
+  Set&                            set;
+  size_t                          field_count;   ///< Number of indexed values of a card, the card fields and the notes
+  vector<Slot>                    slots;
+  vector<UInt>                    free_slots;
+  unordered_map<const Card*,UInt> slot_of;       ///< Slots of the indexed cards
+  unordered_map<UInt,vector<UInt>> postings;     ///< For each trigram: sorted list of slot*field_count+field
+  bool                            built;
+  bool                            cards_changed; ///< Have cards been added or removed since the last update?
+  vector<const Card*>             changed_cards; ///< Cards with changed values since the last update
+  UInt                            version;       ///< Incremented for every change to the set
+
+  // the previous search
+  vector<QuickFilterPart> last_query;
+  vector<VoidP>           last_result;
+  UInt                    last_version;
+
+  /// Bring the index up to date with the set
+  void update();
+  /// Remember that a card has to be indexed again
+  void addChangedCard(const Card* card);
+  /// The card whose notes are edited through a fake value, if any
+  const Card* cardWithNotes(const Value& value) const;
+  /// (Re)index the values of the card in a slot
+  void indexCard(UInt slot);
+  /// Remove the card in a slot from the index
+  void removeCard(UInt slot);
+  /// Find the slots of the cards that can match a part of a query
+  /** Returns false if the index doesn't help for this part */
+  bool candidates(const QuickFilterPart& part, vector<UInt>& out) const;
+};
+
+// ----------------------------------------------------------------------------- : CardQuickFilter
+
+/// A quick search filter for the cards of a set, that uses the search index of the set
+class CardQuickFilter : public QuickFilter<Card> {
+public:
+  CardQuickFilter(const SetP& set, String const& query);
+  /// The index is only used to skip cards, the result is still in set order, so selectsWithKeep() holds
+  void getItems(vector<CardP> const& in, vector<VoidP>& out) const override;
+private:
+  SetP set;
+};
+
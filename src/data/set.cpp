@@ -13,6 +13,8 @@
 #include <data/card.hpp>
 #include <data/keyword.hpp>
 #include <data/pack.hpp>
+#include <data/search_index.hpp>
+#include <data/statistics_cache.hpp>
 #include <data/field.hpp>
 #include <data/field/text.hpp>    // for 0.2.7 fix
 #include <data/field/information.hpp>
@@ -28,12 +30,16 @@
 Set::Set()
   : vcs (make_intrusive<VCS>())
   , script_manager(new SetScriptManager(*this))
+  , search_index(new CardSearchIndex(*this))
+  , stats_values(new StatsValueCache(*this))
 {}
 
 Set::Set(const GameP& game)
   : game(game)
   , vcs (make_intrusive<VCS>())
   , script_manager(new SetScriptManager(*this))
+  , search_index(new CardSearchIndex(*this))
+  , stats_values(new StatsValueCache(*this))
 {
   data.init(game->set_fields);
 }
@@ -43,6 +49,8 @@ Set::Set(const StyleSheetP& stylesheet)
   , stylesheet(stylesheet)
   , vcs (make_intrusive<VCS>())
   , script_manager(new SetScriptManager(*this))
+  , search_index(new CardSearchIndex(*this))
+  , stats_values(new StatsValueCache(*this))
 {
   data.init(game->set_fields);
 }
@@ -64,6 +72,18 @@ void Set::updateStyles(const CardP& card, bool only_content_dependent) {
 void Set::updateDelayed() {
   script_manager->updateDelayed();
 }
+long Set::updateDelayedTyping(long idle_ms) {
+  return script_manager->updateDelayedTyping(idle_ms);
+}
+
+CardSearchIndex& Set::searchIndex() {
+  assert(wxThread::IsMain());
+  return *search_index;
+}
+StatsValueCache& Set::statsValues() {
+  assert(wxThread::IsMain());
+  return *stats_values;
+}
 
 Context& Set::getContextForThumbnails() {
   assert(!wxThread::IsMain());
@@ -27,6 +27,8 @@ DECLARE_POINTER_TYPE(PackType);
 DECLARE_POINTER_TYPE(ScriptValue);
 class SetScriptManager;
 class SetScriptContext;
+class CardSearchIndex;
+class StatsValueCache;
 class Context;
 class Dependency;
 template <typename> class OrderCache;
@@ -71,6 +73,9 @@ public:
   void updateStyles(const CardP& card, bool only_content_dependent);
   /// Update scripts that were delayed
   void updateDelayed();
+  /// Update scripts that depend on typed text, if nothing has been typed for idle_ms milliseconds
+  /** Returns the number of milliseconds to wait before trying again, 0 if there is nothing to update */
+  long updateDelayedTyping(long idle_ms);
   /// A context for performing scripts
   /** Should only be used from the thumbnail thread! */
   Context& getContextForThumbnails();
@@ -114,6 +119,13 @@ public:
   /// Clear the order_cache used by positionOfCard
   void clearOrderCache();
   
+  /// Index of the text on the cards, for quick searches
+  /** Should only be used from the main thread! */
+  CardSearchIndex& searchIndex();
+  /// Cached values of the statistics dimensions
+  /** Should only be used from the main thread! */
+  StatsValueCache& statsValues();
+  
   String typeName() const override;
   Version fileVersion() const override;
   /// Validate that the set is correctly loaded
@@ -133,6 +145,10 @@ private:
   unique_ptr<SetScriptManager> script_manager;
   /// Object for executing scripts from the thumbnail thread
   unique_ptr<SetScriptContext> thumbnail_script_context;
+  /// Index for quick searches
+  unique_ptr<CardSearchIndex> search_index;
+  /// Values for the statistics panel
+  unique_ptr<StatsValueCache> stats_values;
   /// Cache of cards ordered by some criterion
   map<pair<ScriptValueP,ScriptValueP>,OrderCacheP> order_cache;
   map<ScriptValueP,int>                            filter_cache;
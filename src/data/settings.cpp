@@ -53,6 +53,16 @@ IMPLEMENT_REFLECTION_ENUM(FilenameConflicts) {
   VALUE_N("number overwrite",  CONFLICT_NUMBER_OVERWRITE);
 }
 
+IMPLEMENT_REFLECTION_ENUM(PngFilters) {
+  VALUE_N("default", PNG_FILTERS_DEFAULT); //default
+  VALUE_N("none",    PNG_FILTERS_NONE);
+  VALUE_N("sub",     PNG_FILTERS_SUB);
+  VALUE_N("up",      PNG_FILTERS_UP);
+  VALUE_N("average", PNG_FILTERS_AVERAGE);
+  VALUE_N("paeth",   PNG_FILTERS_PAETH);
+  VALUE_N("all",     PNG_FILTERS_ALL);
+}
+
 const int COLUMN_NOT_INITIALIZED = -100000;
 
 ColumnSettings::ColumnSettings()
@@ -102,6 +112,14 @@ void GameSettings::initDefaults(const Game& game) {
       auto_replaces.push_back(ar);
     }
   }
+  autoReplacesChanged();
+}
+
+const AutoReplaceIndex& GameSettings::autoReplaceIndex() {
+  if (!auto_replace_index.isBuilt()) {
+    auto_replace_index.build(auto_replaces);
+  }
+  return auto_replace_index;
 }
 
 IMPLEMENT_REFLECTION_NO_SCRIPT(GameSettings) {
@@ -168,9 +186,14 @@ Settings::Settings()
   , set_window_height    (300)
   , card_notes_height    (40)
   , open_sets_in_new_window(true)
+  , typing_script_delay  (150)
+  , card_prefetch_depth  (1)
   , symbol_grid_size     (30)
   , symbol_grid          (true)
   , symbol_grid_snap     (false)
+  , images_export_jobs   (0)
+  , images_export_png_compression(-1)
+  , images_export_png_filter(PNG_FILTERS_DEFAULT)
   , print_layout         (LAYOUT_NO_SPACE)
   #if USE_OLD_STYLE_UPDATE_CHECKER
   , updates_url          (_("http://magicseteditor.sourceforge.net/updates"))
@@ -260,6 +283,8 @@ IMPLEMENT_REFLECTION_NO_SCRIPT(Settings) {
   REFLECT(set_window_height);
   REFLECT(card_notes_height);
   REFLECT(open_sets_in_new_window);
+  REFLECT(typing_script_delay);
+  REFLECT(card_prefetch_depth);
   REFLECT(symbol_grid_size);
   REFLECT(symbol_grid);
   REFLECT(symbol_grid_snap);
@@ -282,6 +307,9 @@ IMPLEMENT_REFLECTION_NO_SCRIPT(Settings) {
   REFLECT(stylesheet_settings);
   REFLECT(default_stylesheet_settings);
   REFLECT(export_options);
+  REFLECT(images_export_jobs);
+  REFLECT(images_export_png_compression);
+  REFLECT(images_export_png_filter);
 }
 
 void Settings::clear() {
@@ -12,6 +12,7 @@
 #include <util/reflect.hpp>
 #include <util/defaultable.hpp>
 #include <util/angle.hpp>
+#include <data/word_list.hpp>
 
 class Game;
 class StyleSheet;
@@ -54,6 +55,17 @@ enum FilenameConflicts
 ,  CONFLICT_NUMBER_OVERWRITE  // only add numbers for conflicts inside a set, overwrite old stuff
 };
 
+/// Which PNG row filters to use for exported images
+enum PngFilters
+{  PNG_FILTERS_DEFAULT  // let libpng decide
+,  PNG_FILTERS_NONE
+,  PNG_FILTERS_SUB
+,  PNG_FILTERS_UP
+,  PNG_FILTERS_AVERAGE
+,  PNG_FILTERS_PAETH
+,  PNG_FILTERS_ALL      // pick the best filter for each row
+};
+
 /// Settings of a single column in the card list
 class ColumnSettings {
 public:
@@ -86,9 +98,15 @@ public:
   bool                        pack_seed_random;
   int                         pack_seed;
   
+  /// Index of the enabled auto_replaces, built when it is first needed
+  const AutoReplaceIndex& autoReplaceIndex();
+  /// Call after changing auto_replaces, so the index is rebuilt
+  inline void autoReplacesChanged() { auto_replace_index.invalidate(); }
+  
   DECLARE_REFLECTION();
 private:
   bool initialized;
+  AutoReplaceIndex auto_replace_index;
 };
 
 /// Settings for a StyleSheet
@@ -153,6 +171,8 @@ public:
   UInt set_window_height;
   UInt card_notes_height;
   bool open_sets_in_new_window;
+  UInt typing_script_delay; ///< Milliseconds after typing stops before scripts depending on the text are updated, 0 = update while typing
+  UInt card_prefetch_depth; ///< Number of cards before and after the selected card that are drawn in advance, 0 = no prefetching
   
   // --------------------------------------------------- : Symbol editor
   UInt symbol_grid_size;
@@ -185,6 +205,10 @@ public:
   /// Get the options for an export template
   IndexMap<FieldP,ValueP>& exportOptionsFor(const ExportTemplate& export_template);
   
+  int        images_export_jobs;            ///< Number of threads to use for exporting images, 0 = one per cpu
+  int        images_export_png_compression; ///< zlib compression level (0-9) for exported PNG images, -1 = default
+  PngFilters images_export_png_filter;      ///< Row filters for exported PNG images
+  
   // --------------------------------------------------- : Printing
   
   PageLayoutType print_layout;
@@ -0,0 +1,168 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <data/statistics_cache.hpp>
+#include <data/statistics.hpp>
+#include <data/set.hpp>
+#include <data/game.hpp>
+#include <data/card.hpp>
+#include <data/field.hpp>
+#include <data/action/set.hpp>
+#include <data/action/value.hpp>
+#include <data/action/keyword.hpp>
+#include <script/script_manager.hpp>
+#include <util/tagged_string.hpp>
+#include <util/parallel.hpp>
+#include <util/error.hpp>
+
+// ----------------------------------------------------------------------------- : StatsValueCache
+
+StatsValueCache::StatsValueCache(Set& set)
+  : set(set)
+  , version_(0)
+{
+  set.actions.addListener(this);
+}
+
+StatsValueCache::~StatsValueCache() {
+  set.actions.removeListener(this);
+}
+
+void StatsValueCache::getColumn(const StatsDimension& dim, vector<const Value*>& out) {
+  assert(wxThread::IsMain());
+  Column& column = columns[&dim];
+  // compute missing values
+  vector<CardP> missing;
+  FOR_EACH(card, set.cards) {
+    if (!column.count(card.get())) missing.push_back(card);
+  }
+  if (!missing.empty()) compute(dim, missing, column);
+  // the column, in card order
+  out.clear();
+  out.reserve(set.cards.size());
+  FOR_EACH(card, set.cards) {
+    out.push_back(&column[card.get()]);
+  }
+}
+
+/// Evaluate the script of a dimension, for the card of a context
+static void eval_dimension(const StatsDimension& dim, Context& ctx, StatsValueCache::Value& out) {
+  try {
+    out.value = untag(dim.script.invoke(ctx)->toString());
+  } catch (ScriptError const& e) {
+    out.value = e.what();
+    out.error = true;
+  }
+}
+
+void StatsValueCache::compute(const StatsDimension& dim, const vector<CardP>& cards, Column& column) {
+  // make sure that the dependencies are known, so we hear about changes to these values
+  set.getContext();
+  vector<Value> values(cards.size());
+  if (dim.automatic && cards.size() >= 1000) {
+    // every thread needs its own context, that is only worth it for many cards
+    // the styling data is created on demand, that must happen on this thread
+    FOR_EACH_CONST(card, cards) set.stylingDataFor(card);
+    parallel_for((int)cards.size(), 250, [&](int begin, int end) {
+      SetScriptContext script_context(set);
+      for (int i = begin ; i < end ; ++i) {
+        eval_dimension(dim, script_context.getContext(cards[i]), values[i]);
+      }
+    });
+  } else {
+    for (size_t i = 0 ; i < cards.size() ; ++i) {
+      eval_dimension(dim, set.getContext(cards[i]), values[i]);
+    }
+  }
+  // store, report errors
+  for (size_t i = 0 ; i < cards.size() ; ++i) {
+    Value& value = values[i];
+    if (value.error) {
+      handle_error(ScriptError(value.value + _("\n  in script for statistics dimension '") + dim.name + _("'")));
+      value.value.clear();
+    }
+    swap(column[cards[i].get()], value);
+  }
+}
+
+void StatsValueCache::invalidate(const vector<Dependency>& deps, const Card* card) {
+  FOR_EACH_CONST(d, deps) {
+    switch (d.type) {
+      case DEP_CARD_STATS: case DEP_CARDS_STATS: {
+        auto it = columns.find(set.game->statistics_dimensions.at(d.index).get());
+        if (it == columns.end()) break;
+        if (d.type == DEP_CARD_STATS && card) {
+          if (it->second.erase(card)) ++version_;
+        } else if (!it->second.empty()) {
+          // the values of all cards are invalid
+          it->second.clear();
+          ++version_;
+        }
+        break;
+      } case DEP_CARD_COPY_DEP: {
+        // propagate dependencies from another field
+        invalidate(set.game->card_fields[d.index]->dependent_scripts, card);
+        break;
+      } case DEP_SET_COPY_DEP: {
+        invalidate(set.game->set_fields[d.index]->dependent_scripts, card);
+        break;
+      } default:
+        // not a statistic, handled by the SetScriptManager
+        break;
+    }
+  }
+}
+
+void StatsValueCache::onAction(const Action& action, bool undone) {
+  if (columns.empty()) return; // nothing cached yet
+  TYPE_CASE(action, ScriptValueEvent) {
+    invalidate(action.value->fieldP->dependent_scripts, action.card);
+    return;
+  }
+  TYPE_CASE(action, ValueAction) {
+    if (!action.card && dynamic_cast<KeywordTextValue*>(action.valueP.get())) {
+      // a keyword's fake value
+      invalidate(set.game->dependent_scripts_keywords, nullptr);
+    } else {
+      invalidate(action.valueP->fieldP->dependent_scripts, action.card.get());
+    }
+    return;
+  }
+  TYPE_CASE(action, AddCardAction) {
+    if (action.action.adding == undone) {
+      // forget the values of removed cards
+      FOR_EACH_CONST(step, action.action.steps) {
+        FOR_EACH(column, columns) column.second.erase(step.item.get());
+      }
+    }
+    // note: fallthrough
+  }
+  TYPE_CASE_(action, CardListAction) {
+    ++version_;
+    invalidate(set.game->dependent_scripts_cards, nullptr);
+    return;
+  }
+  TYPE_CASE_(action, KeywordListAction) {
+    invalidate(set.game->dependent_scripts_keywords, nullptr);
+    return;
+  }
+  TYPE_CASE_(action, ChangeKeywordModeAction) {
+    invalidate(set.game->dependent_scripts_keywords, nullptr);
+    return;
+  }
+  TYPE_CASE(action, ChangeCardStyleAction) {
+    invalidate(set.game->dependent_scripts_stylesheet, action.card.get());
+    return;
+  }
+  TYPE_CASE_(action, ChangeSetStyleAction) {
+    invalidate(set.game->dependent_scripts_stylesheet, nullptr);
+    return;
+  }
+}
+
@@ -0,0 +1,69 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/action_stack.hpp>
+#include <script/dependency.hpp>
+
+class Set;
+class StatsDimension;
+DECLARE_POINTER_TYPE(Card);
+
+// ----------------------------------------------------------------------------- : StatsValueCache
+
+/// Cache of the values of statistics dimensions for the cards of a set
+/** Values are computed when they are first needed, and kept until an action on the set invalidates them.
+ *  The script of each dimension is registered in the dependency lists of the game as a DEP_CARD_STATS dependency,
+ *  the same lists are used to find the values that have become invalid.
+ *
+ *  The values of automatic dimensions only depend on a single card value, so they are computed in parallel.
+ *  Scripts of other dimensions can use things that are not thread safe (such as position_of), so they are
+ *  evaluated on the main thread.
+ *
+ *  Like the CardSearchIndex this is created together with the set, so it hears about changes before any view does.
+ *  Should only be used from the main thread.
+ */
+class StatsValueCache : public ActionListener {
+public:
+  StatsValueCache(Set& set);
+  ~StatsValueCache();
+
+  /// The value of a dimension for a single card
+  struct Value {
+    String value; ///< Untagged result of the script
+    bool   error; ///< Did the script fail? Then the card should not be shown
+    Value() : error(false) {}
+  };
+
+  /// Get the values of a dimension for all cards in the set, in the order of set.cards
+  /** Values that are not in the cache are computed first, script errors are reported at that time.
+   *  The pointers stay valid until the next action on the set.
+   */
+  void getColumn(const StatsDimension& dim, vector<const Value*>& out);
+
+  /// Incremented when cached values become invalid, or when cards are added, removed or reordered
+  inline UInt version() const { return version_; }
+
+  void onAction(const Action& action, bool undone) override;
+
+private:
+  typedef unordered_map<const Card*,Value> Column;
+
+  Set&                              set;
+  map<const StatsDimension*,Column> columns; ///< Cached values of each dimension
+  UInt                              version_;
+
+  /// Compute the values of a dimension for the given cards
+  void compute(const StatsDimension& dim, const vector<CardP>& cards, Column& column);
+  /// Remove the values of the dependent dimensions from the cache
+  /** If card is not null only the values for that card are invalidated, for DEP_CARD_STATS dependencies */
+  void invalidate(const vector<Dependency>& deps, const Card* card);
+};
+
@@ -11,6 +11,7 @@
 #include <data/symbol.hpp>
 #include <script/to_value.hpp>
 #include <gfx/bezier.hpp>
+#include <util/hash.hpp>
 
 // ----------------------------------------------------------------------------- : ControlPoint
 
@@ -220,6 +221,42 @@ Bounds SymbolShape::calculateBounds(const Vector2D& origin, const Matrix2D& m, b
   return bounds;
 }
 
+size_t SymbolShape::contentHash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, (int)combine);
+  FOR_EACH_CONST(p, points) {
+    hash_combine(h, p->pos.x);
+    hash_combine(h, p->pos.y);
+    hash_combine(h, (int)p->segment_after);
+    if (p->segment_after == SEGMENT_CURVE) {
+      hash_combine(h, p->delta_after.x);
+      hash_combine(h, p->delta_after.y);
+    }
+    if (p->segment_before == SEGMENT_CURVE) {
+      hash_combine(h, p->delta_before.x);
+      hash_combine(h, p->delta_before.y);
+    }
+  }
+  return h;
+}
+
+/// Exact comparison, Vector2D only converts to an integer wxPoint
+static inline bool same_vector(const Vector2D& a, const Vector2D& b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+bool SymbolShape::sameContent(const SymbolPart& that) const {
+  const SymbolShape* s = that.isSymbolShape();
+  if (!s || combine != s->combine || points.size() != s->points.size()) return false;
+  for (size_t i = 0 ; i < points.size() ; ++i) {
+    const ControlPoint& a = *points[i], &b = *s->points[i];
+    if (!same_vector(a.pos, b.pos) || a.segment_after != b.segment_after || a.segment_before != b.segment_before) return false;
+    if (a.segment_after  == SEGMENT_CURVE && !same_vector(a.delta_after,  b.delta_after))  return false;
+    if (a.segment_before == SEGMENT_CURVE && !same_vector(a.delta_before, b.delta_before)) return false;
+  }
+  return true;
+}
+
 // ----------------------------------------------------------------------------- : SymbolSymmetry
 
 IMPLEMENT_REFLECTION_ENUM(SymbolSymmetryType) {
@@ -275,6 +312,27 @@ Bounds SymbolSymmetry::calculateBounds(const Vector2D& origin, const Matrix2D& m
   return bounds;
 }
 
+size_t SymbolSymmetry::contentHash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, (int)kind);
+  hash_combine(h, copies);
+  hash_combine(h, clip);
+  hash_combine(h, center.x);
+  hash_combine(h, center.y);
+  hash_combine(h, handle.x);
+  hash_combine(h, handle.y);
+  FOR_EACH_CONST(p, parts) {
+    hash_combine(h, p->contentHash());
+  }
+  return h;
+}
+
+bool SymbolSymmetry::sameContent(const SymbolPart& that) const {
+  const SymbolSymmetry* s = that.isSymbolSymmetry();
+  return s && kind == s->kind && copies == s->copies && clip == s->clip
+           && same_vector(center, s->center) && same_vector(handle, s->handle) && sameParts(*s);
+}
+
 IMPLEMENT_REFLECTION(SymbolSymmetry) {
   REFLECT_BASE(SymbolPart);
   REFLECT(kind);
@@ -320,6 +378,28 @@ Bounds SymbolGroup::calculateBounds(const Vector2D& origin, const Matrix2D& m, b
   return bounds;
 }
 
+size_t SymbolGroup::contentHash() const {
+  size_t h = hash_start(*this);
+  FOR_EACH_CONST(p, parts) {
+    hash_combine(h, p->contentHash());
+  }
+  return h;
+}
+
+bool SymbolGroup::sameContent(const SymbolPart& that) const {
+  // a Symbol is compared like a plain group
+  const SymbolGroup* g = that.isSymbolGroup();
+  return g && !that.isSymbolSymmetry() && sameParts(*g);
+}
+
+bool SymbolGroup::sameParts(const SymbolGroup& that) const {
+  if (parts.size() != that.parts.size()) return false;
+  for (size_t i = 0 ; i < parts.size() ; ++i) {
+    if (!parts[i]->sameContent(*that.parts[i])) return false;
+  }
+  return true;
+}
+
 IMPLEMENT_REFLECTION(SymbolGroup) {
   REFLECT_BASE(SymbolPart);
   REFLECT(parts);
@@ -168,6 +168,12 @@ public:
   /// Calculate the position and size of the part using the given rotation matrix
   virtual Bounds calculateBounds(const Vector2D& origin, const Matrix2D& m, bool is_identity) = 0;
   
+  /// Hash of everything that affects how this part looks, the name is not included
+  /** Used to find rendered symbols in a cache, see SymbolRenderCache */
+  virtual size_t contentHash() const = 0;
+  /// Does this part look the same as another? Compares what contentHash() hashes
+  virtual bool sameContent(const SymbolPart& that) const = 0;
+  
   DECLARE_REFLECTION_VIRTUAL();
   virtual void after_reading(Version) {}
   friend void after_reading(SymbolPart&, Version);
@@ -222,6 +228,8 @@ public:
   
   /// Calculate the position and size of the part using the given rotation matrix
   Bounds calculateBounds(const Vector2D& origin, const Matrix2D& m, bool is_identity) override;
+  size_t contentHash() const override;
+  bool sameContent(const SymbolPart& that) const override;
   
   DECLARE_REFLECTION_OVERRIDE();
   void after_reading(Version) override;
@@ -245,7 +253,14 @@ public:
   bool isAncestor(const SymbolPart& that) const override;
   
   Bounds calculateBounds(const Vector2D& origin, const Matrix2D& m, bool is_identity) override;
+  size_t contentHash() const override;
+  bool sameContent(const SymbolPart& that) const override;
+  
+protected:
+  /// Do the parts of two groups look the same?
+  bool sameParts(const SymbolGroup& that) const;
   
+public:
   DECLARE_REFLECTION_OVERRIDE();
 };
 
@@ -276,6 +291,8 @@ public:
   
   String expectedName() const;
   Bounds calculateBounds(const Vector2D& origin, const Matrix2D& m, bool is_identity) override;
+  size_t contentHash() const override;
+  bool sameContent(const SymbolPart& that) const override;
   
   DECLARE_REFLECTION_OVERRIDE();
 };
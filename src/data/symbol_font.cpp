@@ -17,6 +17,34 @@
 #include <render/text/element.hpp> // fot CharInfo
 #include <script/image.hpp>
 
+// ----------------------------------------------------------------------------- : SymbolCodeMatcher
+
+/// Finds the first symbol of a font whose code matches at a position in a text
+/** This gives the same result as trying all symbols in order, but it is much faster:
+ *   - Literal codes are stored in a trie, so they are all checked in a single walk over the text.
+ *     The children of the root act as a dispatch table on the first character.
+ *   - Regexes are only tried when they come before the first matching literal code,
+ *     and only at the position itself, instead of searching the rest of the text.
+ *  Scripts can enable and disable symbols, so that is checked while matching.
+ */
+class SymbolCodeMatcher {
+public:
+  SymbolCodeMatcher(const vector<SymbolInFontP>& symbols);
+  
+  /// Find the symbol that matches at text[pos], returns nullptr if there is none
+  /** The length of the match is stored in length, for regex symbols the match is stored in results */
+  SymbolInFont* match(const String& text, size_t pos, size_t& length, Regex::Results& results) const;
+  
+private:
+  struct Node {
+    map<Char,size_t> children;
+    vector<size_t>   symbols; ///< Symbols with the code ending at this node, in declaration order
+  };
+  vector<SymbolInFontP> symbols;
+  vector<Node>          trie;    ///< trie[0] is the root
+  vector<size_t>        regexes; ///< Regex symbols, in declaration order
+};
+
 // ----------------------------------------------------------------------------- : SymbolFont
 
 // SymbolFont that is used for SymbolInFonts constructed with the default constructor
@@ -44,6 +72,11 @@ SymbolFontP SymbolFont::byName(const String& name) {
     ? name : name + _(".mse-symbol-font"));
 }
 
+void SymbolFont::validate(Version ver) {
+  Packaged::validate(ver);
+  matcher = make_unique<SymbolCodeMatcher>(symbols);
+}
+
 IMPLEMENT_REFLECTION(SymbolFont) {
   REFLECT_BASE(Packaged);
   
@@ -62,6 +95,7 @@ IMPLEMENT_REFLECTION(SymbolFont) {
 class SymbolInFont : public IntrusivePtrBase<SymbolInFont> {
 public:
   SymbolInFont();
+  ~SymbolInFont();
   
   /// Get a shrunk, zoomed image
   Image getImage(Package& pkg, double size);
@@ -93,8 +127,14 @@ private:
   ScriptableImage  image;      ///< The image for this symbol
   double           img_size;    ///< Font size used by the image
   wxSize           actual_size;  ///< Actual image size, only known after loading the image
-  /// Cached bitmaps for different sizes
-  map<double, Bitmap> bitmaps;
+  wxMutex          size_lock;    ///< Lock for actual_size, glyphs are also made by worker threads
+  
+  /// Size in pixels of the image for the given font size
+  wxSize glyphSize(Package& pkg, double size);
+  /// The actual image size, or 0x0 if it is not known yet
+  wxSize actualSize();
+  /// Update the actual image size, returns true if it has changed
+  bool setActualSize(const wxSize& size);
   
   DECLARE_REFLECTION();
 };
@@ -113,28 +153,59 @@ SymbolInFont::SymbolInFont()
   if (img_size <= 0) img_size = 1;
 }
 
+SymbolInFont::~SymbolInFont() {
+  glyph_atlas.forget(this);
+}
+
+wxSize SymbolInFont::actualSize() {
+  wxMutexLocker l(size_lock);
+  return actual_size;
+}
+bool SymbolInFont::setActualSize(const wxSize& size) {
+  wxMutexLocker l(size_lock);
+  if (actual_size == size) return false;
+  actual_size = size;
+  return true;
+}
+
+wxSize SymbolInFont::glyphSize(Package& pkg, double size) {
+  wxSize actual = actualSize();
+  if (actual.GetWidth() == 0) {
+    // we don't know what size the image will be, the generated image is cached, so this is not wasted
+    Image img = image.generate(GeneratedImage::Options(0, 0, &pkg));
+    actual = wxSize(img.GetWidth(), img.GetHeight());
+    setActualSize(actual);
+  }
+  return wxSize((int) (actual.GetWidth()  * size / img_size),
+                (int) (actual.GetHeight() * size / img_size));
+}
+
 Image SymbolInFont::getImage(Package& pkg, double size) {
-  // generate new image
   if (!image.isReady()) {
     throw Error(_("No image specified for symbol with code '") + code + _("' in symbol font."));
   }
+  // look in the atlas
+  wxSize glyph_size = glyphSize(pkg, size);
+  Image glyph;
+  if (glyph_atlas.findImage(this, glyph_size, glyph)) return glyph;
+  // generate new image
   Image img = image.generate(GeneratedImage::Options(0, 0, &pkg));
-  actual_size = wxSize(img.GetWidth(), img.GetHeight());
+  if (setActualSize(wxSize(img.GetWidth(), img.GetHeight()))) {
+    glyph_size = glyphSize(pkg, size);
+  }
   // scale to match expected size
-  Image resampled_image((int) (actual_size.GetWidth()  * size / img_size),
-                        (int) (actual_size.GetHeight() * size / img_size), false);
+  Image resampled_image(glyph_size.GetWidth(), glyph_size.GetHeight(), false);
   if (!resampled_image.Ok()) return Image(1,1);
   resample(img, resampled_image);
+  glyph_atlas.add(this, glyph_size, resampled_image);
   return resampled_image;
 }
 Bitmap SymbolInFont::getBitmap(Package& pkg, double size) {
-  // is this bitmap already loaded/generated?
-  Bitmap& bmp = bitmaps[size];
-  if (!bmp.Ok()) {
-    // generate image, convert to bitmap, store for later use
-    bmp = Bitmap(getImage(pkg, size));
-  }
-  return bmp;
+  // is this bitmap already generated?
+  Bitmap bmp;
+  if (image.isReady() && glyph_atlas.findBitmap(this, glyphSize(pkg, size), bmp)) return bmp;
+  // generate image, it is stored in the atlas for later use
+  return Bitmap(getImage(pkg, size));
 }
 Bitmap SymbolInFont::getBitmap(Package& pkg, wxSize size) {
   // generate new bitmap
@@ -145,17 +216,17 @@ Bitmap SymbolInFont::getBitmap(Package& pkg, wxSize size) {
 }
 
 RealSize SymbolInFont::size(Package& pkg, double size) {
-  if (actual_size.GetWidth() == 0) {
+  if (actualSize().GetWidth() == 0) {
     // we don't know what size the image will be
-    getBitmap(pkg, size);
+    getImage(pkg, size);
   }
-  return wxSize(actual_size * (int) (size) / (int) (img_size));
+  return wxSize(actualSize() * (int) (size) / (int) (img_size));
 }
 
 void SymbolInFont::update(Context& ctx) {
   if (image.update(ctx)) {
-    // image has changed, cache is no longer valid
-    bitmaps.clear();
+    // image has changed, glyphs are no longer valid
+    glyph_atlas.forget(this);
   }
   enabled.update(ctx);
   if (text_font)
@@ -187,75 +258,101 @@ IMPLEMENT_REFLECTION(SymbolInFont) {
   REFLECT_N("image_font_size", img_size);
 }
 
+// ----------------------------------------------------------------------------- : SymbolFont : matching codes
+
+SymbolCodeMatcher::SymbolCodeMatcher(const vector<SymbolInFontP>& symbols)
+  : symbols(symbols)
+  , trie(1)
+{
+  for (size_t i = 0 ; i < symbols.size() ; ++i) {
+    SymbolInFont& sym = *symbols[i];
+    if (sym.code.empty()) continue;
+    if (sym.regex) {
+      if (sym.code_regex.empty()) sym.code_regex.assign(sym.code);
+      regexes.push_back(i);
+    } else {
+      size_t node = 0;
+      for (size_t j = 0 ; j < sym.code.size() ; ++j) {
+        Char c = sym.code[j];
+        auto it = trie[node].children.find(c);
+        if (it == trie[node].children.end()) {
+          trie[node].children.insert(make_pair(c, trie.size()));
+          node = trie.size();
+          trie.push_back(Node());
+        } else {
+          node = it->second;
+        }
+      }
+      trie[node].symbols.push_back(i);
+    }
+  }
+}
+
+SymbolInFont* SymbolCodeMatcher::match(const String& text, size_t pos, size_t& length, Regex::Results& results) const {
+  // the first enabled literal code that matches
+  size_t best = symbols.size();
+  size_t node = 0;
+  for (size_t i = pos ; i < text.size() ; ) {
+    auto it = trie[node].children.find((Char)text[i]);
+    if (it == trie[node].children.end()) break;
+    node = it->second;
+    ++i;
+    FOR_EACH_CONST(s, trie[node].symbols) {
+      if (s >= best) break;
+      if (symbols[s]->enabled) {
+        best = s;
+        length = i - pos;
+        break;
+      }
+    }
+  }
+  // regexes that come before it
+  FOR_EACH_CONST(r, regexes) {
+    if (r >= best) break;
+    SymbolInFont& sym = *symbols[r];
+    if (sym.enabled && !sym.code_regex.empty()
+        && sym.code_regex.matches_prefix(results, text.begin() + pos, text.end()) && results.length() > 0) {
+      length = results.length();
+      return &sym;
+    }
+  }
+  return best < symbols.size() ? symbols[best].get() : nullptr;
+}
+
 // ----------------------------------------------------------------------------- : SymbolFont : splitting
 
 void SymbolFont::split(const String& text, SplitSymbols& out) const {
+  if (!matcher) return;
+  Regex::Results results;
   // read a single symbol until we are done with the text
   for (size_t pos = 0 ; pos < text.size() ; ) {
-    // check symbol list
-    FOR_EACH_CONST(sym, symbols) {
-      if (!sym->code.empty() && sym->enabled) {
-        if (sym->regex) {
-          if (sym->code_regex.empty()) {
-            sym->code_regex.assign(sym->code);
-          }
-          Regex::Results results;
-          if (sym->code_regex.matches(results,text.begin() + pos, text.end())
-              && results.position() == 0 && results.length() > 0) { //Matches the regex
-            if (sym->draw_text >= 0 && sym->draw_text < (int)results.size()) {
-              out.push_back(DrawableSymbol(
-                      results.str(),
-                      results.str(sym->draw_text),
-                      *sym));
-            } else {
-              out.push_back(DrawableSymbol(
-                      results.str(),
-                      _(""),
-                      *sym));
-            }
-            pos += results.length();
-            goto next_symbol;
-          }
-        } else {
-          if (is_substr(text, pos, sym->code)) {
-            out.push_back(DrawableSymbol(sym->code, sym->draw_text >= 0 ? sym->code : _(""), *sym));
-            pos += sym->code.size();
-            goto next_symbol; // continue two levels
-          }
-        }
+    size_t length = 0;
+    SymbolInFont* sym = matcher->match(text, pos, length, results);
+    if (!sym) {
+      // unknown code, skip a single character
+      pos += 1;
+    } else if (sym->regex) {
+      if (sym->draw_text >= 0 && sym->draw_text < (int)results.size()) {
+        out.push_back(DrawableSymbol(results.str(), results.str(sym->draw_text), *sym));
+      } else {
+        out.push_back(DrawableSymbol(results.str(), _(""), *sym));
       }
+      pos += length;
+    } else {
+      out.push_back(DrawableSymbol(sym->code, sym->draw_text >= 0 ? sym->code : _(""), *sym));
+      pos += length;
     }
-    // unknown code, draw single character as text
-    //out.push_back(DrawableSymbol(text.substr(pos, 1), _(""), defaultSymbol()));
-    pos += 1;
-next_symbol:;
   }
 }
 
 size_t SymbolFont::recognizePrefix(const String& text, size_t start) const {
-  size_t pos;
-  for (pos = start ; pos < text.size() ; ) {
-    // check symbol list
-    FOR_EACH_CONST(sym, symbols) {
-      if (!sym->code.empty() && sym->enabled) {
-        if (sym->regex) {
-          Regex::Results results;
-          if (!sym->code_regex.empty() && sym->code_regex.matches(results,text.begin() + pos, text.end())
-              && results.position() == 0 && results.length() > 0) { //Matches the regex
-            pos += results.length();
-            goto next_symbol;
-          }
-        } else {
-          if (is_substr(text, pos, sym->code)) {
-            pos += sym->code.size();
-            goto next_symbol; // continue two levels
-          }
-        }
-      }
-    }
-    // failed
-    break;
-next_symbol:;
+  if (!matcher) return 0;
+  Regex::Results results;
+  size_t pos = start;
+  while (pos < text.size()) {
+    size_t length = 0;
+    if (!matcher->match(text, pos, length, results)) break;
+    pos += length;
   }
   return pos - start;
 }
@@ -410,6 +507,107 @@ RealSize SymbolFont::defaultSymbolSize(double font_size) {
 }
 
 
+// ----------------------------------------------------------------------------- : GlyphAtlas
+
+GlyphAtlas glyph_atlas;
+
+GlyphAtlas::GlyphAtlas(size_t max_bytes)
+  : max_bytes(max_bytes), bytes(0)
+{}
+
+GlyphAtlas::EntryIt GlyphAtlas::find(const Key& key) {
+  auto it = index.find(key);
+  if (it == index.end()) return entries.end();
+  entries.splice(entries.begin(), entries, it->second); // most recently used
+  return it->second;
+}
+
+bool GlyphAtlas::findImage(const SymbolInFont* symbol, wxSize size, Image& out) {
+  wxMutexLocker l(lock);
+  EntryIt it = find(makeKey(symbol, size));
+  if (it == entries.end()) return false;
+  out = it->image.Copy();
+  return true;
+}
+
+bool GlyphAtlas::findBitmap(const SymbolInFont* symbol, wxSize size, Bitmap& out) {
+  assert(wxThread::IsMain());
+  wxMutexLocker l(lock);
+  releaseBitmaps();
+  Key key = makeKey(symbol, size);
+  EntryIt it = find(key);
+  if (it == entries.end()) return false;
+  Bitmap& bitmap = bitmaps[key];
+  if (!it->has_bitmap) {
+    bitmap = Bitmap(it->image);
+    it->has_bitmap = true;
+    size_t bitmap_bytes = (size_t)size.x * size.y * 4;
+    it->bytes += bitmap_bytes;
+    bytes     += bitmap_bytes;
+  }
+  out = bitmap;
+  shrink(max_bytes);
+  releaseBitmaps();
+  return true;
+}
+
+void GlyphAtlas::add(const SymbolInFont* symbol, wxSize size, const Image& image) {
+  size_t image_bytes = (size_t)size.x * size.y * (image.HasAlpha() ? 4 : 3);
+  wxMutexLocker l(lock);
+  if (image_bytes > max_bytes / 4) return; // too large to store
+  Key key = makeKey(symbol, size);
+  if (index.find(key) != index.end()) return; // already added by another thread
+  Entry e = { key, image.Copy(), false, image_bytes };
+  entries.push_front(e);
+  index.insert(make_pair(key, entries.begin()));
+  bytes += image_bytes;
+  shrink(max_bytes);
+}
+
+void GlyphAtlas::remove(EntryIt it) {
+  // the bitmap may not be destroyed here, this can be another thread
+  if (it->has_bitmap) discarded.push_back(it->key);
+  index.erase(it->key);
+  bytes -= it->bytes;
+  entries.erase(it);
+}
+
+void GlyphAtlas::releaseBitmaps() {
+  FOR_EACH(key, discarded) {
+    bitmaps.erase(key);
+  }
+  discarded.clear();
+}
+
+void GlyphAtlas::shrink(size_t budget) {
+  // never remove the most recently used glyph, it may be in use
+  while (bytes > budget && entries.size() > 1) {
+    remove(--entries.end());
+  }
+}
+
+void GlyphAtlas::forget(const SymbolInFont* symbol) {
+  wxMutexLocker l(lock);
+  auto it = index.lower_bound(make_pair(symbol, make_pair(numeric_limits<int>::min(), numeric_limits<int>::min())));
+  while (it != index.end() && it->first.first == symbol) {
+    EntryIt e = (it++)->second;
+    remove(e);
+  }
+}
+
+void GlyphAtlas::clear() {
+  wxMutexLocker l(lock);
+  while (!entries.empty()) remove(entries.begin());
+  if (wxThread::IsMain()) releaseBitmaps();
+}
+
+void GlyphAtlas::setMaxBytes(size_t max_bytes) {
+  wxMutexLocker l(lock);
+  this->max_bytes = max_bytes;
+  shrink(max_bytes);
+  if (wxThread::IsMain()) releaseBitmaps();
+}
+
 // ----------------------------------------------------------------------------- : InsertSymbolMenu
 
 wxMenu* SymbolFont::insertSymbolMenu(Context& ctx) {
@@ -14,6 +14,8 @@
 #include <data/localized_string.hpp>
 #include <data/font.hpp>
 #include <wx/regex.h>
+#include <wx/thread.h>
+#include <list>
 
 DECLARE_POINTER_TYPE(Font);
 DECLARE_POINTER_TYPE(SymbolFont);
@@ -21,6 +23,7 @@ DECLARE_POINTER_TYPE(SymbolInFont);
 DECLARE_POINTER_TYPE(InsertSymbolMenu);
 class RotatedDC;
 struct CharInfo;
+class SymbolCodeMatcher;
 
 // ----------------------------------------------------------------------------- : SymbolFont
 
@@ -71,6 +74,7 @@ public:
   static String typeNameStatic();
   String typeName() const override;
   Version fileVersion() const override;
+  void validate(Version) override;
   
   /// Generate a 'insert symbol' menu.
   /** This class owns the menu!
@@ -93,6 +97,7 @@ private:
   friend class SymbolInFont;
   friend class InsertSymbolMenu;
   vector<SymbolInFontP> symbols;  ///< The individual symbols
+  unique_ptr<SymbolCodeMatcher> matcher; ///< Finds symbols by their code, built in validate()
     
   /// Find the default symbol
   /** may return nullptr */
@@ -110,6 +115,68 @@ public:
   DECLARE_REFLECTION();
 };
 
+// ----------------------------------------------------------------------------- : GlyphAtlas
+
+/// Shared store of the resampled images of the symbols in all symbol fonts
+/** Glyphs are bucketed by their size in pixels, so all font sizes and zoom levels that give
+ *  the same glyph size share a single image.
+ *  When the glyphs take up more than the memory budget, the least recently used ones are discarded.
+ *
+ *  Images can be found and added from any thread. Bitmaps are made from the images on demand,
+ *  and only on the main thread, since they are GDI objects. So they are kept apart from the entries:
+ *  when another thread discards an entry, its bitmap is released the next time the main thread uses the atlas.
+ */
+class GlyphAtlas {
+public:
+  GlyphAtlas(size_t max_bytes = 16 << 20);
+  
+  /// Find the image of a glyph, returns false if it is not in the atlas
+  bool findImage(const SymbolInFont* symbol, wxSize size, Image& out);
+  /// Find a glyph as a bitmap, returns false if it is not in the atlas. Must be called from the main thread
+  bool findBitmap(const SymbolInFont* symbol, wxSize size, Bitmap& out);
+  /// Add the image of a glyph
+  void add(const SymbolInFont* symbol, wxSize size, const Image& image);
+  
+  /// Remove all glyphs of a symbol, when it has changed or is destroyed
+  void forget(const SymbolInFont* symbol);
+  /// Remove all glyphs. When called from the main thread, the bitmaps are released as well
+  void clear();
+  /// Change the memory budget, in bytes
+  void setMaxBytes(size_t max_bytes);
+  
+private:
+  typedef pair<const SymbolInFont*, pair<int,int>> Key;
+  struct Entry {
+    Key    key;
+    Image  image;
+    bool   has_bitmap; ///< Is there a bitmap in bitmaps?
+    size_t bytes;
+  };
+  typedef list<Entry>::iterator EntryIt;
+  
+  mutable wxMutex lock;
+  list<Entry> entries;    ///< Most recently used first
+  map<Key,EntryIt> index; ///< Entries by symbol and size
+  size_t max_bytes;
+  size_t bytes;
+  vector<Key> discarded;  ///< Entries that had a bitmap and were removed, their bitmaps are to be released
+  map<Key,Bitmap> bitmaps; ///< Bitmaps of the entries, only used on the main thread
+  
+  static inline Key makeKey(const SymbolInFont* symbol, wxSize size) {
+    return make_pair(symbol, make_pair(size.x, size.y));
+  }
+  /// Find an entry and mark it as most recently used. Lock must be held.
+  EntryIt find(const Key& key);
+  /// Remove least recently used entries until at most budget bytes are used. Lock must be held.
+  void shrink(size_t budget);
+  void remove(EntryIt it);
+  /// Release the bitmaps of discarded entries. Lock must be held, main thread only.
+  void releaseBitmaps();
+};
+
+/// The global glyph atlas
+extern GlyphAtlas glyph_atlas;
+
 // ----------------------------------------------------------------------------- : InsertSymbolMenu
 
 /// Description of a menu to insert symbols from a symbol font into the text
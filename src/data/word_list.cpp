@@ -54,4 +54,52 @@ void after_reading(AutoReplace& ar, Version) {
   if (ar.match.empty()) {
     ar.enabled = false;
   }
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------- : AutoReplaceIndex
+
+AutoReplaceIndex::AutoReplaceIndex()
+  : built(false)
+{}
+
+void AutoReplaceIndex::build(const vector<AutoReplaceP>& auto_replaces) {
+  nodes.clear();
+  nodes.push_back(Node());
+  for (size_t i = 0 ; i < auto_replaces.size() ; ++i) {
+    const AutoReplace& ar = *auto_replaces[i];
+    if (!ar.enabled) continue;
+    UInt node = 0;
+    for (size_t j = ar.match.size() ; j > 0 ; --j) {
+      Char c = ar.match.GetChar(j - 1);
+      vector<pair<Char,UInt>>& children = nodes[node].children;
+      auto it = lower_bound(children.begin(), children.end(), make_pair(c, UInt(0)));
+      if (it != children.end() && it->first == c) {
+        node = it->second;
+      } else {
+        UInt child = (UInt)nodes.size();
+        children.insert(it, make_pair(c, child));
+        nodes.push_back(Node()); // invalidates children
+        node = child;
+      }
+    }
+    nodes[node].entries.push_back(i);
+  }
+  built = true;
+}
+
+void AutoReplaceIndex::find(const String& text, size_t end, vector<size_t>& out) const {
+  out.clear();
+  if (nodes.empty()) return;
+  UInt node = 0;
+  size_t pos = end;
+  while (true) {
+    out.insert(out.end(), nodes[node].entries.begin(), nodes[node].entries.end());
+    if (pos == 0) break;
+    Char c = text.GetChar(--pos);
+    const vector<pair<Char,UInt>>& children = nodes[node].children;
+    auto it = lower_bound(children.begin(), children.end(), make_pair(c, UInt(0)));
+    if (it == children.end() || it->first != c) break;
+    node = it->second;
+  }
+  sort(out.begin(), out.end());
+}
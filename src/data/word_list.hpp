@@ -60,3 +60,32 @@ public:
 
 void after_reading(AutoReplace& ar, Version);
 
+/// Index of auto replace entries, for finding the entries that match just before the cursor
+/** The match strings of the enabled entries are stored in a trie, reversed.
+ *  All entries that match before a position are then found by walking backwards through the text once,
+ *  instead of comparing every entry.
+ */
+class AutoReplaceIndex {
+public:
+  AutoReplaceIndex();
+
+  /// Build the index for the enabled entries in a list
+  void build(const vector<AutoReplaceP>& auto_replaces);
+  /// Forget the index, it is built again by the next call to build()
+  inline void invalidate() { built = false; }
+  inline bool isBuilt() const { return built; }
+
+  /// Find the entries whose match string ends at position end in text
+  /** Gives the positions of the entries in the list, in increasing order.
+   *  Whole word rules are not checked here. */
+  void find(const String& text, size_t end, vector<size_t>& out) const;
+
+private:
+  struct Node {
+    vector<pair<Char,UInt>> children; ///< Child nodes, sorted by character
+    vector<size_t>          entries;  ///< Entries whose (reversed) match string ends here
+  };
+  vector<Node> nodes; ///< nodes[0] is the root
+  bool         built;
+};
+
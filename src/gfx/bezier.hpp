@@ -69,6 +69,8 @@ void deCasteljau(const Vector2D& a1, Vector2D& a21, Vector2D& a34, const Vector2
  *  All points are converted to display coordinates by multiplying with m and adding origin
  */
 void segment_subdivide(const ControlPoint& p0, const ControlPoint& p1, const Vector2D& origin, const Matrix2D& m, vector<wxPoint>& out);
+/// Devide a segment into a number of straight lines, without rounding the points to pixels
+void segment_subdivide(const ControlPoint& p0, const ControlPoint& p1, const Vector2D& origin, const Matrix2D& m, vector<Vector2D>& out);
 
 // ----------------------------------------------------------------------------- : Bounds
 
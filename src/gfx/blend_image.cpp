@@ -110,10 +110,12 @@ void set_alpha(Image& img, double alpha) {
     img.InitAlpha();
     memset(img.GetAlpha(), b_alpha, img.GetWidth() * img.GetHeight());
   } else {
-    Byte *im = img.GetAlpha();
-    size_t size = img.GetWidth() * img.GetHeight();
-    for (size_t i = 0 ; i < size ; ++i) {
-      im[i] = (im[i] * b_alpha) / 255;
-    }
+    multiply_alpha(img.GetAlpha(), img.GetWidth() * img.GetHeight(), b_alpha);
+  }
+}
+
+void multiply_alpha(Byte* alphas, size_t n, Byte alpha) {
+  for (size_t i = 0 ; i < n ; ++i) {
+    alphas[i] = (alphas[i] * alpha) / 255;
   }
 }
@@ -0,0 +1,126 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/gfx.hpp>
+#include <util/parallel.hpp>
+
+// ----------------------------------------------------------------------------- : Extended box filter
+
+// A gaussian blur is approximated by repeated box filters, see
+//   Gwosdek et al., "Theoretical foundations of gaussian convolution by extended box filtering" (2011).
+// A plain box filter can only have a few discrete variances, an extended box filter has fractional weights
+// at both ends, so the variance of the result is exactly that of the gaussian, also for small sigma.
+// With a running sum, the cost per pixel does not depend on the radius.
+
+/// Number of box filter passes, 3 is close enough to a gaussian
+const int blur_passes = 3;
+
+/// An extended box filter: weight c_in for offsets in [-r..r], weight c_edge for offsets -r-1 and r+1
+struct ExtendedBox {
+  int r;
+  float c_in, c_edge;
+  
+  /// Box filter with the given variance
+  ExtendedBox(double variance) {
+    // largest plain box with variance r*(r+1)/3 <= variance
+    r = max(0, (int)floor((sqrt(1 + 12 * variance) - 1) / 2));
+    // fractional weight for the edges to make up the difference
+    double alpha = (2*r + 1) * (variance - r * (r + 1) / 3.) / (2 * ((r + 1) * (r + 1) - variance));
+    double total = 2*r + 1 + 2 * alpha;
+    c_in   = float(1 / total);
+    c_edge = float(alpha / total);
+  }
+};
+
+/// Apply a box filter to lanes adjacent lines of n values, the values of a line are stride apart
+/** Values outside the line count as 0.
+ *  zero must contain lanes zeros, acc is scratch space for lanes values.
+ */
+void box_blur_lines(const float* in, float* out, int n, size_t stride, int lanes, const ExtendedBox& box, const float* zero, float* acc) {
+  const int r = box.r;
+  auto line = [&](int i) { return i >= 0 && i < n ? in + i * stride : zero; };
+  // acc = sum of [i-r..i+r], starting at i = 0
+  fill_n(acc, lanes, 0.f);
+  for (int i = 0 ; i <= r && i < n ; ++i) {
+    const float* l = line(i);
+    for (int j = 0 ; j < lanes ; ++j) acc[j] += l[j];
+  }
+  for (int i = 0 ; i < n ; ++i) {
+    const float* prev = line(i - r - 1);
+    const float* next = line(i + r + 1);
+    const float* drop = line(i - r);
+    float* o = out + i * stride;
+    for (int j = 0 ; j < lanes ; ++j) {
+      o[j] = box.c_in * acc[j] + box.c_edge * (prev[j] + next[j]);
+      acc[j] += next[j] - drop[j];
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------- : Gaussian blur
+
+void gaussian_blur(Byte* data, int width, int height, double sigma_x, double sigma_y, bool clamp_edges) {
+  if (width <= 0 || height <= 0) return;
+  ExtendedBox box_x(sigma_x * sigma_x / blur_passes);
+  ExtendedBox box_y(sigma_y * sigma_y / blur_passes);
+  // Lines are padded with zeros (or copies of the edge values), and the passes also write to that padding.
+  // Otherwise values that are blurred past the border in one pass would not come back in the next.
+  // The padding is wide enough that the zeros beyond it never reach the image in blur_passes passes,
+  // so with copies of the edges the result is as if the edges were repeated forever.
+  int pad_x = blur_passes * (box_x.r + 1);
+  int pad_y = blur_passes * (box_y.r + 1);
+  size_t w = width;
+  vector<float> temp(w * height);
+  // blur rows, each row is independent
+  parallel_for(height, max(1, 16384 / width), [&](int y_begin, int y_end) {
+    int n = width + 2 * pad_x;
+    vector<float> p(n), q(n), zero(1), acc(1);
+    for (int y = y_begin ; y < y_end ; ++y) {
+      const Byte* in = data + y * w;
+      fill(p.begin(), p.begin() + pad_x, clamp_edges ? in[0] : 0.f);
+      fill(p.begin() + pad_x + width, p.end(), clamp_edges ? in[width - 1] : 0.f);
+      for (int x = 0 ; x < width ; ++x) p[pad_x + x] = in[x];
+      box_blur_lines(p.data(), q.data(), n, 1, 1, box_x, zero.data(), acc.data());
+      box_blur_lines(q.data(), p.data(), n, 1, 1, box_x, zero.data(), acc.data());
+      box_blur_lines(p.data(), q.data(), n, 1, 1, box_x, zero.data(), acc.data());
+      copy_n(&q[pad_x], w, &temp[y * w]);
+    }
+  });
+  // blur columns, a block of adjacent columns at a time, so memory is accessed a row at a time
+  const int block = 128;
+  int blocks = (width + block - 1) / block;
+  parallel_for(blocks, max(1, 16384 / (block * height)), [&](int block_begin, int block_end) {
+    int n = height + 2 * pad_y;
+    vector<float> p(n * block), q(n * block), zero(block), acc(block);
+    for (int blk = block_begin ; blk < block_end ; ++blk) {
+      size_t x = blk * block;
+      int lanes = min(block, width - (int)x);
+      for (int y = 0 ; y < n ; ++y) {
+        int y_in = y - pad_y;
+        if (y_in >= 0 && y_in < height) {
+          copy_n(&temp[x + y_in * w], lanes, &p[y * lanes]);
+        } else if (clamp_edges) {
+          copy_n(&temp[x + (y_in < 0 ? 0 : height - 1) * w], lanes, &p[y * lanes]);
+        } else {
+          fill_n(&p[y * lanes], lanes, 0.f);
+        }
+      }
+      box_blur_lines(p.data(), q.data(), n, lanes, lanes, box_y, zero.data(), acc.data());
+      box_blur_lines(q.data(), p.data(), n, lanes, lanes, box_y, zero.data(), acc.data());
+      box_blur_lines(p.data(), q.data(), n, lanes, lanes, box_y, zero.data(), acc.data());
+      for (int y = 0 ; y < height ; ++y) {
+        const float* in = &q[(pad_y + y) * lanes];
+        Byte* out = data + x + y * w;
+        for (int j = 0 ; j < lanes ; ++j) {
+          out[j] = (Byte)min(255.f, max(0.f, in[j]) + 0.5f);
+        }
+      }
+    }
+  });
+}
@@ -8,6 +8,7 @@
 
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/combine_image_simd.hpp>
 #include <util/reflect.hpp>
 #include <algorithm>
 
@@ -87,32 +88,39 @@ COMBINE_FUN(COMBINE_SYMMETRIC_OVERLAY, (Combine<COMBINE_OVERLAY>::f(a,b) + Combi
 
 // ----------------------------------------------------------------------------- : Combining
 
-/// Combine image b onto image a using some combining mode.
-/// The results are stored in the image A.
+// in combine_image_avx2.cpp
+size_t combine_bytes_avx2(Byte* a, const Byte* b, size_t size, ImageCombine combine);
+
+/// Combine as many bytes as possible with vector instructions, returns the number of bytes done
+size_t combine_bytes_vectorized(Byte* a, const Byte* b, size_t size, ImageCombine combine) {
+  #ifdef MSE_SIMD_SSE2
+    static const bool use_avx2 = cpu_has_avx2();
+    size_t done = use_avx2 ? combine_bytes_avx2(a, b, size, combine) : 0;
+    return done + combine_bytes_simd<SimdSSE2>(a + done, b + done, size - done, combine);
+  #else
+    return 0;
+  #endif
+}
+
+/// Combine size bytes of b onto a using some combining mode.
+/// The results are stored in a.
 template <ImageCombine combine>
-void combine_image_do(Image& a, Image b) {
-  UInt size = a.GetWidth() * a.GetHeight() * 3;
-  Byte *dataA = a.GetData(), *dataB = b.GetData();
-  // for each pixel: apply function
-  for (UInt i = 0 ; i < size ; ++i) {
-    dataA[i] = Combine<combine>::f(dataA[i], dataB[i]);
+void combine_bytes_do(Byte* a, const Byte* b, size_t size, bool vectorized) {
+  // vectorized, the results are the same as those of Combine<combine>::f
+  size_t start = vectorized ? combine_bytes_vectorized(a, b, size, combine) : 0;
+  // for each remaining byte: apply function
+  for (size_t i = start ; i < size ; ++i) {
+    a[i] = Combine<combine>::f(a[i], b[i]);
   }
 }
 
-void combine_image(Image& a, const Image& b, ImageCombine combine) {
-  // Images must have same size
-  assert(a.GetWidth()  == b.GetWidth());
-  assert(a.GetHeight() == b.GetHeight());
-  // Copy alpha channel?
-  if (b.HasAlpha()) {
-    if (!a.HasAlpha()) a.InitAlpha();
-    memcpy(a.GetAlpha(), b.GetAlpha(), a.GetWidth() * a.GetHeight());
-  }
-  // Combine image data, by dispatching to combineImageDo
+/// Combine size bytes of b onto a, by dispatching to combine_bytes_do
+/** With vectorized=false only the scalar functions are used, the self tests compare the two */
+void combine_bytes(Byte* a, const Byte* b, size_t size, ImageCombine combine, bool vectorized = true) {
   switch(combine) {
-    #define DISPATCH(comb) case comb: combine_image_do<comb>(a,b); return
+    #define DISPATCH(comb) case comb: combine_bytes_do<comb>(a,b,size,vectorized); return
     case COMBINE_DEFAULT:
-    case COMBINE_NORMAL: a = b; return; // no need to do a per pixel operation
+    case COMBINE_NORMAL: memcpy(a, b, size); return;
     DISPATCH(COMBINE_ADD);
     DISPATCH(COMBINE_SUBTRACT);
     DISPATCH(COMBINE_STAMP);
@@ -136,6 +144,61 @@ void combine_image(Image& a, const Image& b, ImageCombine combine) {
     DISPATCH(COMBINE_XOR);
     DISPATCH(COMBINE_SHADOW);
     DISPATCH(COMBINE_SYMMETRIC_OVERLAY);
+    #undef DISPATCH
+  }
+}
+
+void combine_image(Image& a, const Image& b, ImageCombine combine) {
+  // Images must have same size
+  assert(a.GetWidth()  == b.GetWidth());
+  assert(a.GetHeight() == b.GetHeight());
+  if (combine <= COMBINE_NORMAL) {
+    a = b; // no need to do a per pixel operation
+    return;
+  }
+  // Copy alpha channel?
+  if (b.HasAlpha()) {
+    if (!a.HasAlpha()) a.InitAlpha();
+    memcpy(a.GetAlpha(), b.GetAlpha(), a.GetWidth() * a.GetHeight());
+  }
+  // Combine image data
+  combine_bytes(a.GetData(), b.GetData(), a.GetWidth() * a.GetHeight() * 3, combine);
+}
+
+void combine_image_at(Image& a, const Image& b, int x, int y, ImageCombine combine) {
+  wxRect r = wxRect(x, y, b.GetWidth(), b.GetHeight()).Intersect(wxRect(0, 0, a.GetWidth(), a.GetHeight()));
+  if (r.IsEmpty()) return;
+  int a_width = a.GetWidth(), b_width = b.GetWidth();
+  const Byte* alpha = b.HasAlpha() ? b.GetAlpha() : nullptr;
+  bool mask = !alpha && b.HasMask();
+  Byte mask_r = mask ? b.GetMaskRed()   : 0;
+  Byte mask_g = mask ? b.GetMaskGreen() : 0;
+  Byte mask_b = mask ? b.GetMaskBlue()  : 0;
+  vector<Byte> combined(3 * r.width);
+  for (int j = 0 ; j < r.height ; ++j) {
+    Byte* dataA       = a.GetData() + 3 * ((r.y + j) * a_width + r.x);
+    size_t offset_b   = (r.y - y + j) * b_width + (r.x - x);
+    const Byte* dataB = b.GetData() + 3 * offset_b;
+    if (!alpha && !mask) {
+      combine_bytes(dataA, dataB, 3 * r.width, combine);
+      continue;
+    }
+    // combine, and then blend with what was there, like drawing an image with alpha does
+    memcpy(&combined[0], dataA, 3 * r.width);
+    combine_bytes(&combined[0], dataB, 3 * r.width, combine);
+    for (int i = 0 ; i < r.width ; ++i) {
+      int t;
+      if (alpha) {
+        t = alpha[offset_b + i];
+      } else {
+        const Byte* pb = dataB + 3 * i;
+        t = pb[0] == mask_r && pb[1] == mask_g && pb[2] == mask_b ? 0 : 255;
+      }
+      for (int c = 0 ; c < 3 ; ++c) {
+        Byte& pa = dataA[3 * i + c];
+        pa = (Byte)((combined[3 * i + c] * t + pa * (255 - t)) / 255);
+      }
+    }
   }
 }
 
@@ -0,0 +1,46 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+// The functions in this file use AVX2, they must only be called when cpu_has_avx2().
+// AVX2 is only enabled after the common headers: inline functions from those headers
+// must not be compiled with AVX2, because the linker may use that copy everywhere.
+
+#include <util/prec.hpp>
+#include <gfx/gfx.hpp>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  #include <immintrin.h>
+  #if defined(__clang__)
+    #pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+  #elif defined(__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target("avx2")
+  #endif
+  // MSVC allows AVX2 intrinsics in any function
+  #define MSE_SIMD_AVX2_TARGET 1
+#endif
+
+#include <gfx/combine_image_simd.hpp>
+
+// ----------------------------------------------------------------------------- : Combining
+
+size_t combine_bytes_avx2(Byte* a, const Byte* b, size_t size, ImageCombine combine) {
+  #ifdef MSE_SIMD_AVX2
+    return combine_bytes_simd<SimdAVX2>(a, b, size, combine);
+  #else
+    return 0; // not compiled with AVX2 support
+  #endif
+}
+
+#ifdef MSE_SIMD_AVX2_TARGET
+  #if defined(__clang__)
+    #pragma clang attribute pop
+  #elif defined(__GNUC__)
+    #pragma GCC pop_options
+  #endif
+#endif
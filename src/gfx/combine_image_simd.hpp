@@ -0,0 +1,134 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+/** @file gfx/combine_image_simd.hpp
+ *
+ *  Vectorized versions of the combining functions in combine_image.cpp.
+ *  Every kernel gives exactly the same result as the scalar Combine<mode>::f.
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <gfx/simd.hpp>
+#include <gfx/gfx.hpp>
+
+#ifdef MSE_SIMD_SSE2
+namespace {
+
+// ----------------------------------------------------------------------------- : Combining functions
+
+/// Combining function for instruction set S, works on S::size bytes at a time
+template <typename S, ImageCombine combine> struct CombineSimd;
+
+/// Combining function on bytes
+#define COMBINE_SIMD(combine,fun)                        \
+  template <typename S> struct CombineSimd<S,combine> {  \
+    typedef typename S::V V;                             \
+    static inline V f(V a, V b) { return fun; }          \
+  };
+
+/// Combining function on 16 bit lanes, the result is clamped to [0..255]
+#define COMBINE_SIMD_16(combine,fun)                     \
+  template <typename S> struct CombineSimd<S,combine> {  \
+    typedef typename S::V V;                             \
+    static inline V f(V a, V b) {                        \
+      return S::pack16(f16(S::lo16(a), S::lo16(b)), f16(S::hi16(a), S::hi16(b))); \
+    }                                                    \
+    static inline V f16(V a, V b) { return fun; }        \
+  };
+
+/// x / 255 for 16 bit x <= 255*255
+template <typename S> inline typename S::V div255(typename S::V x) {
+  return S::template shr16<8>(S::add16(S::add16(x, S::set16(1)), S::template shr16<8>(x)));
+}
+/// 255 - x
+template <typename S> inline typename S::V inv16(typename S::V x) {
+  return S::sub16(S::set16(255), x);
+}
+template <typename S> inline typename S::V overlay16(typename S::V a, typename S::V b) {
+  return S::select(S::lt16(a, S::set16(128))
+                  , S::template shr16<7>(S::mul16(a, b))
+                  , inv16<S>(S::template shr16<7>(S::mul16(inv16<S>(a), inv16<S>(b)))));
+}
+
+COMBINE_SIMD   (COMBINE_NORMAL,      b)
+COMBINE_SIMD   (COMBINE_ADD,         S::adds_u8(a, b))
+COMBINE_SIMD   (COMBINE_SUBTRACT,    S::subs_u8(a, b))
+COMBINE_SIMD_16(COMBINE_STAMP,       S::sub16(S::add16(a, S::set16(256)), S::add16(b, b))) // pack16 clamps
+COMBINE_SIMD   (COMBINE_DIFFERENCE,  S::bit_or(S::subs_u8(a, b), S::subs_u8(b, a)))
+COMBINE_SIMD_16(COMBINE_NEGATION,    inv16<S>(S::max16(S::sub16(inv16<S>(a), b), S::sub16(S::add16(a, b), S::set16(255)))))
+COMBINE_SIMD_16(COMBINE_MULTIPLY,    div255<S>(S::mul16(a, b)))
+COMBINE_SIMD   (COMBINE_DARKEN,      S::min_u8(a, b))
+COMBINE_SIMD   (COMBINE_LIGHTEN,     S::max_u8(a, b))
+COMBINE_SIMD_16(COMBINE_COLOR_DODGE, S::muldiv16(a, S::set16(255), inv16<S>(b)))
+COMBINE_SIMD_16(COMBINE_COLOR_BURN,  inv16<S>(S::muldiv16(inv16<S>(a), S::set16(255), b)))
+COMBINE_SIMD_16(COMBINE_SCREEN,      inv16<S>(div255<S>(S::mul16(inv16<S>(a), inv16<S>(b)))))
+COMBINE_SIMD_16(COMBINE_OVERLAY,     overlay16<S>(a, b))
+COMBINE_SIMD_16(COMBINE_HARD_LIGHT,  overlay16<S>(b, a))
+COMBINE_SIMD   (COMBINE_SOFT_LIGHT,  b)
+COMBINE_SIMD_16(COMBINE_REFLECT,     S::muldiv16(a, a, inv16<S>(b)))
+COMBINE_SIMD_16(COMBINE_GLOW,        S::muldiv16(b, b, inv16<S>(a)))
+COMBINE_SIMD_16(COMBINE_FREEZE,      inv16<S>(S::muldiv16(inv16<S>(a), inv16<S>(a), b)))
+COMBINE_SIMD_16(COMBINE_HEAT,        inv16<S>(S::muldiv16(inv16<S>(b), inv16<S>(b), a)))
+COMBINE_SIMD   (COMBINE_AND,         S::bit_and(a, b))
+COMBINE_SIMD   (COMBINE_OR,          S::bit_or(a, b))
+COMBINE_SIMD   (COMBINE_XOR,         S::bit_xor(a, b))
+COMBINE_SIMD_16(COMBINE_SHADOW,      S::muldiv16(S::mul16(a, a), b, S::set16(255 * 255)))
+COMBINE_SIMD_16(COMBINE_SYMMETRIC_OVERLAY, S::template shr16<1>(S::add16(overlay16<S>(a, b), overlay16<S>(b, a))))
+
+#undef COMBINE_SIMD
+#undef COMBINE_SIMD_16
+
+// ----------------------------------------------------------------------------- : Combining
+
+/// Combine the bytes of b onto a, returns the number of bytes done (a multiple of S::size)
+template <typename S, ImageCombine combine>
+size_t combine_bytes_simd(Byte* a, const Byte* b, size_t size) {
+  size_t i = 0;
+  for ( ; i + S::size <= size ; i += S::size) {
+    S::store(a + i, CombineSimd<S,combine>::f(S::load(a + i), S::load(b + i)));
+  }
+  return i;
+}
+
+/// Combine the bytes of b onto a, returns the number of bytes done, the rest should be done by the caller
+template <typename S>
+size_t combine_bytes_simd(Byte* a, const Byte* b, size_t size, ImageCombine combine) {
+  switch (combine) {
+    #define DISPATCH(comb) case comb: return combine_bytes_simd<S,comb>(a, b, size)
+    DISPATCH(COMBINE_NORMAL);
+    DISPATCH(COMBINE_ADD);
+    DISPATCH(COMBINE_SUBTRACT);
+    DISPATCH(COMBINE_STAMP);
+    DISPATCH(COMBINE_DIFFERENCE);
+    DISPATCH(COMBINE_NEGATION);
+    DISPATCH(COMBINE_MULTIPLY);
+    DISPATCH(COMBINE_DARKEN);
+    DISPATCH(COMBINE_LIGHTEN);
+    DISPATCH(COMBINE_COLOR_DODGE);
+    DISPATCH(COMBINE_COLOR_BURN);
+    DISPATCH(COMBINE_SCREEN);
+    DISPATCH(COMBINE_OVERLAY);
+    DISPATCH(COMBINE_HARD_LIGHT);
+    DISPATCH(COMBINE_SOFT_LIGHT);
+    DISPATCH(COMBINE_REFLECT);
+    DISPATCH(COMBINE_GLOW);
+    DISPATCH(COMBINE_FREEZE);
+    DISPATCH(COMBINE_HEAT);
+    DISPATCH(COMBINE_AND);
+    DISPATCH(COMBINE_OR);
+    DISPATCH(COMBINE_XOR);
+    DISPATCH(COMBINE_SHADOW);
+    DISPATCH(COMBINE_SYMMETRIC_OVERLAY);
+    #undef DISPATCH
+    default: return 0;
+  }
+}
+
+} // namespace
+#endif
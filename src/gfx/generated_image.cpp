@@ -10,6 +10,8 @@
 #include <gfx/generated_image.hpp>
 #include <util/io/package.hpp>
 #include <util/error.hpp>
+#include <util/parallel.hpp>
+#include <util/hash.hpp>
 #include <data/symbol.hpp>
 #include <data/field/symbol.hpp>
 #include <render/symbol/filter.hpp>
@@ -24,7 +26,7 @@ GeneratedImageP GeneratedImage::toImage() const {
 }
 
 Image GeneratedImage::generateConform(const Options& options) const {
-  return conform_image(generate(options),options);
+  return generated_image_cache.generateConform(*this, options);
 }
 
 Image conform_image(const Image& img, const GeneratedImage::Options& options) {
@@ -78,6 +80,143 @@ Image conform_image(const Image& img, const GeneratedImage::Options& options) {
   return image;
 }
 
+// ----------------------------------------------------------------------------- : GeneratedImageCache
+
+GeneratedImageCache generated_image_cache;
+
+bool GeneratedImageCache::is_destroyed = false;
+
+GeneratedImageCache::GeneratedImageCache(size_t max_bytes)
+  : max_bytes(max_bytes), bytes(0), hits(0), misses(0), generation(0)
+{}
+
+GeneratedImageCache::~GeneratedImageCache() {
+  is_destroyed = true;
+}
+
+UInt GeneratedImageCache::packageGeneration(const GeneratedImage::Options& options) const {
+  UInt g = generation;
+  auto it = package_generations.find(options.package);
+  if (it != package_generations.end()) g += it->second;
+  if (options.local_package != options.package) {
+    it = package_generations.find(options.local_package);
+    if (it != package_generations.end()) g += it->second;
+  }
+  return g;
+}
+
+/// Are the options the same, as far as generating images is concerned?
+bool same_options(const GeneratedImage::Options& a, const GeneratedImage::Options& b) {
+  return a.width   == b.width   && a.height          == b.height
+      && a.zoom    == b.zoom    && a.angle           == b.angle
+      && a.package == b.package && a.local_package   == b.local_package
+      && a.saturate == b.saturate && a.preserve_aspect == b.preserve_aspect;
+}
+
+Image GeneratedImageCache::generateConform(const GeneratedImage& image, const GeneratedImage::Options& options) {
+  if (image.isBlank()) {
+    // not worth caching
+    return conform_image(image.generate(options), options);
+  }
+  size_t h = image.hash();
+  hash_combine(h, options.width);
+  hash_combine(h, options.height);
+  hash_combine(h, options.zoom);
+  hash_combine(h, options.angle);
+  hash_combine(h, (void*)options.package);
+  hash_combine(h, (void*)options.local_package);
+  hash_combine(h, options.saturate);
+  hash_combine(h, (int)options.preserve_aspect);
+  UInt start_generation;
+  {
+    wxMutexLocker l(lock);
+    auto range = index.equal_range(h);
+    for (auto it = range.first ; it != range.second ; ++it) {
+      Entry& e = *it->second;
+      if (same_options(e.options, options) && *e.image == image) {
+        ++hits;
+        entries.splice(entries.begin(), entries, it->second); // most recently used
+        options.width  = e.width;
+        options.height = e.height;
+        return e.result.Copy();
+      }
+    }
+    ++misses;
+    start_generation = packageGeneration(options);
+  }
+  // generate without holding the lock, other threads may generate the same image in the meantime
+  GeneratedImage::Options key_options = options;
+  Image result = conform_image(image.generate(options), options);
+  if (!result.Ok()) return result;
+  size_t result_bytes = (size_t)result.GetWidth() * result.GetHeight() * (result.HasAlpha() ? 4 : 3);
+  {
+    wxMutexLocker l(lock);
+    if (result_bytes > max_bytes / 4) return result; // too large to cache
+    if (packageGeneration(key_options) != start_generation) return result; // a package was destroyed or the cache cleared in the meantime
+    auto range = index.equal_range(h);
+    for (auto it = range.first ; it != range.second ; ++it) {
+      Entry& e = *it->second;
+      if (same_options(e.options, key_options) && *e.image == image) {
+        return result; // already added by another thread
+      }
+    }
+    Entry e = { h, image.toImage(), key_options, options.width, options.height, result.Copy(), result_bytes };
+    entries.push_front(e);
+    index.insert(make_pair(h, entries.begin()));
+    bytes += result_bytes;
+    shrink(max_bytes);
+  }
+  return result;
+}
+
+void GeneratedImageCache::remove(EntryIt entry) {
+  auto range = index.equal_range(entry->hash);
+  for (auto it = range.first ; it != range.second ; ++it) {
+    if (it->second == entry) {
+      index.erase(it);
+      break;
+    }
+  }
+  bytes -= entry->bytes;
+  entries.erase(entry);
+}
+
+void GeneratedImageCache::shrink(size_t budget) {
+  while (bytes > budget && !entries.empty()) {
+    remove(--entries.end());
+  }
+}
+
+void GeneratedImageCache::clear() {
+  wxMutexLocker l(lock);
+  ++generation;
+  shrink(0);
+}
+
+void GeneratedImageCache::forgetPackage(const Package* package) {
+  wxMutexLocker l(lock);
+  ++package_generations[package];
+  for (EntryIt it = entries.begin() ; it != entries.end() ; ) {
+    EntryIt next = it; ++next;
+    if (it->options.package == package || it->options.local_package == package) {
+      remove(it);
+    }
+    it = next;
+  }
+}
+
+void GeneratedImageCache::setMaxBytes(size_t max_bytes) {
+  wxMutexLocker l(lock);
+  this->max_bytes = max_bytes;
+  shrink(max_bytes);
+}
+
+GeneratedImageCache::Stats GeneratedImageCache::stats() const {
+  wxMutexLocker l(lock);
+  Stats s = { hits, misses, entries.size(), bytes };
+  return s;
+}
+
 // ----------------------------------------------------------------------------- : BlankImage
 
 Image BlankImage::generate(const Options& opt) const {
@@ -93,6 +232,10 @@ bool BlankImage::operator == (const GeneratedImage& that) const {
   const BlankImage* that2 = dynamic_cast<const BlankImage*>(&that);
   return that2;
 }
+size_t BlankImage::hash() const {
+  size_t h = hash_start(*this);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : LinearBlendImage
 
@@ -111,6 +254,16 @@ bool LinearBlendImage::operator == (const GeneratedImage& that) const {
                && x1 == that2->x1 && y1 == that2->y1
                && x2 == that2->x2 && y2 == that2->y2;
 }
+size_t LinearBlendImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image1->hash());
+  hash_combine(h, image2->hash());
+  hash_combine(h, x1);
+  hash_combine(h, y1);
+  hash_combine(h, x2);
+  hash_combine(h, y2);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : MaskedBlendImage
 
@@ -128,6 +281,13 @@ bool MaskedBlendImage::operator == (const GeneratedImage& that) const {
                && *dark  == *that2->dark
                && *mask  == *that2->mask;
 }
+size_t MaskedBlendImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, light->hash());
+  hash_combine(h, dark->hash());
+  hash_combine(h, mask->hash());
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : CombineBlendImage
 
@@ -145,6 +305,49 @@ bool CombineBlendImage::operator == (const GeneratedImage& that) const {
                && *image2 == *that2->image2
                && image_combine == that2->image_combine;
 }
+size_t CombineBlendImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image1->hash());
+  hash_combine(h, image2->hash());
+  hash_combine(h, (int)image_combine);
+  return h;
+}
+
+// ----------------------------------------------------------------------------- : SimpleFilterImage
+
+Image SimpleFilterImage::generatePointwise(const Options& opt) const {
+  // the chain of pointwise filters, outermost first
+  vector<const SimpleFilterImage*> filters;
+  const GeneratedImage* base = this;
+  bool adds_alpha = false;
+  while (const SimpleFilterImage* filter = dynamic_cast<const SimpleFilterImage*>(base)) {
+    if (!filter->pointwise()) break;
+    filters.push_back(filter);
+    adds_alpha |= filter->addsAlpha();
+    base = filter->image.get();
+  }
+  Image img = base->generate(opt);
+  size_t n = size_t(img.GetWidth()) * img.GetHeight();
+  if (adds_alpha && !img.HasAlpha()) {
+    // like set_alpha, start with an opaque alpha channel, also where the image has a mask
+    img.InitAlpha();
+    memset(img.GetAlpha(), 255, n);
+  }
+  Byte* data  = img.GetData();
+  Byte* alpha = img.HasAlpha() ? img.GetAlpha() : nullptr;
+  // apply all filters to a block of pixels before moving on to the next block, so the block stays in the cache
+  const size_t block = 4096;
+  int blocks = int((n + block - 1) / block);
+  parallel_for(blocks, 16, [&](int block_begin, int block_end) {
+    for (size_t i = block_begin * block ; i < n && i < block_end * block ; i += block) {
+      size_t count = min(block, n - i);
+      for (auto it = filters.rbegin() ; it != filters.rend() ; ++it) {
+        (*it)->filterPixels(data + 3 * i, alpha ? alpha + i : nullptr, count);
+      }
+    }
+  });
+  return img;
+}
 
 // ----------------------------------------------------------------------------- : SetMaskImage
 
@@ -158,22 +361,36 @@ bool SetMaskImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && *mask  == *that2->mask;
 }
+size_t SetMaskImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, mask->hash());
+  return h;
+}
 
 Image SetAlphaImage::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  set_alpha(img, alpha);
-  return img;
+  return generatePointwise(opt);
+}
+void SetAlphaImage::filterPixels(Byte* data, Byte* alpha_data, size_t n) const {
+  // an image without alpha channel gets one of 255 (see generatePointwise), multiplying that is the same as set_alpha
+  multiply_alpha(alpha_data, n, Byte(alpha * 255));
 }
 bool SetAlphaImage::operator == (const GeneratedImage& that) const {
   const SetAlphaImage* that2 = dynamic_cast<const SetAlphaImage*>(&that);
   return that2 && *image == *that2->image
                && alpha  == that2->alpha;
 }
+size_t SetAlphaImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, alpha);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : SetCombineImage
 
 Image SetCombineImage::generate(const Options& opt) const {
-  return image->generate(opt);
+  return generatePointwise(opt);
 }
 ImageCombine SetCombineImage::combine() const {
   return image_combine;
@@ -183,49 +400,76 @@ bool SetCombineImage::operator == (const GeneratedImage& that) const {
   return that2 && *image == *that2->image
                && image_combine == that2->image_combine;
 }
+size_t SetCombineImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, (int)image_combine);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : SaturateImage
 
 Image SaturateImage::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  saturate(img, amount);
-  return img;
+  return generatePointwise(opt);
+}
+void SaturateImage::filterPixels(Byte* data, Byte* alpha, size_t n) const {
+  saturate(data, n, amount);
 }
 bool SaturateImage::operator == (const GeneratedImage& that) const {
   const SaturateImage* that2 = dynamic_cast<const SaturateImage*>(&that);
   return that2 && *image == *that2->image
                && amount == that2->amount;
 }
+size_t SaturateImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, amount);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : InvertImage
 
 Image InvertImage::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  invert(img);
-  return img;
+  return generatePointwise(opt);
+}
+void InvertImage::filterPixels(Byte* data, Byte* alpha, size_t n) const {
+  invert(data, n);
 }
 bool InvertImage::operator == (const GeneratedImage& that) const {
   const InvertImage* that2 = dynamic_cast<const InvertImage*>(&that);
   return that2 && *image == *that2->image;
 }
+size_t InvertImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : RecolorImage
 
 Image RecolorImage::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  recolor(img, color);
-  return img;
+  return generatePointwise(opt);
+}
+void RecolorImage::filterPixels(Byte* data, Byte* alpha, size_t n) const {
+  recolor((RGB*)data, n, color);
 }
 bool RecolorImage::operator == (const GeneratedImage& that) const {
   const RecolorImage* that2 = dynamic_cast<const RecolorImage*>(&that);
   return that2 && *image == *that2->image
                && color == that2->color;
 }
+size_t RecolorImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, color.packed);
+  return h;
+}
 
 Image RecolorImage2::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  recolor(img, red,green,blue,white);
-  return img;
+  return generatePointwise(opt);
+}
+void RecolorImage2::filterPixels(Byte* data, Byte* alpha, size_t n) const {
+  recolor((RGB*)data, n, red,green,blue,white);
 }
 bool RecolorImage2::operator == (const GeneratedImage& that) const {
   const RecolorImage2* that2 = dynamic_cast<const RecolorImage2*>(&that);
@@ -235,36 +479,73 @@ bool RecolorImage2::operator == (const GeneratedImage& that) const {
                && blue == that2->blue
                && white == that2->white;
 }
+size_t RecolorImage2::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, red.packed);
+  hash_combine(h, green.packed);
+  hash_combine(h, blue.packed);
+  hash_combine(h, white.packed);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : FlipImage
 
 Image FlipImageHorizontal::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  return flip_image_horizontal(img);
+  return generateView(opt).toImage();
+}
+ImageView FlipImageHorizontal::generateView(const Options& opt) const {
+  return image->generateView(opt).flipHorizontal();
 }
 bool FlipImageHorizontal::operator == (const GeneratedImage& that) const {
   const FlipImageHorizontal* that2 = dynamic_cast<const FlipImageHorizontal*>(&that);
   return that2 && *image == *that2->image;
 }
+size_t FlipImageHorizontal::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  return h;
+}
 
 Image FlipImageVertical::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  return flip_image_vertical(img);
+  return generateView(opt).toImage();
+}
+ImageView FlipImageVertical::generateView(const Options& opt) const {
+  return image->generateView(opt).flipVertical();
 }
 bool FlipImageVertical::operator == (const GeneratedImage& that) const {
   const FlipImageVertical* that2 = dynamic_cast<const FlipImageVertical*>(&that);
   return that2 && *image == *that2->image;
 }
+size_t FlipImageVertical::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  return h;
+}
 
 Image RotateImage::generate(const Options& opt) const {
-  Image img = image->generate(opt);
-  return rotate_image(img,angle);
+  return generateView(opt).toImage();
+}
+ImageView RotateImage::generateView(const Options& opt) const {
+  ImageView view = image->generateView(opt);
+  Radians a = constrain_radians(angle);
+  if (is_rad0(a))   return view;
+  if (is_rad90(a))  return view.rotate90();
+  if (is_rad180(a)) return view.rotate180();
+  if (is_rad270(a)) return view.rotate270();
+  return ImageView(rotate_image(view.toImage(), angle));
 }
 bool RotateImage::operator == (const GeneratedImage& that) const {
   const RotateImage* that2 = dynamic_cast<const RotateImage*>(&that);
   return that2 && *image == *that2->image
                && angle == that2->angle;
 }
+size_t RotateImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, angle);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : EnlargeImage
 
@@ -303,11 +584,27 @@ bool EnlargeImage::operator == (const GeneratedImage& that) const {
   return that2 && *image      == *that2->image
                && border_size == that2->border_size;
 }
+size_t EnlargeImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, border_size);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : CropImage
 
 Image CropImage::generate(const Options& opt) const {
-  return image->generate(opt).Size(wxSize((int)width, (int)height), wxPoint(-(int)offset_x, -(int)offset_y));
+  return generateView(opt).toImage();
+}
+ImageView CropImage::generateView(const Options& opt) const {
+  ImageView view = image->generateView(opt);
+  int x = (int)offset_x, y = (int)offset_y, w = (int)width, h = (int)height;
+  if (x >= 0 && y >= 0 && w > 0 && h > 0 && x + w <= view.GetWidth() && y + h <= view.GetHeight()) {
+    return view.crop(x, y, w, h);
+  } else {
+    // part of the result is outside the image, let wxImage fill that in
+    return ImageView(view.toImage().Size(wxSize(w, h), wxPoint(-x, -y)));
+  }
 }
 bool CropImage::operator == (const GeneratedImage& that) const {
   const CropImage* that2 = dynamic_cast<const CropImage*>(&that);
@@ -315,58 +612,18 @@ bool CropImage::operator == (const GeneratedImage& that) const {
                && width    == that2->width    && height   == that2->height
                && offset_x == that2->offset_x && offset_y == that2->offset_y;
 }
+size_t CropImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, width);
+  hash_combine(h, height);
+  hash_combine(h, offset_x);
+  hash_combine(h, offset_y);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : DropShadowImage
 
-/// Preform a gaussian blur, from the image in of w*h bytes to out
-/** out is scaled some scaling, this is the return value */
-UInt gaussian_blur(Byte* in, UInt* out, int w, int h, double radius) {
-  // blur horizontally
-  auto blur_x = make_unique<UInt[]>(w*h); // scaled by total_x, so in [0..255*total_x]
-  memset(blur_x.get(), 0, w*h*sizeof(UInt));
-  UInt total_x = 0;
-  {
-    double sigma = radius * w;
-    double mult = (1 << 8) / (sqrt(2 * M_PI) * sigma);
-    double sigsqr2 = 1 / (2 * sigma * sigma);
-    int range = min(w, (int)(3*sigma));
-    for (int d = -range ; d <= range ; ++d) {
-      UInt factor = (int)( mult * exp(-d * d * sigsqr2) );
-      total_x += factor;
-      if (factor > 0) {
-        int x_start = max(0, -d), x_end = min(w, w-d);
-        for (int y = 0 ; y < h ; ++y) {
-          for (int x = x_start ; x < x_end ; ++x) {
-            blur_x[x + y*w] += in[x + d + y*w] * factor;
-          }
-        }
-      }
-    }
-  }
-  // blur vertically
-  memset(out, 0, w*h*sizeof(UInt));
-  UInt total_y = 0;
-  {
-    double sigma = radius * h;
-    double mult = (1 << 8) / (sqrt(2 * M_PI) * sigma);
-    double sigsqr2 = 1 / (2 * sigma * sigma);
-    int range = min(h, (int)(3*sigma));
-    for (int d = -range ; d <= range ; ++d) {
-      UInt factor = (UInt)( mult * exp(-d * d * sigsqr2) );
-      total_y += factor;
-      if (factor > 0) {
-        int y_start = max(0, -d), y_end = min(h, h-d);
-        for (int y = y_start ; y < y_end ; ++y) {
-          for (int x = 0 ; x < w ; ++x) {
-            out[x + y*w] += blur_x[x + (d + y)*w] * factor;
-          }
-        }
-      }
-    }
-  }
-  return total_x * total_y;
-}
-
 Image DropShadowImage::generate(const Options& opt) const {
   // sub image
   Image img = image->generate(opt);
@@ -377,8 +634,8 @@ Image DropShadowImage::generate(const Options& opt) const {
   int w = img.GetWidth(), h = img.GetHeight();
   Byte* alpha = img.GetAlpha();
   // blur
-  auto shadow = make_unique<UInt[]>(w*h);
-  UInt total = 255 * gaussian_blur(alpha, shadow.get(), w, h, shadow_blur_radius);
+  vector<Byte> shadow(alpha, alpha + w*h);
+  gaussian_blur(&shadow[0], w, h, shadow_blur_radius * w, shadow_blur_radius * h);
   // combine
   Byte* data = img.GetData();
   int dw = int(w * offset_x), dh = int(h * offset_y);
@@ -390,7 +647,7 @@ Image DropShadowImage::generate(const Options& opt) const {
     for (int x = x_start ; x < x_end ; ++x) {
       int p  = x + y * w; // pixel we are working on
       int a = alpha[p];
-      int shad = ((((255 - a)*sa)>>16) * shadow[p - delta]) / total; // amount of shadow to add
+      int shad = ((((255 - a)*sa)>>16) * shadow[p - delta]) / 255; // amount of shadow to add
       int factor = max(1, a + shad); // divide by this
       data[3 * p    ] = (a * data[3 * p    ] + shad * shadow_color.Red()  ) / factor;
       data[3 * p + 1] = (a * data[3 * p + 1] + shad * shadow_color.Green()) / factor;
@@ -407,6 +664,16 @@ bool DropShadowImage::operator == (const GeneratedImage& that) const {
                && shadow_alpha == that2->shadow_alpha && shadow_blur_radius == that2->shadow_blur_radius
                && shadow_color == that2->shadow_color;
 }
+size_t DropShadowImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, image->hash());
+  hash_combine(h, offset_x);
+  hash_combine(h, offset_y);
+  hash_combine(h, shadow_alpha);
+  hash_combine(h, shadow_blur_radius);
+  hash_combine(h, shadow_color.packed);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : PackagedImage
 
@@ -427,6 +694,11 @@ bool PackagedImage::operator == (const GeneratedImage& that) const {
   const PackagedImage* that2 = dynamic_cast<const PackagedImage*>(&that);
   return that2 && filename == that2->filename;
 }
+size_t PackagedImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, filename);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : BuiltInImage
 
@@ -442,6 +714,11 @@ bool BuiltInImage::operator == (const GeneratedImage& that) const {
   const BuiltInImage* that2 = dynamic_cast<const BuiltInImage*>(&that);
   return that2 && name == that2->name;
 }
+size_t BuiltInImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, name);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : SymbolToImage
 
@@ -478,6 +755,15 @@ bool SymbolToImage::operator == (const GeneratedImage& that) const {
                    *variation == *that2->variation // custom variation
                   );
 }
+size_t SymbolToImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, is_local);
+  hash_combine(h, filename.toStringForKey());
+  hash_combine(h, age.get());
+  hash_combine(h, variation->name);
+  hash_combine(h, variation->border_radius);
+  return h;
+}
 
 // ----------------------------------------------------------------------------- : ImageValueToImage
 
@@ -504,3 +790,9 @@ bool ImageValueToImage::operator == (const GeneratedImage& that) const {
   return that2 && filename == that2->filename
                && age      == that2->age;
 }
+size_t ImageValueToImage::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, filename.toStringForKey());
+  hash_combine(h, age.get());
+  return h;
+}
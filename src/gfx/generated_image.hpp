@@ -13,6 +13,8 @@
 #include <util/io/package.hpp>
 #include <gfx/gfx.hpp>
 #include <script/value.hpp>
+#include <wx/thread.h>
+#include <list>
 
 DECLARE_POINTER_TYPE(GeneratedImage);
 DECLARE_POINTER_TYPE(SymbolVariation);
@@ -47,11 +49,18 @@ public:
   Image generateConform(const Options&) const;
   /// Generate the image
   virtual Image generate(const Options&) const = 0;
+  /// Generate the image as a view
+  /** Cropping, flipping and rotating images override this to change the view of the underlying image,
+   *  then the pixels are only copied once, at the end of a chain of such images.
+   */
+  virtual ImageView generateView(const Options& opt) const { return ImageView(generate(opt)); }
   /// How must the image be combined with the background?
   virtual ImageCombine combine() const { return COMBINE_DEFAULT; }
   /// Equality should mean that every pixel in the generated images is the same if the same options are used
   virtual bool operator == (const GeneratedImage& that) const = 0;
   inline  bool operator != (const GeneratedImage& that) const { return !(*this == that); }
+  /// Hash of the structure of this image, equal images must have the same hash
+  virtual size_t hash() const = 0;
   
   /// Can this image be generated safely from another thread?
   virtual bool threadSafe() const { return true; }
@@ -68,6 +77,82 @@ public:
 /// Resize an image to conform to the options
 Image conform_image(const Image&, const GeneratedImage::Options&);
 
+// ----------------------------------------------------------------------------- : GeneratedImageCache
+
+/// A cache of generated images, shared by the card viewers, thumbnails and exports
+/** Images are found by the structure of the GeneratedImage (operator == and hash) and the options,
+ *  so the same image expression used on different cards or styles is only generated once.
+ *  When the images take up more than the memory budget, the least recently used ones are discarded.
+ *
+ *  The options refer to packages by pointer, so entries for a package are removed when it is destroyed
+ *  (see forgetPackage), before another package can be allocated at the same address.
+ *
+ *  The cache can be used from multiple threads.
+ *  It stores and returns deep copies, so the returned images can be modified
+ *  (CachedScriptableImage applies masks to them in place).
+ *  A hit therefore still costs a copy of width*height*4 bytes, which is small compared to generating,
+ *  but not free for large card sizes.
+ */
+class GeneratedImageCache {
+public:
+  GeneratedImageCache(size_t max_bytes = 128 << 20);
+  ~GeneratedImageCache();
+  
+  /// Has the global cache been destroyed? Packages that are destroyed after it must not use it
+  static inline bool destroyed() { return is_destroyed; }
+  
+  /// Generate an image conforming to the options, or get it from the cache
+  /** Like GeneratedImage::generateConform, so options.width/height are set to the actual size */
+  Image generateConform(const GeneratedImage& image, const GeneratedImage::Options& options);
+  
+  /// Remove all images from the cache
+  void clear();
+  /// Remove all images that were generated from the given package, called when it is destroyed
+  void forgetPackage(const Package* package);
+  /// Change the memory budget, in bytes
+  void setMaxBytes(size_t max_bytes);
+  
+  /// Statistics about the use of the cache
+  struct Stats {
+    size_t hits;    ///< Number of images found in the cache
+    size_t misses;  ///< Number of images that had to be generated
+    size_t entries; ///< Number of images currently in the cache
+    size_t bytes;   ///< Memory used by those images
+  };
+  Stats stats() const;
+  
+private:
+  struct Entry {
+    size_t                  hash;
+    GeneratedImageP         image;
+    GeneratedImage::Options options;       ///< Options used to generate the image
+    int                     width, height; ///< Size after conforming, before rotating
+    Image                   result;
+    size_t                  bytes;
+  };
+  typedef list<Entry>::iterator EntryIt;
+  
+  mutable wxMutex lock;
+  list<Entry> entries;                    ///< Most recently used first
+  unordered_multimap<size_t,EntryIt> index; ///< Entries by hash
+  size_t max_bytes;
+  size_t bytes;
+  size_t hits, misses;
+  UInt generation;                                       ///< Incremented by clear()
+  unordered_map<const Package*,UInt> package_generations; ///< Incremented by forgetPackage()
+  static bool is_destroyed;
+  
+  /// Generation of the packages used by the options, it changes when they are forgotten. Lock must be held.
+  UInt packageGeneration(const GeneratedImage::Options& options) const;
+  /// Remove least recently used entries until at most budget bytes are used. Lock must be held.
+  void shrink(size_t budget);
+  /// Remove an entry. Lock must be held.
+  void remove(EntryIt entry);
+};
+
+/// The global generated image cache
+extern GeneratedImageCache generated_image_cache;
+
 // ----------------------------------------------------------------------------- : SimpleFilterImage
 
 /// Apply some filter to a single image
@@ -78,8 +163,23 @@ public:
   {}
   ImageCombine combine() const override { return image->combine(); }
   bool local() const override { return image->local(); }
+  
+  /// Is this a pointwise filter, where each output pixel only depends on the same input pixel?
+  /** Pointwise filters implement filterPixels, and generate using generatePointwise. */
+  virtual bool pointwise() const { return false; }
+  /// Apply a pointwise filter to n pixels
+  /** alpha is nullptr if the image has no alpha channel. */
+  virtual void filterPixels(Byte* data, Byte* alpha, size_t n) const {}
+  /// Does this pointwise filter give the image an alpha channel?
+  virtual bool addsAlpha() const { return false; }
 protected:
   GeneratedImageP image;
+  
+  /// Generate the image by applying all pointwise filters, from this one down to the first other image
+  /** The filters are fused: they are applied one block of pixels at a time, in a single pass over the image.
+   *  Only the first image that is not a pointwise filter is generated as an intermediate Image.
+   */
+  Image generatePointwise(const Options& opt) const;
 };
 
 // ----------------------------------------------------------------------------- : BlankImage
@@ -89,6 +189,7 @@ class BlankImage : public GeneratedImage {
 public:
   Image generate(const Options&) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
   bool isBlank() const override { return true; }
   
   // Why is this not thread safe? What is GTK smoking?
@@ -108,6 +209,7 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
   bool local() const override { return image1->local() && image2->local(); }
 private:
   GeneratedImageP image1, image2;
@@ -125,6 +227,7 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
   bool local() const override { return light->local() && dark->local() && mask->local(); }
 private:
   GeneratedImageP light, dark, mask;
@@ -141,6 +244,7 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
   bool local() const override { return image1->local() && image2->local(); }
 private:
   GeneratedImageP image1, image2;
@@ -157,6 +261,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 private:
   GeneratedImageP mask;
 };
@@ -169,6 +274,10 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
+  bool pointwise() const override { return true; }
+  void filterPixels(Byte* data, Byte* alpha, size_t n) const override;
+  bool addsAlpha() const override { return true; }
 private:
   double alpha;
 };
@@ -184,6 +293,8 @@ public:
   Image generate(const Options& opt) const override;
   ImageCombine combine() const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
+  bool pointwise() const override { return true; }
 private:
   ImageCombine image_combine;
 };
@@ -198,6 +309,9 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
+  bool pointwise() const override { return true; }
+  void filterPixels(Byte* data, Byte* alpha, size_t n) const override;
 private:
   double amount;
 };
@@ -212,6 +326,9 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
+  bool pointwise() const override { return true; }
+  void filterPixels(Byte* data, Byte* alpha, size_t n) const override;
 };
 
 // ----------------------------------------------------------------------------- : RecolorImage
@@ -224,6 +341,9 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
+  bool pointwise() const override { return true; }
+  void filterPixels(Byte* data, Byte* alpha, size_t n) const override;
 private:
   Color color;
 };
@@ -235,6 +355,9 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
+  bool pointwise() const override { return true; }
+  void filterPixels(Byte* data, Byte* alpha, size_t n) const override;
 private:
   Color red,green,blue,white;
 };
@@ -248,7 +371,9 @@ public:
     : SimpleFilterImage(image)
   {}
   Image generate(const Options& opt) const override;
+  ImageView generateView(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 };
 
 /// Flip an image vertically
@@ -258,7 +383,9 @@ public:
     : SimpleFilterImage(image)
   {}
   Image generate(const Options& opt) const override;
+  ImageView generateView(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 };
 
 /// Rotate an image
@@ -268,7 +395,9 @@ public:
     : SimpleFilterImage(image), angle(angle)
   {}
   Image generate(const Options& opt) const override;
+  ImageView generateView(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 private:
   Radians angle;
 };
@@ -283,6 +412,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 private:
   double border_size;
 };
@@ -296,7 +426,9 @@ public:
     : SimpleFilterImage(image), width(width), height(height), offset_x(offset_x), offset_y(offset_y)
   {}
   Image generate(const Options& opt) const override;
+  ImageView generateView(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 private:
   double width, height;
   double offset_x, offset_y;
@@ -313,6 +445,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 private:
   double offset_x, offset_y;
   double shadow_alpha;
@@ -330,6 +463,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 private:
   String filename;
 };
@@ -344,6 +478,7 @@ public:
   {}
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
 private:
   String name;
 };
@@ -357,11 +492,9 @@ public:
   ~SymbolToImage();
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
   bool local() const override { return is_local; }
-  
-  #ifdef __WXGTK__
-    bool threadSafe() const override { return false; }
-  #endif
+  // note: threadSafe, symbols are drawn without a DC, see render_symbol
 private:
   SymbolToImage(const SymbolToImage&); // copy ctor
   bool             is_local; ///< Use local package?
@@ -379,6 +512,7 @@ public:
   ~ImageValueToImage();
   Image generate(const Options& opt) const override;
   bool operator == (const GeneratedImage& that) const override;
+  size_t hash() const override;
   bool local() const override { return true; }
 private:
   ImageValueToImage(const ImageValueToImage&); // copy ctor
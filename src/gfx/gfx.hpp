@@ -67,6 +67,36 @@ Image flip_image_horizontal(const Image& image);
 /// Flip an image vertically
 Image flip_image_vertical(const Image& image);
 
+/// A view of a part of an image, possibly flipped and/or rotated by a multiple of 90 degrees
+/** Cropping, flipping and rotating a view doesn't copy any pixels, they are only copied by toImage().
+ *  Pixel (x,y) of the view is pixel number offset + x * step_x + y * step_y of the image.
+ */
+class ImageView {
+public:
+  ImageView() : width(0), height(0), offset(0), step_x(0), step_y(0) {}
+  ImageView(const Image& image);
+  
+  inline int GetWidth()  const { return width; }
+  inline int GetHeight() const { return height; }
+  
+  /// The pixels of the view as an image, this copies them unless the view is the whole image
+  Image toImage() const;
+  
+  /// A part of this view, the rectangle must be inside the view
+  ImageView crop(int x, int y, int width, int height) const;
+  ImageView flipHorizontal() const;
+  ImageView flipVertical() const;
+  /// Rotate counter clockwise, like rotate_image
+  ImageView rotate90() const;
+  ImageView rotate180() const;
+  ImageView rotate270() const;
+  
+private:
+  Image image;
+  int width, height;
+  ptrdiff_t offset, step_x, step_y;
+};
+
 // ----------------------------------------------------------------------------- : Blending
 
 /// Blends two images together using some linear gradient
@@ -87,9 +117,20 @@ void mask_blend(Image& img1, const Image& img2, const Image& mask);
 
 /// Saturate an image
 void saturate(Image& image, double amount);
+/// Saturate n pixels of RGB data
+void saturate(Byte* data, size_t n, double amount);
 
 /// Invert the colors in an image
 void invert(Image& img);
+/// Invert n pixels of RGB data
+void invert(Byte* data, size_t n);
+
+/// Blur an array of width*height bytes (such as an alpha channel) with an approximate gaussian
+/** sigma_x and sigma_y are the standard deviations in pixels.
+ *  Values outside the array count as 0, or if clamp_edges as the nearest value at the edge.
+ *  The time taken does not depend on sigma.
+ */
+void gaussian_blur(Byte* data, int width, int height, double sigma_x, double sigma_y, bool clamp_edges = false);
 
 // ----------------------------------------------------------------------------- : Combining
 
@@ -129,6 +170,11 @@ enum ImageCombine
 /// drawn onto the area where A originated.
 void combine_image(Image& a, const Image& b, ImageCombine combine);
 
+/// Combine image b onto image a at position (x,y) using some combining function.
+/// The result is blended with a using the alpha channel (or mask) of b,
+/// so this is like draw_combine_image with a DC containing a.
+void combine_image_at(Image& a, const Image& b, int x, int y, ImageCombine combine);
+
 /// Draw an image to a DC using a combining function
 void draw_combine_image(DC& dc, UInt x, UInt y, const Image& img, ImageCombine combine);
 
@@ -140,6 +186,8 @@ void set_alpha(Image& img, const Image& img_alpha);
 void set_alpha(Image& img, Byte* alphas, const wxSize& alphas_size);
 /// Set the transparency of img
 void set_alpha(Image& img, double alpha);
+/// Multiply n alpha values by alpha/255
+void multiply_alpha(Byte* alphas, size_t n, Byte alpha);
 
 /// An alpha mask is an alpha channel that can be copied to another image
 /** It is created by treating black in the source image as transparent and white (red) as opaque
@@ -190,3 +238,21 @@ private:
   void loadRowSizes() const;
 };
 
+
+// ----------------------------------------------------------------------------- : QOI images
+
+/// Encode an image in the QOI format ("Quite OK Image", see https://qoiformat.org)
+/** QOI is lossless like PNG, but it is much faster to encode and decode, at the cost of larger files.
+ *  The alpha channel (or mask) is stored if the image has one.
+ */
+void qoi_encode(const Image& img, vector<Byte>& out);
+/// Decode an image in the QOI format, returns false if the data is not a valid QOI image
+bool qoi_decode(const Byte* data, size_t size, Image& img);
+/// Does the data start with the QOI magic number?
+bool qoi_is_image(const Byte* data, size_t size);
+
+/// Bitmap type of the QOI image handler
+const wxBitmapType BITMAP_TYPE_QOI = wxBitmapType(wxBITMAP_TYPE_MAX + 1);
+
+/// Register an image handler for QOI files, so they can be loaded and saved like other images
+void init_qoi_image_handler();
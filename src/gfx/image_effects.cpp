@@ -13,8 +13,11 @@
 // ----------------------------------------------------------------------------- : Saturation
 
 void saturate(Image& image, double amount) {
-  Byte* pix = image.GetData();
-  Byte* end = pix + image.GetWidth() * image.GetHeight() * 3;
+  saturate(image.GetData(), image.GetWidth() * image.GetHeight(), amount);
+}
+
+void saturate(Byte* pix, size_t n, double amount) {
+  Byte* end = pix + n * 3;
   // the formula for saturation is
   //   rgb' = (rgb - amount * avg) / (1 - amount)
   // if amount >= 1 then this is some kind of inversion
@@ -64,9 +67,12 @@ void saturate(Image& image, double amount) {
 // ----------------------------------------------------------------------------- : Color inversion
 
 void invert(Image& img) {
-  Byte* data = img.GetData();
-  int n = 3 * img.GetWidth() * img.GetHeight();
-  for (int i = 0 ; i < n ; ++i) {
+  invert(img.GetData(), img.GetWidth() * img.GetHeight());
+}
+
+void invert(Byte* data, size_t n) {
+  n *= 3;
+  for (size_t i = 0 ; i < n ; ++i) {
     data[i] = 255 - data[i];
   }
 }
@@ -93,9 +99,11 @@ RGB recolor(RGB x, RGB cr, RGB cg, RGB cb, RGB cw) {
 }
 
 void recolor(Image& img, RGB cr, RGB cg, RGB cb, RGB cw) {
-  RGB* data = (RGB*)img.GetData();
-  int n = img.GetWidth() * img.GetHeight();
-  for (int i = 0 ; i < n ; ++i) {
+  recolor((RGB*)img.GetData(), img.GetWidth() * img.GetHeight(), cr, cg, cb, cw);
+}
+
+void recolor(RGB* data, size_t n, RGB cr, RGB cg, RGB cb, RGB cw) {
+  for (size_t i = 0 ; i < n ; ++i) {
     data[i] = recolor(data[i], cr, cg, cb, cw);
   }
 }
@@ -105,8 +113,12 @@ Byte to_grayscale(RGB x) {
 }
 
 void recolor(Image& img, RGB cr) {
+  recolor((RGB*)img.GetData(), img.GetWidth() * img.GetHeight(), cr);
+}
+
+void recolor(RGB* data, size_t n, RGB cr) {
   RGB black(0,0,0), white(255,255,255);
   bool dark = to_grayscale(cr) < 100;
-  recolor(img, cr, dark ? black : white, dark ? white : black, white);
+  recolor(data, n, cr, dark ? black : white, dark ? white : black, white);
 }
 
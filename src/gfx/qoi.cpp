@@ -0,0 +1,248 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/gfx.hpp>
+#include <wx/stream.h>
+
+// ----------------------------------------------------------------------------- : QOI format
+
+// See https://qoiformat.org/qoi-specification.pdf
+// A file is a 14 byte header, followed by a sequence of chunks, followed by an end marker.
+
+const Byte QOI_OP_INDEX = 0x00; // 00xxxxxx
+const Byte QOI_OP_DIFF  = 0x40; // 01xxxxxx
+const Byte QOI_OP_LUMA  = 0x80; // 10xxxxxx
+const Byte QOI_OP_RUN   = 0xC0; // 11xxxxxx
+const Byte QOI_OP_RGB   = 0xFE; // 11111110
+const Byte QOI_OP_RGBA  = 0xFF; // 11111111
+const Byte QOI_MASK_2   = 0xC0; // 11000000
+
+const int QOI_HEADER_SIZE = 14;
+const int QOI_MAX_RUN = 62; // run lengths 63 and 64 would collide with QOI_OP_RGB(A)
+const Byte QOI_END_MARKER[] = {0,0,0,0,0,0,0,1};
+const UInt QOI_MAX_PIXELS = 400000000; // same limit as the reference implementation
+
+struct QoiPixel {
+  Byte r, g, b, a;
+  inline bool operator == (const QoiPixel& that) const {
+    return r == that.r && g == that.g && b == that.b && a == that.a;
+  }
+  inline bool operator != (const QoiPixel& that) const { return !(*this == that); }
+  inline int hash() const {
+    return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+  }
+};
+
+static inline void qoi_write_32(Byte* out, UInt x) {
+  out[0] = (Byte)(x >> 24);
+  out[1] = (Byte)(x >> 16);
+  out[2] = (Byte)(x >>  8);
+  out[3] = (Byte)(x);
+}
+static inline UInt qoi_read_32(const Byte* in) {
+  return (UInt(in[0]) << 24) | (UInt(in[1]) << 16) | (UInt(in[2]) << 8) | UInt(in[3]);
+}
+
+// ----------------------------------------------------------------------------- : Encoding
+
+void qoi_encode(const Image& img, vector<Byte>& out) {
+  UInt width = img.GetWidth(), height = img.GetHeight();
+  const Byte* data  = img.GetData();
+  const Byte* alpha = img.HasAlpha() ? img.GetAlpha() : nullptr;
+  bool has_mask = !alpha && img.HasMask();
+  Byte mask_r = has_mask ? img.GetMaskRed()   : 0;
+  Byte mask_g = has_mask ? img.GetMaskGreen() : 0;
+  Byte mask_b = has_mask ? img.GetMaskBlue()  : 0;
+  int channels = alpha || has_mask ? 4 : 3;
+  size_t n = size_t(width) * height;
+  // worst case: every pixel is an RGBA chunk
+  out.resize(QOI_HEADER_SIZE + n * (channels + 1) + sizeof(QOI_END_MARKER));
+  Byte* o = &out[0];
+  // header
+  o[0] = 'q'; o[1] = 'o'; o[2] = 'i'; o[3] = 'f';
+  qoi_write_32(o + 4, width);
+  qoi_write_32(o + 8, height);
+  o[12] = (Byte)channels;
+  o[13] = 0; // sRGB with linear alpha
+  o += QOI_HEADER_SIZE;
+  // chunks
+  QoiPixel index[64];
+  memset(index, 0, sizeof(index));
+  QoiPixel prev = {0, 0, 0, 255};
+  int run = 0;
+  for (size_t i = 0 ; i < n ; ++i) {
+    QoiPixel px = {data[0], data[1], data[2], 255};
+    if (alpha) {
+      px.a = alpha[i];
+    } else if (has_mask && px.r == mask_r && px.g == mask_g && px.b == mask_b) {
+      px.a = 0;
+    }
+    data += 3;
+    if (px == prev) {
+      ++run;
+      if (run == QOI_MAX_RUN || i + 1 == n) {
+        *o++ = QOI_OP_RUN | (run - 1);
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      *o++ = QOI_OP_RUN | (run - 1);
+      run = 0;
+    }
+    int h = px.hash();
+    if (index[h] == px) {
+      *o++ = QOI_OP_INDEX | h;
+    } else {
+      index[h] = px;
+      if (px.a == prev.a) {
+        signed char vr = (signed char)(px.r - prev.r);
+        signed char vg = (signed char)(px.g - prev.g);
+        signed char vb = (signed char)(px.b - prev.b);
+        signed char vg_r = (signed char)(vr - vg);
+        signed char vg_b = (signed char)(vb - vg);
+        if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+          *o++ = QOI_OP_DIFF | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2);
+        } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+          *o++ = QOI_OP_LUMA | (vg + 32);
+          *o++ = ((vg_r + 8) << 4) | (vg_b + 8);
+        } else {
+          *o++ = QOI_OP_RGB;
+          *o++ = px.r; *o++ = px.g; *o++ = px.b;
+        }
+      } else {
+        *o++ = QOI_OP_RGBA;
+        *o++ = px.r; *o++ = px.g; *o++ = px.b; *o++ = px.a;
+      }
+    }
+    prev = px;
+  }
+  memcpy(o, QOI_END_MARKER, sizeof(QOI_END_MARKER));
+  o += sizeof(QOI_END_MARKER);
+  out.resize(o - &out[0]);
+}
+
+// ----------------------------------------------------------------------------- : Decoding
+
+bool qoi_is_image(const Byte* data, size_t size) {
+  return size >= 4 && data[0] == 'q' && data[1] == 'o' && data[2] == 'i' && data[3] == 'f';
+}
+
+bool qoi_decode(const Byte* data, size_t size, Image& img) {
+  if (size < QOI_HEADER_SIZE + sizeof(QOI_END_MARKER)) return false;
+  if (!qoi_is_image(data, size)) return false;
+  UInt width  = qoi_read_32(data + 4);
+  UInt height = qoi_read_32(data + 8);
+  int channels = data[12];
+  if (width == 0 || height == 0 || height >= QOI_MAX_PIXELS / width) return false;
+  if (channels != 3 && channels != 4) return false;
+  size_t n = size_t(width) * height;
+  // the chunks end before the end marker
+  const Byte* in  = data + QOI_HEADER_SIZE;
+  const Byte* end = data + size - sizeof(QOI_END_MARKER);
+  img.Create(width, height, false);
+  if (!img.IsOk()) return false; // out of memory
+  if (channels == 4) img.InitAlpha();
+  Byte* out   = img.GetData();
+  Byte* alpha = channels == 4 ? img.GetAlpha() : nullptr;
+  if (channels == 4 && !alpha) return false;
+  QoiPixel index[64];
+  memset(index, 0, sizeof(index));
+  QoiPixel px = {0, 0, 0, 255};
+  int run = 0;
+  for (size_t i = 0 ; i < n ; ++i) {
+    if (run > 0) {
+      --run;
+    } else if (in < end) {
+      Byte b1 = *in++;
+      if (b1 == QOI_OP_RGB) {
+        if (end - in < 3) return false;
+        px.r = in[0]; px.g = in[1]; px.b = in[2];
+        in += 3;
+      } else if (b1 == QOI_OP_RGBA) {
+        if (end - in < 4) return false;
+        px.r = in[0]; px.g = in[1]; px.b = in[2]; px.a = in[3];
+        in += 4;
+      } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+        px = index[b1];
+      } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+        px.r += ((b1 >> 4) & 0x03) - 2;
+        px.g += ((b1 >> 2) & 0x03) - 2;
+        px.b += ( b1       & 0x03) - 2;
+      } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+        if (in >= end) return false;
+        Byte b2 = *in++;
+        int vg = (b1 & 0x3F) - 32;
+        px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+        px.g += vg;
+        px.b += vg - 8 +  (b2       & 0x0F);
+      } else { // QOI_OP_RUN
+        run = b1 & 0x3F;
+      }
+      index[px.hash()] = px;
+    } else {
+      return false; // truncated data
+    }
+    out[0] = px.r; out[1] = px.g; out[2] = px.b;
+    out += 3;
+    if (alpha) *alpha++ = px.a;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------- : QoiImageHandler
+
+/// Handler so that wxImage can load and save QOI files
+class QoiImageHandler : public wxImageHandler {
+public:
+  QoiImageHandler() {
+    SetName(_("QOI file"));
+    SetExtension(_("qoi"));
+    SetType(BITMAP_TYPE_QOI);
+    SetMimeType(_("image/qoi"));
+  }
+
+  bool LoadFile(Image* image, wxInputStream& stream, bool verbose, int index) override {
+    vector<Byte> data;
+    Byte buffer[65536];
+    while (stream.CanRead()) {
+      size_t read = stream.Read(buffer, sizeof(buffer)).LastRead();
+      if (read == 0) break;
+      data.insert(data.end(), buffer, buffer + read);
+    }
+    if (data.empty() || !qoi_decode(&data[0], data.size(), *image)) {
+      if (verbose) wxLogError(_("QOI: Invalid or truncated image data."));
+      image->Destroy();
+      return false;
+    }
+    return true;
+  }
+
+  bool SaveFile(Image* image, wxOutputStream& stream, bool verbose) override {
+    vector<Byte> data;
+    qoi_encode(*image, data);
+    if (!stream.WriteAll(&data[0], data.size())) {
+      if (verbose) wxLogError(_("QOI: Couldn't write image data."));
+      return false;
+    }
+    return true;
+  }
+
+protected:
+  bool DoCanRead(wxInputStream& stream) override {
+    Byte magic[4];
+    return stream.ReadAll(magic, sizeof(magic)) && qoi_is_image(magic, sizeof(magic));
+  }
+};
+
+void init_qoi_image_handler() {
+  if (!Image::FindHandler(BITMAP_TYPE_QOI)) {
+    Image::AddHandler(new QoiImageHandler);
+  }
+}
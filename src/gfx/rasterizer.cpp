@@ -0,0 +1,220 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gfx/rasterizer.hpp>
+
+// ----------------------------------------------------------------------------- : Logical functions
+
+/// Apply a logical function to a channel, see RasterCanvas
+static inline int raster_function(int dst, int src, wxRasterOperationMode func) {
+  switch (func) {
+    case wxAND:        return min(dst, src);
+    case wxOR:         return max(dst, src);
+    case wxXOR:        return abs(dst - src);
+    case wxAND_INVERT: return min(dst, 255 - src);
+    case wxCLEAR:      return 0;
+    case wxSET:        return 255;
+    case wxNO_OP:      return dst;
+    default:           return src; // wxCOPY
+  }
+}
+
+/// Does drawing with the given color and function leave the canvas unchanged?
+static bool raster_no_op(RGB color, wxRasterOperationMode func) {
+  if (func == wxNO_OP) return true;
+  int c = color.r == color.g && color.g == color.b ? color.r : -1;
+  return (func == wxAND && c == 255) || ((func == wxOR || func == wxXOR || func == wxAND_INVERT) && c == 0);
+}
+
+// ----------------------------------------------------------------------------- : RasterCanvas
+
+RasterCanvas::RasterCanvas(int width, int height, RGB color)
+  : width(max(0,width)), height(max(0,height))
+  , data((size_t)this->width * this->height * 3)
+  , accum((size_t)(this->width + 2) * this->height, 0.f)
+{
+  clear(color);
+}
+
+void RasterCanvas::clear(RGB color) {
+  for (size_t i = 0 ; i < data.size() ; i += 3) {
+    data[i] = color.r; data[i+1] = color.g; data[i+2] = color.b;
+  }
+}
+
+void RasterCanvas::blit(const RasterCanvas& src, wxRasterOperationMode func) {
+  assert(src.width == width && src.height == height);
+  for (size_t i = 0 ; i < data.size() ; ++i) {
+    data[i] = (Byte)raster_function(data[i], src.data[i], func);
+  }
+}
+
+void RasterCanvas::blendOver(const RasterCanvas& coverage, RGB color) {
+  assert(coverage.width == width && coverage.height == height);
+  const Byte col[3] = {color.r, color.g, color.b};
+  for (size_t i = 0 ; i < data.size() ; ++i) {
+    int c = coverage.data[i];
+    if (c == 0) continue;
+    int d = data[i];
+    data[i] = (Byte)(d + ((col[i % 3] - d) * c + (col[i % 3] >= d ? 127 : -127)) / 255);
+  }
+}
+
+Image RasterCanvas::toImage() const {
+  Image img(width, height, false);
+  if (!data.empty()) memcpy(img.GetData(), &data[0], data.size());
+  return img;
+}
+
+void RasterCanvas::blendRow(int y, int x0, int x1, const float* cov, RGB color, wxRasterOperationMode func) {
+  Byte* d = &data[((size_t)y * width + x0) * 3];
+  const Byte col[3] = {color.r, color.g, color.b};
+  for (int x = x0 ; x < x1 ; ++x, ++cov, d += 3) {
+    float c = *cov;
+    if (c <= 0) continue;
+    for (int i = 0 ; i < 3 ; ++i) {
+      int r = raster_function(d[i], col[i], func);
+      d[i] = c >= 1 ? (Byte)r : (Byte)(d[i] + (r - d[i]) * c + 0.5f);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------- : Filling
+
+// Polygons are filled by accumulating the signed area between each edge and the left side of the canvas,
+// the running sum of a row then gives the coverage of each pixel. This is the approach of font-rs by R. Levien.
+// Clamping the x coordinates to [0..width] does not change the area inside the canvas.
+
+void RasterCanvas::accumulateLine(Vector2D a, Vector2D b) {
+  if (a.y == b.y) return;
+  float dir = 1.f;
+  if (a.y > b.y) {
+    swap(a, b);
+    dir = -1.f;
+  }
+  double dxdy = (b.x - a.x) / (b.y - a.y);
+  double x = a.x;
+  if (a.y < 0) x -= a.y * dxdy;
+  int y_end = min(height, (int)ceil(b.y));
+  size_t stride = width + 2;
+  for (int y = max(0, (int)a.y) ; y < y_end ; ++y) {
+    float* row = &accum[y * stride];
+    double dy = min(y + 1.0, b.y) - max((double)y, a.y);
+    double x_next = x + dxdy * dy;
+    float d = float(dy * dir);
+    double x0 = max(0., min((double)width, min(x, x_next)));
+    double x1 = max(0., min((double)width, max(x, x_next)));
+    double x0_floor = floor(x0);
+    int x0i = (int)x0_floor;
+    int x1i = (int)ceil(x1);
+    if (x1i <= x0i + 1) {
+      // the line stays within one pixel
+      float xm = float(0.5 * (x0 + x1) - x0_floor);
+      row[x0i]     += d - d * xm;
+      row[x0i + 1] += d * xm;
+    } else {
+      // spread the area over the pixels the line passes through
+      float s   = float(1 / (x1 - x0));
+      float x0f = float(x0 - x0_floor);
+      float a0  = 0.5f * s * (1 - x0f) * (1 - x0f);
+      float x1f = float(x1 - x1i + 1);
+      float am  = 0.5f * s * x1f * x1f;
+      row[x0i] += d * a0;
+      if (x1i == x0i + 2) {
+        row[x0i + 1] += d * (1 - a0 - am);
+      } else {
+        float a1 = s * (1.5f - x0f);
+        row[x0i + 1] += d * (a1 - a0);
+        for (int xi = x0i + 2 ; xi < x1i - 1 ; ++xi) {
+          row[xi] += d * s;
+        }
+        float a2 = a1 + (x1i - x0i - 3) * s;
+        row[x1i - 1] += d * (1 - a2 - am);
+      }
+      row[x1i] += d * am;
+    }
+    x = x_next;
+  }
+}
+
+void RasterCanvas::fillPolygon(const vector<Vector2D>& points, RGB color, wxRasterOperationMode func) {
+  if (points.size() < 3 || raster_no_op(color, func)) return;
+  // bounding box
+  double min_x = points[0].x, min_y = points[0].y, max_y = points[0].y;
+  FOR_EACH_CONST(p, points) {
+    min_x = min(min_x, p.x);
+    min_y = min(min_y, p.y);
+    max_y = max(max_y, p.y);
+  }
+  int y0 = max(0, (int)floor(min_y)), y1 = min(height, (int)ceil(max_y));
+  int x0 = max(0, min(width, (int)floor(min_x)));
+  if (y0 >= y1) return;
+  // accumulate
+  for (size_t i = 0 ; i < points.size() ; ++i) {
+    accumulateLine(points[i], points[i + 1 < points.size() ? i + 1 : 0]);
+  }
+  // running sums give the coverage
+  size_t stride = width + 2;
+  vector<float> cov(width);
+  for (int y = y0 ; y < y1 ; ++y) {
+    float* row = &accum[y * stride];
+    float sum = 0;
+    for (int x = x0 ; x < width ; ++x) {
+      sum += row[x];
+      // even-odd rule: winding numbers 1, 3, .. are inside, 0, 2, .. outside
+      float c = fmod(fabs(sum), 2.f);
+      cov[x] = c > 1 ? 2 - c : c;
+    }
+    fill(row + x0, row + stride, 0.f);
+    blendRow(y, x0, width, &cov[x0], color, func);
+  }
+}
+
+// ----------------------------------------------------------------------------- : Stroking
+
+// A round pen covers all points within pen_width/2 of the outline, so the coverage of a pixel
+// is approximated from the distance between its center and the nearest segment.
+
+void RasterCanvas::strokePolygon(const vector<Vector2D>& points, double pen_width, RGB color, wxRasterOperationMode func) {
+  if (points.empty() || raster_no_op(color, func)) return;
+  double radius = max(0.5, pen_width / 2);
+  // bounding box
+  double min_x = points[0].x, min_y = points[0].y, max_x = points[0].x, max_y = points[0].y;
+  FOR_EACH_CONST(p, points) {
+    min_x = min(min_x, p.x); max_x = max(max_x, p.x);
+    min_y = min(min_y, p.y); max_y = max(max_y, p.y);
+  }
+  int bx0 = max(0,      (int)floor(min_x - radius - 1)), by0 = max(0,      (int)floor(min_y - radius - 1));
+  int bx1 = min(width,  (int)ceil (max_x + radius + 1)), by1 = min(height, (int)ceil (max_y + radius + 1));
+  if (bx0 >= bx1 || by0 >= by1) return;
+  int bw = bx1 - bx0;
+  coverage.assign((size_t)bw * (by1 - by0), 0.f);
+  // coverage of each segment, combined with max
+  for (size_t i = 0 ; i < points.size() ; ++i) {
+    const Vector2D& a = points[i];
+    const Vector2D& b = points[i + 1 < points.size() ? i + 1 : 0];
+    Vector2D ab = b - a;
+    double len2 = ab.lengthSqr();
+    int x0 = max(bx0, (int)floor(min(a.x, b.x) - radius)), x1 = min(bx1, (int)ceil(max(a.x, b.x) + radius));
+    int y0 = max(by0, (int)floor(min(a.y, b.y) - radius)), y1 = min(by1, (int)ceil(max(a.y, b.y) + radius));
+    for (int y = y0 ; y < y1 ; ++y) {
+      float* cov = &coverage[(size_t)(y - by0) * bw];
+      for (int x = x0 ; x < x1 ; ++x) {
+        Vector2D p(x + 0.5, y + 0.5);
+        double t = len2 > 0 ? max(0., min(1., dot(p - a, ab) / len2)) : 0;
+        double dist = (p - (a + ab * t)).length();
+        float c = float(radius + 0.5 - dist);
+        if (c > cov[x - bx0]) cov[x - bx0] = min(1.f, c);
+      }
+    }
+  }
+  for (int y = by0 ; y < by1 ; ++y) {
+    blendRow(y, bx0, bx1, &coverage[(size_t)(y - by0) * bw], color, func);
+  }
+}
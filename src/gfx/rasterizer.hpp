@@ -0,0 +1,62 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/vector2d.hpp>
+#include <gfx/color.hpp>
+
+// ----------------------------------------------------------------------------- : RasterCanvas
+
+/// An RGB image that polygons can be drawn on with anti aliasing, without using a DC
+/** Shapes are drawn by coverage: every pixel is blended with the drawing color by the fraction
+ *  of its area covered by the shape. So the result is anti aliased, and does not depend on the platform.
+ *
+ *  The logical functions work like those of a DC. For the colors used in symbols (0, 128 and 255)
+ *  min/max/difference per channel are the same as the bitwise and/or/xor, so a canvas can stand in
+ *  for a wxMemoryDC in code written for raster operations.
+ *
+ *  A canvas uses no GDI objects, so different threads can draw on different canvases at the same time.
+ */
+class RasterCanvas {
+public:
+  RasterCanvas(int width, int height, RGB color = RGB(0));
+  
+  inline int getWidth()  const { return width; }
+  inline int getHeight() const { return height; }
+  
+  /// Fill the whole canvas with a color
+  void clear(RGB color);
+  /// Fill a polygon, using the even-odd rule like DC::DrawPolygon
+  void fillPolygon(const vector<Vector2D>& points, RGB color, wxRasterOperationMode func = wxCOPY);
+  /// Draw the outline of a polygon with a round pen of the given width
+  void strokePolygon(const vector<Vector2D>& points, double pen_width, RGB color, wxRasterOperationMode func = wxCOPY);
+  /// Combine another canvas of the same size with this one, like DC::Blit
+  void blit(const RasterCanvas& src, wxRasterOperationMode func);
+  /// Blend a color over this canvas, using the values of another canvas of the same size as coverage
+  /** Where the other canvas is white the color is used, where it is black this canvas is kept.
+   *  For pure black and white this is the same as blit with wxOR (for white) or wxAND_INVERT (for black),
+   *  but anti aliased edges are mixed with the color instead of with another edge.
+   */
+  void blendOver(const RasterCanvas& coverage, RGB color);
+  
+  /// Convert to an image
+  Image toImage() const;
+  
+private:
+  int width, height;
+  vector<Byte>  data;     ///< RGB data
+  vector<float> accum;    ///< Area accumulation buffer for filling, width+2 per row, all zero between calls
+  vector<float> coverage; ///< Coverage buffer for strokes
+  
+  /// Blend the pixels in row y, columns [x0..x1) with color by the coverage in cov
+  void blendRow(int y, int x0, int x1, const float* cov, RGB color, wxRasterOperationMode func);
+  /// Accumulate the signed area of a line
+  void accumulateLine(Vector2D a, Vector2D b);
+};
@@ -8,7 +8,9 @@
 
 #include <util/prec.hpp>
 #include <gfx/gfx.hpp>
+#include <gfx/simd.hpp>
 #include <util/error.hpp>
+#include <util/parallel.hpp>
 
 // ----------------------------------------------------------------------------- : Resample passes
 
@@ -17,108 +19,195 @@
 //  we will get errors if 2^shift * imagesize becomes too large
 const int shift = 32-10-8; // => max size = 1024, max alpha = 255
 
-// Resample an image only in a single direction, either horizontally or vertically
-/* Terms are based on x resampling (keeping the same number of lines):
- *  offset     = number of elements to skip at the start
- *  length     = length of a line
- *  delta      = number of elements between pixels in a lines
- *  lines      = number of lines
- *  line_delta = number of elements between the the first pixel of two lines
- *  1 element = 3 bytes in data, 1 byte in alpha
+/// Weights for resampling a line of pixels to a different length
+/** Output pixel x is the sum of weight[k] * input pixel (first[x] + k - start[x]), for k in [start[x]..start[x+1]).
+ *  The weights of an output pixel sum to 1<<shift.
  */
-void resample_pass(const Image& img_in, Image& img_out, int offset_in, int offset_out,
-                   int length_in, int delta_in, int length_out, int delta_out,
-                   int lines, int line_delta_in, int line_delta_out)
-{
+struct ResampleWeights {
+  vector<int>  start;
+  vector<int>  first;
+  vector<UInt> weight;
+};
+
+/* Each input pixel becomes a fixed amount of output (in 1<<shift fixed point math).
+ * For each output pixel, _('eat') input pixels until the total is 1<<shift.
+ * To ensure the sum of all the pixel amounts is exacly length_out<<shift an extra rest amount
+ * is _('eaten') from the first pixel.
+ */
+void resample_weights(int length_in, int length_out, ResampleWeights& w) {
+  UInt out_fact = (length_out << shift) / length_in; // how much to output for 1 input pixel
+  UInt out_rest = (length_out << shift) % length_in;
+  UInt in_rem = out_fact + out_rest; // remaining to input from the current input pixel
+  int i = 0; // current input pixel
+  w.start.resize(length_out + 1);
+  w.first.resize(length_out);
+  w.weight.clear();
+  for (int x = 0 ; x < length_out ; ++x) {
+    w.start[x] = (int)w.weight.size();
+    w.first[x] = i;
+    UInt out_rem = 1 << shift;
+    while (out_rem >= in_rem && i < length_in) {
+      // eat a whole input pixel
+      w.weight.push_back(in_rem);
+      out_rem -= in_rem;
+      in_rem = out_fact;
+      ++i;
+    }
+    if (out_rem > 0 && i < length_in) {
+      // eat a partial input pixel
+      w.weight.push_back(out_rem);
+      in_rem -= out_rem;
+    }
+  }
+  w.start[length_out] = (int)w.weight.size();
+}
+
+/// Store a pixel from totals of weighted R*A, G*A, B*A, A
+/** Without alpha in the input (alpha = false) the totals are of R, G, B. */
+inline void resample_store(const UInt* tot, bool alpha, Byte* out, Byte* out_a) {
+  if (!alpha) {
+    out[0] = tot[0] >> shift;
+    out[1] = tot[1] >> shift;
+    out[2] = tot[2] >> shift;
+    if (out_a) *out_a = 255;
+  } else if (tot[3]) {
+    out[0] = tot[0] / tot[3];
+    out[1] = tot[1] / tot[3];
+    out[2] = tot[2] / tot[3];
+    *out_a = tot[3] >> shift;
+  } else {
+    out[0] = out[1] = out[2] = *out_a = 0; // div by 0 is bad
+  }
+}
+
+/// Horizontally resample a row of pixels
+/** For each output pixel x, computes the totals of weighted R*A, G*A, B*A, A (or R, G, B without alpha),
+ *  and calls store(x, totals).
+ */
+template <bool alpha, typename Store>
+inline void resample_row(const ResampleWeights& w, int width, const Byte* in, const Byte* in_a, Store store) {
+  const UInt* weight = w.weight.data();
+  for (int x = 0 ; x < width ; ++x) {
+    const Byte* p  = in + 3 * w.first[x];
+    const Byte* pa = alpha ? in_a + w.first[x] : nullptr;
+    UInt totR = 0, totG = 0, totB = 0, totA = 0;
+    for (int k = w.start[x], end = w.start[x+1] ; k < end ; ++k) {
+      UInt a = alpha ? *pa++ * weight[k] : weight[k];
+      totR += p[0] * a;
+      totG += p[1] * a;
+      totB += p[2] * a;
+      totA += a;
+      p += 3;
+    }
+    UInt tot[4] = {totR, totG, totB, totA};
+    store(x, tot);
+  }
+}
+
+/// tot[i] += weight * row[i], for i in [0..n)
+inline void resample_add_row(UInt* tot, const unsigned short* row, UInt weight, int n) {
+  int i = 0;
+  #ifdef MSE_SIMD_SSE2
+    typedef SimdSSE2 S;
+    S::V w = S::set16(weight);
+    for ( ; i + 8 <= n ; i += 8) {
+      S::V lo, hi;
+      S::mul16_32(_mm_loadu_si128((const __m128i*)(row + i)), w, lo, hi);
+      _mm_storeu_si128((__m128i*)(tot + i),     S::add32(_mm_loadu_si128((const __m128i*)(tot + i)),     lo));
+      _mm_storeu_si128((__m128i*)(tot + i + 4), S::add32(_mm_loadu_si128((const __m128i*)(tot + i + 4)), hi));
+    }
+  #endif
+  for ( ; i < n ; ++i) {
+    tot[i] += weight * row[i];
+  }
+}
+
+/// Resample the rectangle rect_in of img_in into the rectangle rect_out of img_out
+/** First resamples horizontally, then vertically.
+ *  The weights are computed once for each direction, and rows are divided over multiple threads.
+ *  The vertical pass sums premultiplied 16 bit values, several at a time with SIMD instructions.
+ *
+ *  If always_alpha, the result is as if the horizontal pass was done into an intermediate image with alpha:
+ *  the alpha channel of img_out is always set, and color is dropped from pixels that become fully transparent.
+ */
+void resample_rect(const Image& img_in, const wxRect& rect_in, Image& img_out, const wxRect& rect_out, bool always_alpha) {
   bool alpha = img_in.HasAlpha();
-  if (alpha && !img_out.HasAlpha()) img_out.InitAlpha();
-  int out_fact = (length_out << shift) / length_in; // how much to output for 256 input = 1 pixel
-  int out_rest = (length_out << shift) % length_in;
-  // for each line
-  for (int l = 0 ; l < lines ; ++l) {
-    Byte* in  = img_in .GetData() + 3 * (offset_in  + l * line_delta_in);
-    Byte* out = img_out.GetData() + 3 * (offset_out + l * line_delta_out);
-    UInt in_rem = out_fact + out_rest; // remaining to input from the current input pixel
-    
-    if (alpha) {
-      Byte* in_a  = img_in .GetAlpha() + (offset_in  + l * line_delta_in);
-      Byte* out_a = img_out.GetAlpha() + (offset_out + l * line_delta_out);
-      
-      for (int x = 0 ; x < length_out ; ++x) {
-        UInt out_rem = 1 << shift;
-        UInt totR = 0, totG = 0, totB = 0, totA = 0;
-        while (out_rem >= in_rem) {
-          // eat a whole input pixel
-          totR += in[0]   * in_rem * in_a[0]; // multiply by alpha
-          totG += in[1]   * in_rem * in_a[0];
-          totB += in[2]   * in_rem * in_a[0];
-          totA += in_a[0] * in_rem;
-          out_rem -= in_rem;
-          in_rem = out_fact;
-          in += 3*delta_in; in_a += delta_in;
-        }
-        if (out_rem > 0) {
-          // eat a partial input pixel
-          totR += in[0]   * out_rem * in_a[0];
-          totG += in[1]   * out_rem * in_a[0];
-          totB += in[2]   * out_rem * in_a[0];
-          totA += in_a[0] * out_rem;
-          in_rem -= out_rem;
-        }
-        // store
-        if (totA) {
-          out[0] = totR / totA;
-          out[1] = totG / totA;
-          out[2] = totB / totA;
-          out_a[0] = totA >> shift;
-        } else {
-          out[0] = out[1] = out[2] = out_a[0] = 0; // div by 0 is bad
-        }
-        out += 3*delta_out; out_a += delta_out;
+  bool write_alpha = always_alpha || alpha;
+  if (write_alpha && !img_out.HasAlpha()) img_out.InitAlpha();
+  int stride_in = img_in.GetWidth(), stride_out = img_out.GetWidth();
+  const Byte* data_in  = img_in.GetData() + 3 * (rect_in.x + rect_in.y * stride_in);
+  const Byte* alpha_in = alpha ? img_in.GetAlpha() + (rect_in.x + rect_in.y * stride_in) : nullptr;
+  Byte* data_out  = img_out.GetData() + 3 * (rect_out.x + rect_out.y * stride_out);
+  Byte* alpha_out = write_alpha ? img_out.GetAlpha() + (rect_out.x + rect_out.y * stride_out) : nullptr;
+  int width = rect_out.width;
+  ResampleWeights wx;
+  resample_weights(rect_in.width, width, wx);
+  // only use threads if there is enough work for each thread
+  const int min_work = 1 << 16;
+  int min_rows_x = max(1, min_work / max(1, (int)wx.weight.size()));
+  
+  if (rect_in.height == rect_out.height && !always_alpha) {
+    // no resizing vertically
+    parallel_for(rect_in.height, min_rows_x, [&](int begin, int end) {
+      for (int y = begin ; y < end ; ++y) {
+        Byte* out   = data_out + 3 * y * stride_out;
+        Byte* out_a = alpha_out ? alpha_out + y * stride_out : nullptr;
+        auto store = [&](int x, const UInt* tot) {
+          resample_store(tot, alpha, out + 3 * x, out_a ? out_a + x : nullptr);
+        };
+        if (alpha) resample_row<true> (wx, width, data_in + 3 * y * stride_in, alpha_in + y * stride_in, store);
+        else       resample_row<false>(wx, width, data_in + 3 * y * stride_in, nullptr, store);
       }
-      
-    } else {
-      // no alpha
-      for (int x = 0 ; x < length_out ; ++x) {
-        UInt out_rem = 1 << shift;
-        UInt totR = 0, totG = 0, totB = 0;
-        while (out_rem >= in_rem) {
-          // eat a whole input pixel
-          totR += in[0] * in_rem;
-          totG += in[1] * in_rem;
-          totB += in[2] * in_rem;
-          out_rem -= in_rem;
-          in_rem = out_fact;
-          in += 3*delta_in;
-        }
-        if (out_rem > 0) {
-          // eat a partial input pixel
-          totR += in[0] * out_rem;
-          totG += in[1] * out_rem;
-          totB += in[2] * out_rem;
-          in_rem -= out_rem;
-        }
-        // store
-        out[0] = totR >> shift;
-        out[1] = totG >> shift;
-        out[2] = totB >> shift;
-        out += 3*delta_out;
+    });
+    return;
+  }
+  
+  // horizontal pass, to premultiplied (R*A, G*A, B*A, A) values of the pixels rounded as if they were stored
+  vector<unsigned short> temp(4 * width * rect_in.height);
+  parallel_for(rect_in.height, min_rows_x, [&](int begin, int end) {
+    for (int y = begin ; y < end ; ++y) {
+      unsigned short* t = &temp[4 * width * y];
+      if (alpha) {
+        resample_row<true>(wx, width, data_in + 3 * y * stride_in, alpha_in + y * stride_in, [&](int x, const UInt* tot) {
+          Byte px[3], a;
+          resample_store(tot, true, px, &a);
+          t[4*x] = px[0] * a; t[4*x+1] = px[1] * a; t[4*x+2] = px[2] * a; t[4*x+3] = a;
+        });
+      } else {
+        resample_row<false>(wx, width, data_in + 3 * y * stride_in, nullptr, [&](int x, const UInt* tot) {
+          t[4*x] = tot[0] >> shift; t[4*x+1] = tot[1] >> shift; t[4*x+2] = tot[2] >> shift; t[4*x+3] = 0;
+        });
       }
     }
-  }
+  });
+  
+  // vertical pass
+  ResampleWeights wy;
+  resample_weights(rect_in.height, rect_out.height, wy);
+  int min_rows_y = max(1, (int)(min_work * (long long)rect_out.height / max(1LL, 4LL * width * (long long)wy.weight.size())));
+  parallel_for(rect_out.height, min_rows_y, [&](int begin, int end) {
+    vector<UInt> tot(4 * width);
+    for (int y = begin ; y < end ; ++y) {
+      fill(tot.begin(), tot.end(), 0);
+      for (int k = wy.start[y], i = wy.first[y] ; k < wy.start[y+1] ; ++k, ++i) {
+        resample_add_row(&tot[0], &temp[4 * width * i], wy.weight[k], 4 * width);
+      }
+      for (int x = 0 ; x < width ; ++x) {
+        int o = x + y * stride_out;
+        resample_store(&tot[4 * x], alpha, data_out + 3 * o, alpha_out ? alpha_out + o : nullptr);
+      }
+    }
+  });
 }
 
 // ----------------------------------------------------------------------------- : Resample
 
 /* The algorithm first resizes in horizontally, then vertically,
  * the two passes are essentially the same:
- *  - for each row:
- *    - each input pixel becomes a fixed amount of output (in 1<<shift fixed point math)
- *    - for each output pixel:
- *      - _('eat') input pixels until the total is 1<<shift
- *      - write the total to the output pixel
- *  - to ensure the sum of all the pixel amounts is exacly width<<shift an extra rest amount
- *    is _('eaten') from the first pixel;
+ *  - compute the weights of the input pixels for each output pixel (see resample_weights)
+ *  - for each row, for each output pixel:
+ *    - sum the weighted input pixels
+ *    - write the total to the output pixel
  *
  * Uses fixed point numbers
  */
@@ -140,16 +229,7 @@ void resample_and_clip(const Image& img_in, Image& img_out, wxRect rect) {
   if (img_in.HasMask() && !img_in.HasAlpha()) {
     const_cast<Image&>(img_in).InitAlpha();
   }
-  // starting position in data
-  int offset_in = (rect.x + img_in.GetWidth() * rect.y);
-  if (img_out.GetHeight() == rect.height) {
-    // no resizing vertically
-    resample_pass(img_in,   img_out,  offset_in, 0, rect.width,  1,                   img_out .GetWidth(),  1,                   rect    .GetHeight(), img_in.GetWidth(), img_out .GetWidth());
-  } else {
-    Image img_temp(img_out.GetWidth(), rect.height, false);
-    resample_pass(img_in,   img_temp, offset_in, 0, rect.width,  1,                   img_temp.GetWidth(),  1,                   rect    .GetHeight(), img_in.GetWidth(), img_temp.GetWidth());
-    resample_pass(img_temp, img_out,  0,         0, rect.height, img_temp.GetWidth(), img_out .GetHeight(), img_temp.GetWidth(), img_temp.GetWidth(),  1,                 1);
-  }
+  resample_rect(img_in, rect, img_out, wxRect(0, 0, img_out.GetWidth(), img_out.GetHeight()), false);
 }
 
 
@@ -173,11 +253,7 @@ void resample_preserve_aspect(const Image& img_in, Image& img_out) {
   // transparent background
   fill_transparent(img_out);
   // resample
-  int offset_out = dx + img_out.GetWidth() * dy;
-  Image img_temp(rwidth, img_in.GetHeight(), false);
-  img_temp.InitAlpha();
-  resample_pass(img_in,   img_temp, 0, 0,          img_in.GetWidth(),  1,                   rwidth,  1,                  img_in.GetHeight(), img_in.GetWidth(), img_temp.GetWidth());
-  resample_pass(img_temp, img_out,  0, offset_out, img_in.GetHeight(), img_temp.GetWidth(), rheight, img_out.GetWidth(), rwidth,             1,                 1);
+  resample_rect(img_in, wxRect(0, 0, img_in.GetWidth(), img_in.GetHeight()), img_out, wxRect(dx, dy, rwidth, rheight), true);
 }
 
 Image resample_preserve_aspect(const Image& img_in, int width, int height) {
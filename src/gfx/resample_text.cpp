@@ -141,26 +141,13 @@ void downsample_to_alpha(Bitmap& bmp_in, Image& img_out) {
   delete[] temp;
 }
 
-// simple blur
-int blur_alpha_pixel(Byte* in, int x, int y, int width, int height) {
-  return (2 * (                      in[0])      + // center
-          (x == 0          ? in[0] : in[-1])     + // left
-          (y == 0          ? in[0] : in[-width]) + // up
-          (x == width - 1  ? in[0] : in[1])      + // right
-          (y == height - 1 ? in[0] : in[width])    // down
-         ) / 6;
-}
-
-// TODO: move me?
-void blur_image_alpha(Image& img) {
-  int width = img.GetWidth(), height = img.GetHeight();
-  Byte* data = img.GetAlpha();
-  for (int y = 0 ; y < height ; ++y) {
-    for (int x = 0 ; x < width ; ++x) {
-      *data = blur_alpha_pixel(data, x, y, width, height);
-      ++data;
-    }
-  }
+// Blur the alpha channel of an image
+//  blur_radius is the number of times a 5 point filter (2/6 for the center, 1/6 for each neighbour) is applied,
+//  each time adds a variance of 1/3 in both directions
+//  like that filter, the edge pixels are repeated outside the image
+void blur_image_alpha(Image& img, int blur_radius) {
+  double sigma = sqrt(blur_radius / 3.);
+  gaussian_blur(img.GetAlpha(), img.GetWidth(), img.GetHeight(), sigma, sigma, true);
 }
 
 // Draw text by first drawing it using a larger font and then downsampling it
@@ -198,8 +185,8 @@ void draw_resampled_text(DC& dc, const RealPoint& pos, const RealRect& rect, dou
     set_alpha(img_small, color.Alpha() / 255.);
   }
   // blur
-  for (int i = 0 ; i < blur_radius ; ++i) {
-    blur_image_alpha(img_small);
+  if (blur_radius > 0) {
+    blur_image_alpha(img_small, blur_radius);
   }
   // step 3. draw to dc
   for (int i = 0 ; i < repeat ; ++i) {
@@ -134,3 +134,92 @@ Image flip_image_vertical(Image const& img) {
   }
   return out;
 }
+
+// ----------------------------------------------------------------------------- : Image views
+
+ImageView::ImageView(const Image& image)
+  : image(image)
+  , width(image.GetWidth()), height(image.GetHeight())
+  , offset(0), step_x(1), step_y(image.GetWidth())
+{}
+
+/// Copy a view of pixels of size bytes each
+void copy_view(const Byte* in, Byte* out, int size, int width, int height, ptrdiff_t offset, ptrdiff_t step_x, ptrdiff_t step_y) {
+  for (int y = 0 ; y < height ; ++y) {
+    const Byte* line = in + size * (offset + y * step_y);
+    if (step_x == 1) {
+      memcpy(out, line, size * width);
+      out += size * width;
+    } else {
+      for (int x = 0 ; x < width ; ++x) {
+        memcpy(out, line + size * x * step_x, size);
+        out += size;
+      }
+    }
+  }
+}
+
+Image ImageView::toImage() const {
+  if (offset == 0 && step_x == 1 && step_y == width && width == image.GetWidth() && height == image.GetHeight()) {
+    return image; // the whole image
+  }
+  Image out(width, height, false);
+  copy_view(image.GetData(), out.GetData(), 3, width, height, offset, step_x, step_y);
+  if (image.HasAlpha()) {
+    out.InitAlpha();
+    copy_view(image.GetAlpha(), out.GetAlpha(), 1, width, height, offset, step_x, step_y);
+  }
+  if (image.HasMask()) {
+    out.SetMaskColour(image.GetMaskRed(), image.GetMaskGreen(), image.GetMaskBlue());
+  }
+  return out;
+}
+
+ImageView ImageView::crop(int x, int y, int w, int h) const {
+  assert(x >= 0 && y >= 0 && x + w <= width && y + h <= height);
+  ImageView view = *this;
+  view.offset += x * step_x + y * step_y;
+  view.width  = w;
+  view.height = h;
+  return view;
+}
+
+ImageView ImageView::flipHorizontal() const {
+  ImageView view = *this;
+  view.offset += (width - 1) * step_x;
+  view.step_x = -step_x;
+  return view;
+}
+
+ImageView ImageView::flipVertical() const {
+  ImageView view = *this;
+  view.offset += (height - 1) * step_y;
+  view.step_y = -step_y;
+  return view;
+}
+
+// see Rotate90deg: pixel (x,y) of the result is pixel (width-1-y, x) of the source
+ImageView ImageView::rotate90() const {
+  ImageView view = *this;
+  view.width  = height;
+  view.height = width;
+  view.offset += (width - 1) * step_x;
+  view.step_x = step_y;
+  view.step_y = -step_x;
+  return view;
+}
+
+ImageView ImageView::rotate180() const {
+  return flipHorizontal().flipVertical();
+}
+
+// see Rotate270deg: pixel (x,y) of the result is pixel (y, height-1-x) of the source
+ImageView ImageView::rotate270() const {
+  ImageView view = *this;
+  view.width  = height;
+  view.height = width;
+  view.offset += (height - 1) * step_y;
+  view.step_x = -step_y;
+  view.step_y = step_x;
+  return view;
+}
@@ -0,0 +1,178 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+/** @file gfx/simd.hpp
+ *
+ *  Thin wrappers around SSE2/AVX2 intrinsics, so image kernels can be written once
+ *  as a template over the instruction set.
+ *
+ *  SSE2 is always available on x86-64. AVX2 kernels live in separate files that enable
+ *  AVX2 after including the common headers and define MSE_SIMD_AVX2_TARGET (see
+ *  combine_image_avx2.cpp), they must only be called when cpu_has_avx2() returns true.
+ *
+ *  Everything here is in an anonymous namespace: the same inline functions are compiled
+ *  with different instruction sets in different files, and the linker must not mix them up.
+ */
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define MSE_SIMD_SSE2 1
+  #include <emmintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #include <immintrin.h>
+  #endif
+#endif
+#if defined(MSE_SIMD_SSE2) && (defined(__AVX2__) || defined(MSE_SIMD_AVX2_TARGET))
+  #define MSE_SIMD_AVX2 1
+  #include <immintrin.h>
+#endif
+
+namespace {
+
+// ----------------------------------------------------------------------------- : CPU detection
+
+#ifdef MSE_SIMD_SSE2
+  /// Does the processor (and operating system) support AVX2 instructions?
+  inline bool cpu_has_avx2() {
+    #if defined(_MSC_VER)
+      int info[4];
+      __cpuid(info, 0);
+      if (info[0] < 7) return false;
+      __cpuid(info, 1);
+      bool osxsave = (info[2] & (1 << 27)) != 0;
+      bool avx     = (info[2] & (1 << 28)) != 0;
+      if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false; // OS must save ymm registers
+      __cpuidex(info, 7, 0);
+      return (info[1] & (1 << 5)) != 0;
+    #elif defined(__GNUC__)
+      return __builtin_cpu_supports("avx2");
+    #else
+      return false;
+    #endif
+  }
+#else
+  inline bool cpu_has_avx2() { return false; }
+#endif
+
+// ----------------------------------------------------------------------------- : SSE2
+
+#ifdef MSE_SIMD_SSE2
+/// SSE2 instructions, 16 bytes at a time
+struct SimdSSE2 {
+  typedef __m128i V;
+  static const size_t size = 16;
+
+  static inline V load(const Byte* p)  { return _mm_loadu_si128((const __m128i*)p); }
+  static inline void store(Byte* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+  static inline V set16(int x) { return _mm_set1_epi16((short)x); }
+
+  // bytes
+  static inline V adds_u8(V a, V b) { return _mm_adds_epu8(a, b); }
+  static inline V subs_u8(V a, V b) { return _mm_subs_epu8(a, b); }
+  static inline V min_u8 (V a, V b) { return _mm_min_epu8(a, b); }
+  static inline V max_u8 (V a, V b) { return _mm_max_epu8(a, b); }
+  static inline V bit_and(V a, V b) { return _mm_and_si128(a, b); }
+  static inline V bit_or (V a, V b) { return _mm_or_si128(a, b); }
+  static inline V bit_xor(V a, V b) { return _mm_xor_si128(a, b); }
+  /// mask ? a : b
+  static inline V select(V mask, V a, V b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+  // bytes <-> 16 bit lanes; lo16/hi16/pack16 use the same order, so pack16(lo16(x),hi16(x)) == x
+  static inline V lo16(V a) { return _mm_unpacklo_epi8(a, _mm_setzero_si128()); }
+  static inline V hi16(V a) { return _mm_unpackhi_epi8(a, _mm_setzero_si128()); }
+  /// Pack 16 bit lanes to bytes, clamping to [0..255]
+  static inline V pack16(V lo, V hi) { return _mm_packus_epi16(lo, hi); }
+
+  // 16 bit lanes
+  static inline V add16(V a, V b) { return _mm_add_epi16(a, b); }
+  static inline V sub16(V a, V b) { return _mm_sub_epi16(a, b); }
+  static inline V mul16(V a, V b) { return _mm_mullo_epi16(a, b); }
+  template <int n> static inline V shr16(V a) { return _mm_srli_epi16(a, n); }
+  static inline V max16(V a, V b) { return _mm_max_epi16(a, b); } // signed
+  static inline V lt16 (V a, V b) { return _mm_cmplt_epi16(a, b); } // signed
+
+  /// Multiply unsigned 16 bit lanes, giving the 32 bit products of the low and high halves of the lanes
+  static inline void mul16_32(V a, V b, V& lo, V& hi) {
+    V l = _mm_mullo_epi16(a, b), h = _mm_mulhi_epu16(a, b);
+    lo = _mm_unpacklo_epi16(l, h);
+    hi = _mm_unpackhi_epi16(l, h);
+  }
+  // 32 bit lanes
+  static inline V add32(V a, V b) { return _mm_add_epi32(a, b); }
+
+  /// Per 16 bit lane: min(255, floor(x * y / z)), for unsigned x,y,z with x*y < 2^24
+  static inline V muldiv16(V x, V y, V z) {
+    V zero = _mm_setzero_si128();
+    return _mm_packs_epi32(
+      muldiv32(_mm_unpacklo_epi16(x, zero), _mm_unpacklo_epi16(y, zero), _mm_unpacklo_epi16(z, zero)),
+      muldiv32(_mm_unpackhi_epi16(x, zero), _mm_unpackhi_epi16(y, zero), _mm_unpackhi_epi16(z, zero)));
+  }
+  static inline V muldiv32(V x, V y, V z) {
+    // The product is exact, and the division is correctly rounded.
+    // For quotients of integers below 2^24 the fractional part is never rounded away, so truncating is exact.
+    // Division by zero gives inf or nan, min_ps turns both into 255.
+    __m128 q = _mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(x), _mm_cvtepi32_ps(y)), _mm_cvtepi32_ps(z));
+    return _mm_cvttps_epi32(_mm_min_ps(q, _mm_set1_ps(255.f)));
+  }
+};
+#endif
+
+// ----------------------------------------------------------------------------- : AVX2
+
+#ifdef MSE_SIMD_AVX2
+/// AVX2 instructions, 32 bytes at a time
+/** Unpacking and packing work per 128 bit half, so as long as they are used in pairs the order is preserved */
+struct SimdAVX2 {
+  typedef __m256i V;
+  static const size_t size = 32;
+
+  static inline V load(const Byte* p)  { return _mm256_loadu_si256((const __m256i*)p); }
+  static inline void store(Byte* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+  static inline V set16(int x) { return _mm256_set1_epi16((short)x); }
+
+  // bytes
+  static inline V adds_u8(V a, V b) { return _mm256_adds_epu8(a, b); }
+  static inline V subs_u8(V a, V b) { return _mm256_subs_epu8(a, b); }
+  static inline V min_u8 (V a, V b) { return _mm256_min_epu8(a, b); }
+  static inline V max_u8 (V a, V b) { return _mm256_max_epu8(a, b); }
+  static inline V bit_and(V a, V b) { return _mm256_and_si256(a, b); }
+  static inline V bit_or (V a, V b) { return _mm256_or_si256(a, b); }
+  static inline V bit_xor(V a, V b) { return _mm256_xor_si256(a, b); }
+  static inline V select(V mask, V a, V b) { return _mm256_blendv_epi8(b, a, mask); }
+
+  // bytes <-> 16 bit lanes
+  static inline V lo16(V a) { return _mm256_unpacklo_epi8(a, _mm256_setzero_si256()); }
+  static inline V hi16(V a) { return _mm256_unpackhi_epi8(a, _mm256_setzero_si256()); }
+  static inline V pack16(V lo, V hi) { return _mm256_packus_epi16(lo, hi); }
+
+  // 16 bit lanes
+  static inline V add16(V a, V b) { return _mm256_add_epi16(a, b); }
+  static inline V sub16(V a, V b) { return _mm256_sub_epi16(a, b); }
+  static inline V mul16(V a, V b) { return _mm256_mullo_epi16(a, b); }
+  template <int n> static inline V shr16(V a) { return _mm256_srli_epi16(a, n); }
+  static inline V max16(V a, V b) { return _mm256_max_epi16(a, b); }
+  static inline V lt16 (V a, V b) { return _mm256_cmpgt_epi16(b, a); }
+
+  static inline V muldiv16(V x, V y, V z) {
+    V zero = _mm256_setzero_si256();
+    return _mm256_packs_epi32(
+      muldiv32(_mm256_unpacklo_epi16(x, zero), _mm256_unpacklo_epi16(y, zero), _mm256_unpacklo_epi16(z, zero)),
+      muldiv32(_mm256_unpackhi_epi16(x, zero), _mm256_unpackhi_epi16(y, zero), _mm256_unpackhi_epi16(z, zero)));
+  }
+  static inline V muldiv32(V x, V y, V z) {
+    __m256 q = _mm256_div_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(x), _mm256_cvtepi32_ps(y)), _mm256_cvtepi32_ps(z));
+    return _mm256_cvttps_epi32(_mm256_min_ps(q, _mm256_set1_ps(255.f)));
+  }
+};
+#endif
+
+} // namespace
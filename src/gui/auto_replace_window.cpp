@@ -292,6 +292,7 @@ void AutoReplaceWindow::updateItem() {
 void AutoReplaceWindow::store() {
   list->gs.use_auto_replace = use_auto_replace->GetValue();
   swap(list->items, list->gs.auto_replaces);
+  list->gs.autoReplacesChanged();
 }
 
 BEGIN_EVENT_TABLE(AutoReplaceWindow, wxDialog)
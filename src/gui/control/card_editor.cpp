@@ -58,6 +58,13 @@ bool DataEditor::viewerIsCurrent(const ValueViewer* viewer) const {
   return viewer == current_viewer && FindFocus() == this;
 }
 
+bool DataEditor::drawsPlainCard() const {
+  // no viewer is drawn as active or hovered
+  return !nativeLook()
+      && !(current_viewer && viewerIsCurrent(current_viewer))
+      && !(draw_hover_borders && hovered_viewer);
+}
+
 void DataEditor::addAction(unique_ptr<Action> action) {
   set->actions.addAction(move(action));
 }
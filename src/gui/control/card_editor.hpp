@@ -25,6 +25,7 @@ public:
   
   DrawWhat drawWhat(const ValueViewer*) const override;
   bool viewerIsCurrent(const ValueViewer*) const override;
+  bool drawsPlainCard() const override;
   
   virtual void addAction(unique_ptr<Action> action) final;
   inline SetP getSetForActions() { return set; }
@@ -22,6 +22,7 @@
 #include <data/action/set.hpp>
 #include <data/action/value.hpp>
 #include <util/window_id.hpp>
+#include <util/sorted_list.hpp>
 #include <wx/clipbrd.h>
 
 DECLARE_POINTER_TYPE(ChoiceValue);
@@ -69,6 +70,7 @@ struct Freezer{
 void CardListBase::onAction(const Action& action, bool undone) {
   TYPE_CASE(action, AddCardAction) {
     Freezer freeze(this);
+    FOR_EACH_CONST(s, action.action.steps) cached_cards.erase(s.item.get()); // the card may be deleted
     if (action.action.adding != undone) {
       // select the new cards
       focusNone();
@@ -105,10 +107,27 @@ void CardListBase::onAction(const Action& action, bool undone) {
   }
   TYPE_CASE_(action, ScriptValueEvent) {
     // No refresh needed, a ScriptValueEvent is only generated in response to a ValueAction
+    if (action.card) invalidateCard(action.card);
+    return;
+  }
+  TYPE_CASE_(action, DelayedScriptsEvent) {
+    // scripts that depend on typed text were updated after the ValueAction
+    refreshChangedCards();
     return;
   }
   TYPE_CASE(action, ValueAction) {
-    if (action.card) refreshList(true);
+    if (action.card) {
+      invalidateCard(action.card.get());
+      refreshChangedCards();
+    } else {
+      // a set value, the color script can depend on it
+      invalidateColors();
+      if (!changed_cards.empty()) refreshChangedCards();
+    }
+  }
+  TYPE_CASE_(action, DisplayChangeAction) {
+    // stylesheet changes, the color script can depend on them
+    invalidateColors();
   }
 }
 
@@ -132,6 +151,15 @@ void CardListBase::getSelection(vector<CardP>& out) const {
   }
 }
 
+void CardListBase::getNeighbours(long depth, vector<CardP>& out) const {
+  if (selected_item_pos < 0) return;
+  long count = (long)sorted_list.size();
+  for (long d = 1 ; d <= depth ; ++d) {
+    if (selected_item_pos + d < count) out.push_back(getCard(selected_item_pos + d));
+    if (selected_item_pos - d >= 0)    out.push_back(getCard(selected_item_pos - d));
+  }
+}
+
 // ----------------------------------------------------------------------------- : CardListBase : Clipboard
 
 bool CardListBase::canCut()   const { return canDelete(); }
@@ -185,26 +213,139 @@ bool CardListBase::doDelete() {
 
 // Comparison object for comparing cards
 bool CardListBase::compareItems(void* a, void* b) const {
-  FieldP sort_field = column_fields[sort_by_column];
-  ValueP va = reinterpret_cast<Card*>(a)->data[sort_field];
-  ValueP vb = reinterpret_cast<Card*>(b)->data[sort_field];
-  assert(va && vb);
-  // compare sort keys
-  int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
-  if (cmp != 0) return cmp < 0;
+  return compareSortKeys(*reinterpret_cast<Card*>(a), *reinterpret_cast<Card*>(b)) < 0;
+}
+
+int CardListBase::compareSortKeys(const Card& a, const Card& b) const {
+  const Field& sort_field = *column_fields[sort_by_column];
+  int cmp = smart_compare(sortKey(a, sort_field), sortKey(b, sort_field));
+  if (cmp != 0) return cmp;
   // equal values, compare alternate sort key
   if (alternate_sort_field) {
-    ValueP va = reinterpret_cast<Card*>(a)->data[alternate_sort_field];
-    ValueP vb = reinterpret_cast<Card*>(b)->data[alternate_sort_field];
-    int cmp = smart_compare( va->getSortKey(), vb->getSortKey() );
-    if (cmp != 0) return cmp < 0;
+    return smart_compare(sortKey(a, *alternate_sort_field), sortKey(b, *alternate_sort_field));
+  }
+  return 0;
+}
+
+CardListBase::CachedCard& CardListBase::cachedCard(const Card& card, const Field& field) const {
+  CachedCard& cc = cached_cards[&card];
+  if (cc.sort_keys.size() <= field.index) {
+    size_t count = max(field.index + 1, set->game->card_fields.size());
+    cc.sort_keys.resize(count);
+    cc.texts.resize(count);
+    cc.sort_key_known.resize(count, false);
+    cc.text_known.resize(count, false);
+  }
+  return cc;
+}
+
+const String& CardListBase::sortKey(const Card& card, const Field& field) const {
+  CachedCard& cc = cachedCard(card, field);
+  if (!cc.sort_key_known[field.index]) {
+    const ValueP& value = card.data.at(field.index);
+    assert(value);
+    cc.sort_keys[field.index]      = value->getSortKey();
+    cc.sort_key_known[field.index] = true;
+  }
+  return cc.sort_keys[field.index];
+}
+
+void CardListBase::invalidateCard(const Card* card) {
+  // cards that are not in a filtered list are not cached, but the filter might keep them now
+  if ((cached_cards.erase(card) || cardFilter()) && sort_by_column >= 0) {
+    changed_cards.push_back(card);
+  }
+}
+
+void CardListBase::invalidateColors() {
+  if (!set || !set->game->card_list_color_script) return;
+  FOR_EACH(c, cached_cards) {
+    c.second.color_known = false;
+  }
+  Refresh(false);
+}
+
+void CardListBase::sortItems() {
+  changed_cards.clear();
+  card_order.clear();
+  // remember the order of the set, for moving single cards later
+  if (listsAllCards() || cardFilter()) {
+    for (size_t i = 0 ; i < set->cards.size() ; ++i) {
+      card_order[set->cards[i].get()] = i;
+    }
+  }
+  // look up the keys once, instead of for every comparison
+  struct SortItem {
+    const String* key;
+    const String* alternate_key;
+    VoidP         item;
+  };
+  vector<SortItem> items;
+  items.reserve(sorted_list.size());
+  const Field& sort_field = *column_fields[sort_by_column];
+  FOR_EACH(item, sorted_list) {
+    const Card& card = *static_cast<Card*>(item.get());
+    items.push_back(SortItem{
+      &sortKey(card, sort_field),
+      alternate_sort_field ? &sortKey(card, *alternate_sort_field) : nullptr,
+      item
+    });
+  }
+  bool ascending = sort_ascending;
+  stable_sort(items.begin(), items.end(), [ascending](const SortItem& a, const SortItem& b) {
+    int cmp = smart_compare(*a.key, *b.key);
+    if (cmp == 0 && a.alternate_key) cmp = smart_compare(*a.alternate_key, *b.alternate_key);
+    return ascending ? cmp < 0 : cmp > 0;
+  });
+  for (size_t i = 0 ; i < items.size() ; ++i) {
+    sorted_list[i] = items[i].item;
   }
-  return false;
+}
+
+void CardListBase::refreshChangedCards() {
+  // Moving single cards only works if we know where they are in the set,
+  // and only pays off if few cards have changed
+  const Filter<Card>* filter = listsAllCards() ? nullptr : cardFilter();
+  if (sort_by_column < 0 || (!listsAllCards() && !filter) || card_order.size() != set->cards.size() || changed_cards.size() * 8 > sorted_list.size()) {
+    refreshList(true);
+    return;
+  }
+  sort(changed_cards.begin(), changed_cards.end());
+  changed_cards.erase(unique(changed_cards.begin(), changed_cards.end()), changed_cards.end());
+  // a card comes before another if it has a smaller key, or an equal key and an earlier position in the set
+  auto before = [this](const VoidP& a, const VoidP& b) {
+    const Card* card_a = static_cast<Card*>(a.get());
+    const Card* card_b = static_cast<Card*>(b.get());
+    int cmp = compareSortKeys(*card_a, *card_b);
+    if (cmp != 0) return sort_ascending ? cmp < 0 : cmp > 0;
+    return card_order.at(card_a) < card_order.at(card_b);
+  };
+  bool moved = false;
+  FOR_EACH(card, changed_cards) {
+    auto pos_in_set = card_order.find(card);
+    if (pos_in_set == card_order.end()) continue; // the card is no longer in the set
+    VoidP item = set->cards.at(pos_in_set->second);
+    if (item.get() != card) {
+      // the set has been reordered
+      changed_cards.clear();
+      refreshList(true);
+      return;
+    }
+    bool keep = !filter || filter->keep(*card);
+    pair<long,long> pos = move_sorted_item(sorted_list, item, keep, before);
+    if (pos.first != pos.second) moved = true; // moved, or the filter changed its mind
+    else if (pos.first >= 0) RefreshItem(pos.first);
+  }
+  changed_cards.clear();
+  refreshControl(!moved);
 }
 
 void CardListBase::rebuild() {
   ClearAll();
   column_fields.clear();
+  cached_cards.clear();
+  card_order.clear();
+  changed_cards.clear();
   selected_item_pos = -1;
   onRebuild();
   if (!set) return;
@@ -309,9 +450,15 @@ String CardListBase::OnGetItemText(long pos, long col) const {
     // wx may give us non existing columns!
     return wxEmptyString;
   }
-  ValueP val = getCard(pos)->data[column_fields[col]];
-  if (val) return val->toString();
-  else     return wxEmptyString;
+  const Card& card = *getCard(pos);
+  const Field& field = *column_fields[col];
+  CachedCard& cc = cachedCard(card, field);
+  if (!cc.text_known[field.index]) {
+    const ValueP& val = card.data.at(field.index);
+    if (val) cc.texts[field.index] = val->toString();
+    cc.text_known[field.index] = true;
+  }
+  return cc.texts[field.index];
 }
 
 int CardListBase::OnGetItemImage(long pos) const {
@@ -320,8 +467,14 @@ int CardListBase::OnGetItemImage(long pos) const {
 
 wxListItemAttr* CardListBase::OnGetItemAttr(long pos) const {
   if (!set->game->card_list_color_script) return nullptr;
-  Context& ctx = set->getContext(getCard(pos));
-  item_attr.SetTextColour(set->game->card_list_color_script.invoke(ctx)->toColor());
+  CardP card = getCard(pos);
+  CachedCard& cc = cached_cards[card.get()];
+  if (!cc.color_known) {
+    Context& ctx = set->getContext(card);
+    cc.color       = set->game->card_list_color_script.invoke(ctx)->toColor();
+    cc.color_known = true;
+  }
+  item_attr.SetTextColour(cc.color);
   return &item_attr;
 }
 
@@ -12,6 +12,8 @@
 #include <gui/control/item_list.hpp>
 #include <data/card.hpp>
 #include <data/set.hpp>
+#include <data/filter.hpp>
+#include <gfx/color.hpp>
 
 DECLARE_POINTER_TYPE(ChoiceField);
 DECLARE_POINTER_TYPE(Field);
@@ -90,6 +92,8 @@ public:
   inline CardP getCard(long pos) const { return static_pointer_cast<Card>(getItem(pos)); }
   /// Get a list of all focused cards
   void getSelection(vector<CardP>& out) const;
+  /// Get the cards up to depth positions after and before the selected card, nearest first
+  void getNeighbours(long depth, vector<CardP>& out) const;
 protected:
   /// Get a list of all cards
   void getItems(vector<VoidP>& out) const override;
@@ -108,6 +112,14 @@ protected:
   void sendEvent(int type = EVENT_CARD_SELECT);
   /// Compare cards
   bool compareItems(void* a, void* b) const override;
+  /// Sort cards, using the cached sort keys
+  void sortItems() override;
+  /// Does getItems() give all cards in the set, in order?
+  /** If so, a card with a changed sort key can be moved to its new position without rebuilding the list. */
+  virtual bool listsAllCards() const { return true; }
+  /// If the list shows the cards of the set for which a filter keeps them, that filter
+  /** Changed cards are then tested against the filter, and added to or removed from the list on their own. */
+  virtual const Filter<Card>* cardFilter() const { return nullptr; }
   
   // --------------------------------------------------- : Item 'events'
   
@@ -128,6 +140,33 @@ private:
   
   mutable wxListItemAttr item_attr; // for OnGetItemAttr
   
+  /// What is shown of a card and how it is sorted, computed when needed
+  /** Values are by field index */
+  struct CachedCard {
+    vector<String> sort_keys;
+    vector<String> texts;       ///< Text in the columns
+    vector<bool>   sort_key_known, text_known;
+    Color          color;       ///< Text color, from the card_list_color_script
+    bool           color_known = false;
+  };
+  mutable unordered_map<const Card*,CachedCard> cached_cards;
+  unordered_map<const Card*,size_t> card_order; ///< Position of the cards in the set when the list was sorted
+  vector<const Card*> changed_cards;             ///< Cards with a changed sort key (or filter result) since the list was sorted
+  
+  /// The cache entry for a card, with room for the given field
+  CachedCard& cachedCard(const Card& card, const Field& field) const;
+  /// The (cached) sort key of a value on a card
+  const String& sortKey(const Card& card, const Field& field) const;
+  /// Compare the sort keys of two cards, for sort_by_column and then alternate_sort_field
+  int compareSortKeys(const Card& a, const Card& b) const;
+  /// Forget what is cached for a card, after one of its values has changed
+  /** Everything is forgotten, since sort scripts and the color script can depend on other values of the card. */
+  void invalidateCard(const Card* card);
+  /// Forget the colors of all cards, they may depend on things other than the card
+  void invalidateColors();
+  /// Move the changed_cards to their new position and refresh them, adding or removing them if the filter changed its mind
+  void refreshChangedCards();
+  
 public:
   /// Open a dialog for selecting columns to be shown
   void selectColumns();
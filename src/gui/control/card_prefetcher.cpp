@@ -0,0 +1,136 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gui/control/card_prefetcher.hpp>
+#include <gui/control/card_list.hpp>
+#include <data/set.hpp>
+#include <data/stylesheet.hpp>
+#include <data/settings.hpp>
+#include <data/action/set.hpp>
+#include <data/action/value.hpp>
+
+// ----------------------------------------------------------------------------- : CardPrefetcher
+
+bool CardPrefetcher::prefetch(const CardListBase& list, const CardP& shown_card) {
+  if (!set) return false;
+  vector<CardP> neighbours;
+  list.getNeighbours(settings.card_prefetch_depth, neighbours);
+  // throw away cards that are no longer near the selection
+  for (auto it = images.begin() ; it != images.end() ; ) {
+    if (find(neighbours.begin(), neighbours.end(), it->first) == neighbours.end()) {
+      it = images.erase(it);
+      counters.wasted++;
+    } else {
+      ++it;
+    }
+  }
+  // draw the nearest card that is not drawn yet
+  FOR_EACH(neighbour, neighbours) {
+    if (images.count(neighbour)) continue;
+    bool ok = true;
+    try {
+      setCard(neighbour);
+      RealSize size = getRotation().getExternalSize();
+      Bitmap image((int) size.width, (int) size.height);
+      if (image.Ok()) {
+        wxMemoryDC dc;
+        dc.SelectObject(image);
+        draw(dc);
+        dc.SelectObject(wxNullBitmap);
+        images[neighbour] = image;
+        counters.prefetched++;
+      } else {
+        ok = false;
+      }
+    } catch (const Error& e) {
+      handle_error(e);
+      ok = false;
+    }
+    // Drawing changed the styles for the neighbour, while redrawing the editor was suppressed.
+    // Change them back, the editor is told about the styles that differ, and redraws those parts.
+    if (shown_card) {
+      try {
+        set->updateStyles(shown_card, false);
+      } catch (const Error& e) {
+        handle_error(e);
+      }
+    }
+    return ok;
+  }
+  return false;
+}
+
+Bitmap CardPrefetcher::takeImage(const CardP& card) {
+  auto it = images.find(card);
+  if (it == images.end()) return Bitmap();
+  Bitmap image = it->second;
+  images.erase(it);
+  return image;
+}
+
+void CardPrefetcher::recordSwitch(bool prefetched, double latency) {
+  counters.switches++;
+  if (prefetched) counters.hits++;
+  counters.total_latency += latency;
+  counters.max_latency = max(counters.max_latency, latency);
+}
+
+DrawWhat CardPrefetcher::drawWhat(const ValueViewer*) const {
+  // as drawn by the card editor, without anything selected
+  StyleSheetSettings& ss = settings.stylesheetSettingsFor(set->stylesheetFor(card));
+  return (DrawWhat)( DRAW_NORMAL
+                   | DRAW_BORDERS * ss.card_borders()
+                   | (DRAW_BOXES | DRAW_EDITING) * ss.card_draw_editing()
+                   | DRAW_ERRORS );
+}
+
+void CardPrefetcher::clearImages() {
+  counters.wasted += images.size();
+  images.clear();
+}
+
+void CardPrefetcher::dropImage(const Card* card) {
+  for (auto it = images.begin() ; it != images.end() ; ++it) {
+    if (it->first.get() == card) {
+      images.erase(it);
+      counters.wasted++;
+      return;
+    }
+  }
+}
+
+void CardPrefetcher::onChangeSet() {
+  clearImages();
+  DataViewer::onChangeSet();
+}
+
+void CardPrefetcher::onAction(const Action& action, bool undone) {
+  DataViewer::onAction(action, undone);
+  TYPE_CASE(action, ValueAction) {
+    if (action.card) {
+      // only this card looks different
+      dropImage(action.card.get());
+      return;
+    }
+  }
+  TYPE_CASE(action, ScriptValueEvent) {
+    if (action.card) {
+      dropImage(action.card);
+    } else {
+      // a set value, it can be used on all cards
+      clearImages();
+    }
+    return;
+  }
+  // the cards themselves are not changed, the neighbours are checked in prefetch()
+  TYPE_CASE_(action, CardListAction)      return;
+  TYPE_CASE_(action, DelayedScriptsEvent) return;
+  // anything else can change the look of all cards
+  clearImages();
+}
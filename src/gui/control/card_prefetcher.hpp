@@ -0,0 +1,70 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <render/card/viewer.hpp>
+
+class CardListBase;
+
+// ----------------------------------------------------------------------------- : CardPrefetcher
+
+/// Draws the cards around the selected card of a card list in advance
+/** The cards up to settings.card_prefetch_depth positions before and after the selected card
+ *  are drawn to bitmaps, the same way a CardViewer would draw them. When one of them is selected,
+ *  the editor can show the bitmap right away, instead of first updating the styles and drawing the card.
+ *
+ *  Drawing stays on the main thread: styles are shared by all cards using a stylesheet,
+ *  so a card can not be drawn while another one is shown. Instead one card is drawn per call to prefetch(),
+ *  which should be called when the application is idle. Afterwards the styles are updated for the shown card again.
+ *
+ *  Bitmaps are thrown away when the card changes, or when anything else changes that could affect its look.
+ */
+class CardPrefetcher : public DataViewer {
+public:
+  /// Draw the nearest neighbour of the selected card in the list that has not been drawn yet
+  /** Afterwards the styles are updated for shown_card, the card in the editor.
+   *  Returns true if a card was drawn, false if there is nothing left to do */
+  bool prefetch(const CardListBase& list, const CardP& shown_card);
+  /// Take the bitmap of a card out of the cache, returns an invalid bitmap if there is none
+  Bitmap takeImage(const CardP& card);
+  /// Record how long it took to switch to a card, in milliseconds
+  void recordSwitch(bool prefetched, double latency);
+  
+  DrawWhat drawWhat(const ValueViewer*) const override;
+  // the card is drawn on a bitmap of its own
+  bool useCompositingSurface() const override { return true; }
+  
+  void onChangeSet() override;
+  
+  /// Statistics, for profiling
+  struct Stats {
+    size_t switches;      ///< Number of card switches
+    size_t hits;          ///< Number of switches to a card that was drawn in advance
+    size_t prefetched;    ///< Number of cards drawn in advance
+    size_t wasted;        ///< Number of cards drawn in advance that were thrown away
+    double total_latency; ///< Total time of the switches, in milliseconds
+    double max_latency;
+    inline double averageLatency() const { return switches ? total_latency / switches : 0; }
+  };
+  inline const Stats& stats() const { return counters; }
+  
+protected:
+  void onAction(const Action&, bool undone) override;
+  
+private:
+  map<CardP,Bitmap> images; ///< Cards that have been drawn
+  Stats counters = Stats();
+  
+  /// Throw away all images
+  void clearImages();
+  /// Throw away the image of a card, if there is one
+  void dropImage(const Card* card);
+};
+
@@ -16,12 +16,14 @@
 // ----------------------------------------------------------------------------- : Events
 
 DEFINE_EVENT_TYPE(EVENT_SIZE_CHANGE);
+DEFINE_EVENT_TYPE(EVENT_CARD_PAINTED);
 
 // ----------------------------------------------------------------------------- : CardViewer
 
 CardViewer::CardViewer(Window* parent, int id, long style)
   : wxControl(parent, id, wxDefaultPosition, wxDefaultSize, style)
   , up_to_date(false)
+  , draw_later(false)
 {
   SetBackgroundStyle(wxBG_STYLE_PAINT);
 }
@@ -57,6 +59,36 @@ void CardViewer::redraw() {
   Refresh(false);
 }
 
+bool CardViewer::showImage(const Bitmap& image) {
+  wxSize cs = GetClientSize();
+  if (!image.Ok() || image.GetWidth() != cs.GetWidth() || image.GetHeight() != cs.GetHeight()) return false;
+  buffer = image;
+  up_to_date = true;
+  draw_later = true;
+  Refresh(false);
+  return true;
+}
+
+void CardViewer::onIdle(wxIdleEvent& ev) {
+  if (draw_later) {
+    draw_later = false;
+    if (drawsPlainCard()) {
+      // the image is what we would draw, but the styles are not yet updated for this card,
+      // and the viewers need to be prepared before they can be clicked on
+      wxMemoryDC dc;
+      dc.SelectObject(buffer);
+      try {
+        prepare(dc);
+      } CATCH_ALL_ERRORS(false);
+      dc.SelectObject(wxNullBitmap);
+    } else {
+      // the image didn't include the selection
+      redraw();
+    }
+  }
+  ev.Skip();
+}
+
 void CardViewer::onChangeSize() {
   InvalidateBestSize();
   wxSize ws = GetSize(), cs = GetClientSize();
@@ -88,20 +120,25 @@ void CardViewer::onPaint(wxPaintEvent&) {
     buffer = Bitmap(cs.GetWidth(), cs.GetHeight());
     up_to_date = false;
   }
-  wxBufferedPaintDC dc(this, buffer);
-  // scrolling
+  {
+    wxBufferedPaintDC dc(this, buffer);
+    // scrolling
 //  int dx = GetScrollPos(wxHORIZONTAL), dy = GetScrollPos(wxVERTICAL);
 //  dc.SetDeviceOrigin(-dx, -dy);
-  wxRegion clip = GetUpdateRegion();
+    wxRegion clip = GetUpdateRegion();
 //  clip.Offset(dx, dy);
-  dc.SetDeviceClippingRegion(clip);
-  // draw
-  if (!up_to_date) {
-    up_to_date = true;
-    try {
-      draw(dc);
-    } CATCH_ALL_ERRORS(false); // don't show message boxes in onPaint!
-  }
+    dc.SetDeviceClippingRegion(clip);
+    // draw
+    if (!up_to_date) {
+      up_to_date = true;
+      draw_later = false;
+      try {
+        draw(dc);
+      } CATCH_ALL_ERRORS(false); // don't show message boxes in onPaint!
+    }
+  } // the buffer is copied to the screen here
+  wxCommandEvent ev(EVENT_CARD_PAINTED, GetId());
+  ProcessEvent(ev);
 }
 
 void CardViewer::drawViewer(RotatedDC& dc, ValueViewer& v) {
@@ -157,4 +194,5 @@ Rotation CardViewer::getRotation() const {
 
 BEGIN_EVENT_TABLE(CardViewer, wxControl)
   EVT_PAINT(CardViewer::onPaint)
+  EVT_IDLE (CardViewer::onIdle)
 END_EVENT_TABLE  ()
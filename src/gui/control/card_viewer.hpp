@@ -17,6 +17,10 @@
 DECLARE_LOCAL_EVENT_TYPE(EVENT_SIZE_CHANGE, <not used>)
 /// Handle EVENT_SIZE_CHANGE events
 #define EVT_SIZE_CHANGE(id, handler) EVT_COMMAND(id, EVENT_SIZE_CHANGE, handler)
+/// Event that indicates a CardViewer has been painted on the screen
+DECLARE_LOCAL_EVENT_TYPE(EVENT_CARD_PAINTED, <not used>)
+/// Handle EVENT_CARD_PAINTED events
+#define EVT_CARD_PAINTED(id, handler) EVT_COMMAND(id, EVENT_CARD_PAINTED, handler)
 
 // ----------------------------------------------------------------------------- : CardViewer
 
@@ -34,6 +38,14 @@ public:
   /// Invalidate and redraw (the area of) a single value viewer
   void redraw(const ValueViewer&) override;
   
+  /// Show an image of the current card that was drawn in advance
+  /** The viewers are prepared in idle time. If the card should look different from the image,
+   *  because something is selected, it is drawn again then.
+   *  Returns false if the image can't be used because it doesn't have the size of the control */
+  bool showImage(const Bitmap& image);
+  /// Is the card on the screen drawn, and not waiting to be drawn again?
+  inline bool isUpToDate() const { return up_to_date && !draw_later; }
+  
   /// The rotation to use
   Rotation getRotation() const override;
   
@@ -48,6 +60,8 @@ protected:
   
   /// Should the given viewer be drawn?
   bool shouldDraw(const ValueViewer&) const;
+  /// Does the card look the same as when a CardPrefetcher draws it, so with nothing selected?
+  virtual bool drawsPlainCard() const { return false; }
   
   void drawViewer(RotatedDC& dc, ValueViewer& v) override;
   
@@ -55,9 +69,11 @@ private:
   DECLARE_EVENT_TABLE();
   
   void onPaint(wxPaintEvent&);
+  void onIdle(wxIdleEvent&);
   
   Bitmap buffer;     ///< Off-screen buffer we draw to
   bool   up_to_date; ///< Is the buffer up to date?
+  bool   draw_later; ///< Does the buffer contain an image from showImage, for which the viewers are not yet prepared?
   
   class OverdrawDC;
   class OverdrawDC_aux;
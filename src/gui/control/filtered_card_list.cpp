@@ -31,3 +31,7 @@ void FilteredCardList::getItems(vector<VoidP>& out) const {
     filter->getItems(set->cards,out);
   }
 }
+
+const Filter<Card>* FilteredCardList::cardFilter() const {
+  return filter && filter->selectsWithKeep() ? filter.get() : nullptr;
+}
@@ -27,6 +27,8 @@ public:
 protected:
   /// Get only the subset of the cards
   void getItems(vector<VoidP>& out) const override;
+  bool listsAllCards() const override { return false; }
+  const Filter<Card>* cardFilter() const override;
   
   void onChangeSet() override;
   
@@ -12,6 +12,7 @@
 #include <gfx/gfx.hpp>
 #include <wx/dcbuffer.h>
 #include <wx/tooltip.h>
+#include <bitset>
 
 template <typename T> inline T sgn(T v) { return v < 0 ? -1 : 1; }
 
@@ -160,51 +161,67 @@ GraphData::GraphData(const GraphDataPre& d)
     }
     ++i;
   }
-  // count elements in each position
-  values.reserve(d.elements.size());
-  size_t de_size = sizeof(GraphDataElement) + sizeof(int) * (axes.size() - 1);
+  // find the group of each element on each axis
+  size = (UInt)d.elements.size();
+  original_indices.reserve(size);
   FOR_EACH_CONST(e, d.elements) {
-    // make the group_nrs large enough
-    GraphDataElement* de = reinterpret_cast<GraphDataElement*>(new char[de_size]);
-    de->original_index = e->original_index;
-    // find index j in elements
-    int i = 0;
-    FOR_EACH(a, axes) {
-      String v = e->values[i];
-      de->group_nrs[i] = -1;
+    original_indices.push_back(e->original_index);
+  }
+  unique_indices = adjacent_find(original_indices.begin(), original_indices.end()) == original_indices.end();
+  size_t words = (size + 63) / 64;
+  all_bits.assign(words, 0);
+  for (size_t e = 0 ; e < size ; ++e) {
+    all_bits[e / 64] |= 1ull << (e % 64);
+  }
+  group_nrs.resize(axes.size());
+  axis_bits.resize(axes.size());
+  group_bits.resize(axes.size());
+  i = 0;
+  FOR_EACH(a, axes) {
+    // the first group with each name
+    map<String,int> group_of;
+    for (int j = (int)a->groups.size() - 1 ; j >= 0 ; --j) {
+      group_of[a->groups[j].name] = j;
+    }
+    vector<int>&  nrs     = group_nrs[i];
+    Bits&         in_axis = axis_bits[i];
+    vector<Bits>& bits    = group_bits[i];
+    nrs.resize(size, -1);
+    in_axis.assign(words, 0);
+    bits.assign(a->groups.size(), Bits(words, 0));
+    for (size_t e = 0 ; e < size ; ++e) {
+      const String& v = d.elements[e]->values[i];
+      int nr = -1;
       double d;
       if (a->numeric && a->bin_size > 0 && v.ToDouble(&d)) {
         // calculate group that contains v
-        de->group_nrs[i] = bin_to_group(d, a->bin_size);
+        nr = bin_to_group(d, a->bin_size);
       } else {
         // find group that contains v
-        int j = 0;
-        FOR_EACH(g, a->groups) {
-          if (v == g.name) {
-            de->group_nrs[i] = j;
-            break;
-          }
-          ++j;
-        }
+        map<String,int>::const_iterator it = group_of.find(v);
+        if (it != group_of.end()) nr = it->second;
       }
-      ++i;
+      nrs[e] = nr;
+      if (nr == -1) continue;
+      in_axis[e / 64] |= 1ull << (e % 64);
+      if (nr < 0) continue;
+      if ((size_t)nr >= bits.size()) bits.resize(nr + 1, Bits(words, 0));
+      bits[nr][e / 64] |= 1ull << (e % 64);
     }
-    values.push_back(de);
+    ++i;
   }
 }
 
-GraphData::~GraphData() {
-  FOR_EACH_CONST(v,values) delete v;
-}
-
 void GraphData::crossAxis(size_t axis1, size_t axis2, vector<UInt>& out) const {
   size_t a1_size = axes[axis1]->groups.size();
   size_t a2_size = axes[axis2]->groups.size();
   out.clear();
   out.resize(a1_size * a2_size, 0);
-  FOR_EACH_CONST(v, values) {
-    int v1 = v->group_nrs[axis1], v2 = v->group_nrs[axis2];
-    if (v1 >= 0 && v2 >= 0) {
+  const vector<int>& nrs1 = group_nrs[axis1];
+  const vector<int>& nrs2 = group_nrs[axis2];
+  for (size_t e = 0 ; e < size ; ++e) {
+    int v1 = nrs1[e], v2 = nrs2[e];
+    if (v1 >= 0 && v2 >= 0 && (size_t)v1 < a1_size && (size_t)v2 < a2_size) {
       out[a2_size * v1 + v2]++;
     }
   }
@@ -216,43 +233,73 @@ void GraphData::crossAxis(size_t axis1, size_t axis2, size_t axis3, vector<UInt>
   size_t a3_size = axes[axis3]->groups.size();
   out.clear();
   out.resize(a1_size * a2_size * a3_size, 0);
-  FOR_EACH_CONST(v, values) {
-    int v1 = v->group_nrs[axis1], v2 = v->group_nrs[axis2], v3 = v->group_nrs[axis3];
-    if (v1 >= 0 && v2 >= 0 && v3 >= 0) {
+  const vector<int>& nrs1 = group_nrs[axis1];
+  const vector<int>& nrs2 = group_nrs[axis2];
+  const vector<int>& nrs3 = group_nrs[axis3];
+  for (size_t e = 0 ; e < size ; ++e) {
+    int v1 = nrs1[e], v2 = nrs2[e], v3 = nrs3[e];
+    if (v1 >= 0 && v2 >= 0 && v3 >= 0 && (size_t)v1 < a1_size && (size_t)v2 < a2_size && (size_t)v3 < a3_size) {
       out[a3_size * (a2_size * v1 + v2) + v3]++;
     }
   }
 }
 
-bool matches(const GraphDataElement* v, const vector<int>& match) {
+/// Number of bits that are set
+inline UInt count_bits(unsigned long long x) {
+  return (UInt)bitset<64>(x).count();
+}
+
+bool GraphData::matching(const vector<int>& match, Bits& out) const {
+  if (match.size() != axes.size()) return false;
+  out = all_bits;
   for (size_t i = 0 ; i < match.size() ; ++i) {
-    if (v->group_nrs[i] == -1 || (match[i] != -1 && v->group_nrs[i] != match[i])) {
-      return false;
+    const Bits* bits;
+    if (match[i] == -1) {
+      bits = &axis_bits[i];
+    } else if (match[i] >= 0 && (size_t)match[i] < group_bits[i].size()) {
+      bits = &group_bits[i][match[i]];
+    } else {
+      return false; // no elements in this group
+    }
+    for (size_t w = 0 ; w < out.size() ; ++w) {
+      out[w] &= (*bits)[w];
     }
   }
   return true;
 }
 
 UInt GraphData::count(const vector<int>& match) const {
-  if (match.size() != axes.size()) return 0;
+  Bits bits;
+  if (!matching(match, bits)) return 0;
   UInt count = 0;
+  if (unique_indices) {
+    FOR_EACH(w, bits) count += count_bits(w);
+    return count;
+  }
   size_t prev_index = (size_t)-1;
-  FOR_EACH_CONST(v, values) {
-    if (matches(v, match) && v->original_index != prev_index) {
-      prev_index = v->original_index; // don't count the same index twice
-      count += matches(v, match);
+  for (size_t w = 0 ; w < bits.size() ; ++w) {
+    for (unsigned long long word = bits[w] ; word ; word &= word - 1) {
+      size_t e = w * 64 + count_bits((word & (~word + 1)) - 1); // lowest set bit
+      if (original_indices[e] != prev_index) {
+        prev_index = original_indices[e]; // don't count the same index twice
+        ++count;
+      }
     }
   }
   return count;
 }
 
 void GraphData::indices(const vector<int>& match, vector<size_t>& out) const {
-  if (match.size() != axes.size()) return;
+  Bits bits;
+  if (!matching(match, bits)) return;
   size_t prev_index = (size_t)-1;
-  FOR_EACH_CONST(v, values) {
-    if (matches(v, match) && v->original_index != prev_index) {
-      prev_index = v->original_index; // don't select the same index twice
-      out.push_back(v->original_index);
+  for (size_t w = 0 ; w < bits.size() ; ++w) {
+    for (unsigned long long word = bits[w] ; word ; word &= word - 1) {
+      size_t e = w * 64 + count_bits((word & (~word + 1)) - 1); // lowest set bit
+      if (original_indices[e] != prev_index) {
+        prev_index = original_indices[e]; // don't select the same index twice
+        out.push_back(original_indices[e]);
+      }
     }
   }
 }
@@ -100,30 +100,39 @@ public:
   void splitList(size_t axis);
 };
 
-/// A single data point of a graph
-struct GraphDataElement {
-  size_t original_index;
-  int    group_nrs[1];   ///< Group number for each axis
-};
-
 /// Data to be displayed in a graph
+/** The elements are stored per axis: group_nrs[axis][element] is the group of the element on that axis.
+ *  For each group there is also a bitset of the elements in it, so counting or selecting the elements
+ *  that match a combination of groups comes down to intersecting a few bitsets.
+ */
 class GraphData : public IntrusivePtrBase<GraphData> {
 public:
   GraphData(const GraphDataPre&);
-  ~GraphData();
   
-  vector<GraphAxisP>        axes;    ///< The axes in the data
-  vector<GraphDataElement*> values;  ///< All elements, with the group number for each axis, or -1
-  UInt                      size;    ///< Total number of elements
+  vector<GraphAxisP>  axes;             ///< The axes in the data
+  vector<size_t>      original_indices; ///< The original_index of each element, in increasing order
+  vector<vector<int>> group_nrs;        ///< For each axis, the group number of each element, or -1
+  UInt                size;             ///< Total number of elements
   
   /// Create a cross table for two axes
   void crossAxis(size_t axis1, size_t axis2, vector<UInt>& out) const;
   /// Create a cross table for three axes
   void crossAxis(size_t axis1, size_t axis2, size_t axis3, vector<UInt>& out) const;
   /// Count the number of elements with the given values, -1 is a wildcard
+  /** Elements with the same original_index (from GraphDataPre::splitList) are counted once */
   UInt count(const vector<int>& match) const;
   /// Get the original_indices of elements matching the selection
   void indices(const vector<int>& match, vector<size_t>& out) const;
+  
+private:
+  typedef vector<unsigned long long> Bits; ///< Set of elements, one bit per element
+  Bits                 all_bits;       ///< All elements
+  vector<Bits>         axis_bits;      ///< For each axis, the elements that are in a group
+  vector<vector<Bits>> group_bits;     ///< For each axis and group number, the elements in that group
+  bool                 unique_indices; ///< Does every element have a different original_index?
+  
+  /// Find the elements that match a selection, returns false if there are none
+  bool matching(const vector<int>& match, Bits& out) const;
 };
 
 
@@ -50,11 +50,12 @@ ImageFieldP ImageCardList::findImageField() {
 /// A request for a thumbnail of a card image
 class CardThumbnailRequest : public ThumbnailRequest {
 public:
-  CardThumbnailRequest(ImageCardList* parent, const LocalFileName& filename)
+  CardThumbnailRequest(ImageCardList* parent, const LocalFileName& filename, int priority)
     : ThumbnailRequest(
       parent,
       _("card") + parent->set->absoluteFilename() + _("-") + filename.toStringForKey(),
-      wxDateTime::Now())  // TODO: Find mofication time of card image
+      wxDateTime::Now(),  // TODO: Find mofication time of card image
+      priority)
     , filename(filename)
   {}
   Image generate() override {
@@ -98,8 +99,10 @@ int ImageCardList::OnGetItemImage(long pos) const {
     if (it != thumbnails.end()) {
       return it->second;
     } else {
-      // request a thumbnail
-      thumbnail_thread.request(make_intrusive<CardThumbnailRequest>(const_cast<ImageCardList*>(this), val.filename));
+      // request a thumbnail, rows that are on screen go first
+      long top = GetTopItem();
+      int priority = pos >= top && pos < top + GetCountPerPage() ? 1 : 0;
+      thumbnail_thread.request(make_intrusive<CardThumbnailRequest>(const_cast<ImageCardList*>(this), val.filename, priority));
     }
   }
   return -1;
@@ -138,3 +141,7 @@ void FilteredImageCardList::getItems(vector<VoidP>& out) const {
     ImageCardList::getItems(out);
   }
 }
+
+const Filter<Card>* FilteredImageCardList::cardFilter() const {
+  return filter && filter->selectsWithKeep() ? filter.get() : nullptr;
+}
@@ -170,10 +170,18 @@ void ItemList::refreshList(bool refresh_current_only) {
   getItems(sorted_list);
   // Sort the list
   if (sort_by_column >= 0) {
-    stable_sort(sorted_list.begin(), sorted_list.end(), ItemComparer(*this));
+    sortItems();
   }
   // Has the entire list changed?
-  if (refresh_current_only && sorted_list == old_sorted_list) {
+  refreshControl(refresh_current_only && sorted_list == old_sorted_list);
+}
+
+void ItemList::sortItems() {
+  stable_sort(sorted_list.begin(), sorted_list.end(), ItemComparer(*this));
+}
+
+void ItemList::refreshControl(bool only_current) {
+  if (only_current) {
     if (selected_item_pos >= 0) RefreshItem(selected_item_pos);
     return;
   }
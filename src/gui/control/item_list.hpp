@@ -67,6 +67,9 @@ protected:
   virtual bool mustSort() const { return false; }
   /// Compare two items for < based on sort_by_column (not on sort_ascending)
   virtual bool compareItems(void* a, void* b) const = 0;
+  /// Sort the sorted_list by sort_by_column, keeping the order of equal items
+  /** By default uses compareItems */
+  virtual void sortItems();
   
   // --------------------------------------------------- : Protected interface
   /// Return the card at the given position in the sorted list
@@ -75,6 +78,9 @@ protected:
   virtual void sortBy(long column, bool ascending);
   /// Refresh the card list (resort, refresh and reselect current item)
   void refreshList(bool refresh_current_only = false);
+  /// Update the control after the sorted_list has changed, and reselect the current item
+  /** If only_current, the order of the items has not changed, and only the current item is redrawn */
+  virtual void refreshControl(bool only_current = false);
   /// Set the image of a column header (fixes wx bug)
   void SetColumnImage(int col, int image);
   
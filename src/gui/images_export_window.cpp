@@ -16,6 +16,7 @@
 #include <script/context.hpp>
 #include <util/tagged_string.hpp>
 #include <wx/filename.h>
+#include <wx/spinctrl.h>
 
 // ----------------------------------------------------------------------------- : ImagesExportWindow
 
@@ -31,6 +32,21 @@ ImagesExportWindow::ImagesExportWindow(Window* parent, const SetP& set, const Ex
   conflicts->Append(_BUTTON_("number"));           // 2
   conflicts->Append(_BUTTON_("number overwrite")); // 3
   conflicts->SetSelection(gs.images_export_conflicts);
+  jobs      = new wxSpinCtrl(this, wxID_ANY);
+  jobs->SetRange(0, 256);
+  jobs->SetValue(settings.images_export_jobs);
+  png_compression = new wxSpinCtrl(this, wxID_ANY);
+  png_compression->SetRange(-1, 9);
+  png_compression->SetValue(settings.images_export_png_compression);
+  png_filter = new wxChoice(this, wxID_ANY);
+  png_filter->Append(_BUTTON_("png filter default")); // PNG_FILTERS_DEFAULT
+  png_filter->Append(_BUTTON_("png filter none"));    // PNG_FILTERS_NONE
+  png_filter->Append(_BUTTON_("png filter sub"));     // PNG_FILTERS_SUB
+  png_filter->Append(_BUTTON_("png filter up"));      // PNG_FILTERS_UP
+  png_filter->Append(_BUTTON_("png filter average")); // PNG_FILTERS_AVERAGE
+  png_filter->Append(_BUTTON_("png filter paeth"));   // PNG_FILTERS_PAETH
+  png_filter->Append(_BUTTON_("png filter all"));     // PNG_FILTERS_ALL
+  png_filter->SetSelection(settings.images_export_png_filter);
   // init sizers
   wxSizer* s = new wxBoxSizer(wxVERTICAL);
     wxSizer* s2 = new wxStaticBoxSizer(wxVERTICAL, this, _LABEL_("export filenames"));
@@ -40,6 +56,14 @@ ImagesExportWindow::ImagesExportWindow(Window* parent, const SetP& set, const Ex
       s2->Add(new wxStaticText(this, -1, _LABEL_("filename conflicts")), 0, wxALL, 4);
       s2->Add(conflicts,                                                 0, wxEXPAND | (wxALL & ~wxTOP), 4);
     s->Add(s2, 0, wxEXPAND | wxALL, 8);
+    wxSizer* s4 = new wxStaticBoxSizer(wxVERTICAL, this, _LABEL_("export image files"));
+      s4->Add(new wxStaticText(this, -1, _LABEL_("export jobs")),        0, wxALL, 4);
+      s4->Add(jobs,                                                      0, wxALL & ~wxTOP, 4);
+      s4->Add(new wxStaticText(this, -1, _LABEL_("png compression")),    0, wxALL, 4);
+      s4->Add(png_compression,                                           0, wxALL & ~wxTOP, 4);
+      s4->Add(new wxStaticText(this, -1, _LABEL_("png filter")),         0, wxALL, 4);
+      s4->Add(png_filter,                                                0, wxEXPAND | (wxALL & ~wxTOP), 4);
+    s->Add(s4, 0, wxEXPAND | (wxALL & ~wxTOP), 8);
     wxSizer* s3 = ExportWindowBase::Create();
     s->Add(s3, 1, wxEXPAND | (wxALL & ~wxTOP), 8);
     s->Add(CreateButtonSizer(wxOK | wxCANCEL), 0, wxEXPAND | (wxALL & ~wxTOP), 8);
@@ -59,13 +83,16 @@ void ImagesExportWindow::onOk(wxCommandEvent&) {
   else if (sel == 1) gs.images_export_conflicts = CONFLICT_OVERWRITE;
   else if (sel == 2) gs.images_export_conflicts = CONFLICT_NUMBER;
   else               gs.images_export_conflicts = CONFLICT_NUMBER_OVERWRITE;
+  settings.images_export_jobs = jobs->GetValue();
+  settings.images_export_png_compression = png_compression->GetValue();
+  settings.images_export_png_filter = (PngFilters)max(0, png_filter->GetSelection());
   // Select filename
   String name = wxFileSelector(_TITLE_("export images"), settings.default_export_dir, _LABEL_("filename is ignored"),_(""),
                              _LABEL_("filename is ignored")+_("|*"), wxFD_SAVE, this);
   if (name.empty()) return;
   settings.default_export_dir = wxPathOnly(name);
   // Export
-  export_images(set, getSelection(), name, gs.images_export_filename, gs.images_export_conflicts);
+  export_images(set, getSelection(), name, gs.images_export_filename, gs.images_export_conflicts, settings.images_export_jobs);
   // Done
   EndModal(wxID_OK);
 }
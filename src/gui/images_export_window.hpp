@@ -12,6 +12,8 @@
 #include <gui/card_select_window.hpp>
 #include <data/settings.hpp>
 
+class wxSpinCtrl;
+
 // ----------------------------------------------------------------------------- : ImagesExportWindow
 
 /// A window for selecting a subset of the cards from a set to export to images
@@ -26,5 +28,8 @@ private:
   
   wxTextCtrl* format;
   wxChoice*   conflicts;
+  wxSpinCtrl* jobs;
+  wxSpinCtrl* png_compression;
+  wxChoice*   png_filter;
 };
 
@@ -156,11 +156,12 @@ private:
 /// Retrieve the icon for a package
 class PackageIconRequest : public ThumbnailRequest {
 public:
-  PackageIconRequest(PackageUpdateList* list, PackageUpdateList::TreeItem* ti)
+  PackageIconRequest(PackageUpdateList* list, PackageUpdateList::TreeItem* ti, int priority)
     : ThumbnailRequest(
       list,
       _("package_") + ti->package->description->icon_url + _("_") + ti->package->description->version.toString(),
-      wxDateTime(1,wxDateTime::Jan,2000))
+      wxDateTime(1,wxDateTime::Jan,2000),
+      priority)
     , list(list), ti(ti)
   {}
   
@@ -211,6 +212,7 @@ void PackageUpdateList::initItems() {
   items.clear();
   root.toItems(items);
   // init image list
+  int priority = 0;
   FOR_EACH(i,items) {
     TreeItem& ti = static_cast<TreeItem&>(*i);
     const InstallablePackageP& p = ti.package;
@@ -221,8 +223,8 @@ void PackageUpdateList::initItems() {
     } else if (p) {                       // it doesn't have an icon (yet)
       ti.setIcon(load_resource_image(_("installer_package")));
       if (!p->description->icon_url.empty()) {
-        // download icon
-        thumbnail_thread.request(make_intrusive<PackageIconRequest>(this,&ti));
+        // download icon, items at the top of the list first
+        thumbnail_thread.request(make_intrusive<PackageIconRequest>(this,&ti,--priority));
       }
     } else if (ti.position_type == TreeItem::TYPE_LOCALE) { // locale folder
       ti.setIcon(load_resource_image(_("installer_locales")));
@@ -12,6 +12,7 @@
 #include <gui/control/card_editor.hpp>
 #include <gui/control/text_ctrl.hpp>
 #include <gui/control/filter_ctrl.hpp>
+#include <gui/control/card_prefetcher.hpp>
 #include <gui/about_window.hpp> // for HoverButton
 #include <gui/update_checker.hpp>
 #include <gui/util.hpp>
@@ -19,12 +20,14 @@
 #include <data/game.hpp>
 #include <data/card.hpp>
 #include <data/add_cards_script.hpp>
+#include <data/search_index.hpp>
 #include <data/action/set.hpp>
 #include <data/settings.hpp>
 #include <util/find_replace.hpp>
 #include <util/tagged_string.hpp>
 #include <util/window_id.hpp>
 #include <wx/splitter.h>
+#include <wx/stopwatch.h>
 
 // ----------------------------------------------------------------------------- : CardsPanel
 
@@ -40,6 +43,9 @@ CardsPanel::CardsPanel(Window* parent, int id)
   collapse_notes = new HoverButton(nodes_panel, ID_COLLAPSE_NOTES, _("btn_collapse"), Color(), false);
   collapse_notes->SetExtraStyle(wxWS_EX_PROCESS_UI_UPDATES);
   filter    = nullptr;
+  prefetcher = make_unique<CardPrefetcher>();
+  switch_pending    = false;
+  switch_prefetched = false;
   editor->next_in_tab_order = card_list;
   // init sizer for notes panel
   wxSizer* sn = new wxBoxSizer(wxVERTICAL);
@@ -129,6 +135,11 @@ bool CardsPanel::Layout() {
     menuFormat->Append(ID_INSERT_SYMBOL,  _(""),         _MENU_("insert symbol"));
 }*/// TODO
 CardsPanel::~CardsPanel() {
+  const CardPrefetcher::Stats& stats = prefetcher->stats();
+  if (stats.switches) {
+    wxLogDebug(_("Card switches: %d, %d drawn in advance; %d cards drawn in advance, %d wasted; latency %.1f ms average, %.1f ms max"),
+               (int)stats.switches, (int)stats.hits, (int)stats.prefetched, (int)stats.wasted, stats.averageLatency(), stats.max_latency);
+  }
 //  settings.card_notes_height = splitter->GetSashPosition();
   // we don't own the submenu
   wxMenu* menu = insertSymbolMenu->GetSubMenu();
@@ -145,6 +156,7 @@ void CardsPanel::onChangeSet() {
   editor->setSet(set);
   notes->setSet(set);
   card_list->setSet(set);
+  prefetcher->setSet(set);
   
   // change insertManyCardsMenu
   delete insertManyCardsMenu->GetSubMenu();
@@ -344,7 +356,11 @@ void CardsPanel::onCommand(int id) {
     }
     case ID_CARD_FILTER: {
       // card filter has changed, update the card list
-      card_list->setFilter(filter->getFilter<Card>());
+      if (filter->hasFilter()) {
+        card_list->setFilter(make_intrusive<CardQuickFilter>(set, filter->getFilterString()));
+      } else {
+        card_list->setFilter(CardListFilterP());
+      }
       break;
     }
     default: {
@@ -479,10 +495,33 @@ CardP CardsPanel::selectedCard() const {
 void CardsPanel::selectCard(const CardP& card) {
   if (!set) return; // we want onChangeSet first
   card_list->setCard(card);
+  bool changed = card && card != editor->getCard();
+  if (changed && IsShownOnScreen()) {
+    switch_timer.Start();
+    switch_pending = true;
+  }
   editor->setCard(card);
   notes->setValue(card ? &card->notes : nullptr);
   Layout();
   updateNotesPosition();
+  // show the card if it was drawn in advance
+  if (changed) {
+    switch_prefetched = editor->showImage(prefetcher->takeImage(card));
+  }
+}
+
+void CardsPanel::onEditorPainted(wxCommandEvent&) {
+  if (!switch_pending) return;
+  switch_pending = false;
+  prefetcher->recordSwitch(switch_prefetched, switch_timer.TimeInMicro().ToDouble() / 1000);
+}
+
+void CardsPanel::onIdle(wxIdleEvent& ev) {
+  // only when the selected card is drawn, drawing another card changes the styles
+  if (!set || !IsShownOnScreen() || !editor->isUpToDate()) return;
+  if (prefetcher->prefetch(*card_list, editor->getCard())) {
+    ev.RequestMore();
+  }
 }
 
 void CardsPanel::selectFirstCard() {
@@ -492,4 +531,11 @@ void CardsPanel::selectFirstCard() {
 
 void CardsPanel::getCardLists(vector<CardListBase*>& out) {
   out.push_back(card_list);
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------- : Event table
+
+BEGIN_EVENT_TABLE(CardsPanel, wxPanel)
+  EVT_IDLE(CardsPanel::onIdle)
+  EVT_CARD_PAINTED(ID_EDITOR, CardsPanel::onEditorPainted)
+END_EVENT_TABLE  ()
@@ -10,6 +10,7 @@
 
 #include <util/prec.hpp>
 #include <gui/set/panel.hpp>
+#include <wx/stopwatch.h>
 
 class wxSplitterWindow;
 class FilteredImageCardList;
@@ -18,6 +19,7 @@ class TextCtrl;
 class HoverButton;
 class FindInfo;
 class FilterCtrl;
+class CardPrefetcher;
 
 // ----------------------------------------------------------------------------- : CardsPanel
 
@@ -78,6 +80,8 @@ public:
   void getCardLists(vector<CardListBase*>& out) override;
 
 private:
+  DECLARE_EVENT_TABLE();
+  
   // --------------------------------------------------- : Controls
   wxSizer*          s_left;
   wxSplitterWindow* splitter;
@@ -89,6 +93,15 @@ private:
   FilterCtrl*       filter;
   String            filter_value; // value of filter, need separate variable because the control is destroyed
   bool              notes_below_editor;
+  unique_ptr<CardPrefetcher> prefetcher; ///< Draws the cards around the selected card in advance
+  wxStopWatch       switch_timer;      ///< Time since the selected card was changed
+  bool              switch_pending;    ///< Is the editor yet to be painted after a card switch?
+  bool              switch_prefetched; ///< Was the card of that switch drawn in advance?
+  
+  /// Draw the next card in advance
+  void onIdle(wxIdleEvent&);
+  /// Record how long a card switch took, when the editor has been painted
+  void onEditorPainted(wxCommandEvent&);
   
   /// Move the notes panel below the editor or below the card list
   void updateNotesPosition();
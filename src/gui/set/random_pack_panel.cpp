@@ -37,6 +37,7 @@ public:
   
 protected:
   void getItems(vector<VoidP>& out) const override;
+  bool listsAllCards() const override { return false; }
   void onChangeSet() override;
 };
 
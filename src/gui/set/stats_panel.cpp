@@ -14,6 +14,7 @@
 #include <gui/util.hpp>
 #include <data/game.hpp>
 #include <data/statistics.hpp>
+#include <data/statistics_cache.hpp>
 #include <data/action/value.hpp>
 #include <util/window_id.hpp>
 #include <util/alignment.hpp>
@@ -272,7 +273,7 @@ void StatDimensionList::drawItem(DC& dc, int x, int y, size_t item) {
 StatsPanel::StatsPanel(Window* parent, int id)
   : SetWindowPanel(parent, id)
   , menuGraph(nullptr)
-  , up_to_date(true), active(false)
+  , up_to_date(true), active(false), shown_version(0)
 {
   // delayed initialization by initControls()
 }
@@ -344,7 +345,8 @@ void StatsPanel::onAction(const Action& action, bool undone) {
   if (!isInitialized()) return;
   TYPE_CASE_(action, ScriptValueEvent) {
     // ignore style only stuff
-  } else {
+  } else if (set->statsValues().version() != shown_version) {
+    // only update if some of the values have changed
     onChange();
   }
 }
@@ -474,31 +476,30 @@ void StatsPanel::showCategory(const GraphType* prefer_layout) {
       )
     );
   }
-  // find values for each card
+  // find values for each card, these are cached
+  StatsValueCache& cache = set->statsValues();
+  vector<vector<const StatsValueCache::Value*>> columns(dims.size());
+  for (size_t j = 0 ; j < dims.size() ; ++j) {
+    cache.getColumn(*dims[j], columns[j]);
+  }
   for (size_t i = 0 ; i < set->cards.size() ; ++i) {
-    Context& ctx = set->getContext(set->cards[i]);
     GraphElementP e = make_intrusive<GraphElement>(i);
     bool show = true;
-    FOR_EACH(dim, dims) {
-      try {
-        String value = untag(dim->script.invoke(ctx)->toString());
-        e->values.push_back(value);
-        if (value.empty() && !dim->show_empty) {
-          // don't show this element
-          show = false;
-          break;
-        }
-      } catch (ScriptError const& e) {
-        handle_error(ScriptError(e.what() + _("\n  in script for statistics dimension '") + dim->name + _("'")));
+    for (size_t j = 0 ; j < dims.size() ; ++j) {
+      const StatsValueCache::Value& value = *columns[j][i];
+      if (value.error || (value.value.empty() && !dims[j]->show_empty)) {
+        // don't show this element
         show = false;
         break;
       }
+      e->values.push_back(value.value);
     }
     if (show) {
       assert(e->values.size() == dims.size());
       d.elements.push_back(e);
     }
   }
+  shown_version = cache.version();
   // split lists
   size_t dim_id = 0;
   FOR_EACH(dim, dims) {
@@ -62,6 +62,7 @@ private:
   CardP card;      ///< Selected card
   bool up_to_date; ///< Are the graph and card list up to date?
   bool active;     ///< Is this panel selected?
+  UInt shown_version; ///< Version of the cached statistics values that is shown
   
   void initControls();
   
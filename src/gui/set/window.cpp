@@ -45,6 +45,7 @@ SetWindow::SetWindow(Window* parent, const SetP& set)
   : wxFrame(parent, wxID_ANY, _TITLE_("magic set editor"), wxDefaultPosition, wxDefaultSize, wxDEFAULT_FRAME_STYLE | wxNO_FULL_REPAINT_ON_RESIZE)
   , current_panel(nullptr)
   , find_data(wxFR_DOWN)
+  , typing_timer(this)
   , number_of_recent_sets(0)
 {
   SetIcon(load_resource_icon(_("app")));
@@ -467,6 +468,7 @@ bool SetWindow::askSaveAndContinue() {
           return false;
         }
       } else {
+        set->updateDelayedTyping(0);
         set->save();
         set->actions.setSavePoint();
         return true;
@@ -588,6 +590,7 @@ void SetWindow::onFileSave(wxCommandEvent& ev) {
   } else {
     wxBusyCursor busy;
     settings.addRecentFile(set->absoluteFilename());
+    set->updateDelayedTyping(0);
     set->save();
     set->actions.setSavePoint();
   }
@@ -657,7 +660,7 @@ void SetWindow::onFileExportImage(wxCommandEvent&) {
   CardP card = current_panel->selectedCard();
   if (!card)  return; // no card selected
   String name = wxFileSelector(_TITLE_("save image"), settings.default_export_dir, clean_filename(card->identification()), _(""),
-                             _("PNG images (*.png)|*.png|JPEG images (*.jpg)|*.jpg|Windows bitmaps (*.bmp)|*.bmp|TIFF images (*.tif)|*.tif"),
+                             _("PNG images (*.png)|*.png|JPEG images (*.jpg)|*.jpg|Windows bitmaps (*.bmp)|*.bmp|TIFF images (*.tif)|*.tif|QOI images (*.qoi)|*.qoi"),
                              wxFD_SAVE | wxFD_OVERWRITE_PROMPT, this);
   if (!name.empty()) {
     settings.default_export_dir = wxPathOnly(name);
@@ -850,6 +853,19 @@ void SetWindow::onMenuOpen(wxMenuEvent& ev) {
 void SetWindow::onIdle(wxIdleEvent& ev) {
   // Stuff that must be done in the main thread
   show_update_dialog(this);
+  updateDelayedTyping();
+}
+
+void SetWindow::onTypingTimer(wxTimerEvent&) {
+  updateDelayedTyping();
+}
+
+void SetWindow::updateDelayedTyping() {
+  if (!set) return;
+  long wait = set->updateDelayedTyping(settings.typing_script_delay);
+  if (wait > 0 && !typing_timer.IsRunning()) {
+    typing_timer.StartOnce(wait);
+  }
 }
 
 // ----------------------------------------------------------------------------- : Event table
@@ -907,6 +923,7 @@ BEGIN_EVENT_TABLE(SetWindow, wxFrame)
   EVT_FIND_REPLACE_ALL(wxID_ANY,        SetWindow::onReplaceAll)
   EVT_CLOSE      (            SetWindow::onClose)
   EVT_IDLE      (            SetWindow::onIdle)
+  EVT_TIMER     (wxID_ANY,   SetWindow::onTypingTimer)
   EVT_CARD_SELECT    (wxID_ANY,        SetWindow::onCardSelect)
   EVT_CARD_ACTIVATE  (wxID_ANY,        SetWindow::onCardActivate)
   EVT_SIZE_CHANGE    (wxID_ANY,        SetWindow::onSizeChange)
@@ -54,6 +54,9 @@ private:
   unique_ptr<wxDialog> find_dialog;
   wxFindReplaceData find_data;
   
+  /// Timer for updating scripts after the user stops typing
+  wxTimer typing_timer;
+  
   // --------------------------------------------------- : Panel managment
   
   /// Add a panel to the window, as well as to the menu and tab bar
@@ -174,6 +177,9 @@ private:
   void onMenuOpen            (wxMenuEvent&);
   
   void onIdle                (wxIdleEvent&);
+  void onTypingTimer         (wxTimerEvent&);
+  /// Update scripts that depend on typed text, if the user has stopped typing
+  void updateDelayedTyping();
   
   void onSizeChange          (wxCommandEvent&);
 };
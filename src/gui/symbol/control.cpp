@@ -16,6 +16,7 @@
 #include <gui/symbol/symmetry_editor.hpp>
 #include <gui/util.hpp>
 #include <data/action/symbol.hpp>
+#include <render/symbol/filter.hpp>
 #include <data/settings.hpp>
 #include <util/window_id.hpp>
 #include <wx/dcbuffer.h>
@@ -88,6 +89,8 @@ void SymbolControl::onExtraTool(wxCommandEvent& ev) {
 }
 
 void SymbolControl::onAction(const Action& action, bool undone) {
+  // rendered images of the old symbol are no longer needed
+  if (symbol) symbol_render_cache.forget(*symbol);
   TYPE_CASE_(action, SymbolPartAction) {
     Refresh(false);
   }
@@ -0,0 +1,623 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <gui/thumbnail_cache.hpp>
+#include <gfx/gfx.hpp>
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include <wx/mstream.h>
+#if defined(__WXMSW__)
+  #include <wx/msw/wrapwin.h>
+  #include <io.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------- : Image Cache
+
+String user_settings_dir();
+String image_cache_dir() {
+  String dir = user_settings_dir() + _("/cache");
+  if (!wxDirExists(dir)) wxMkdir(dir);
+  return dir + _("/");
+}
+
+/// A name that is safe to use as a filename, for the cache
+String safe_filename(const String& str) {
+  String ret; ret.reserve(str.size());
+  FOR_EACH_CONST(c, str) {
+    if (isAlnum(c)) {
+      ret += c;
+    } else if (c==_(' ') || c==_('-')) {
+      ret += _('-');
+    } else {
+      ret += _('_');
+    }
+  }
+  return ret;
+}
+
+// ----------------------------------------------------------------------------- : MappedFile
+
+MappedFile::MappedFile()
+  : data_(nullptr), size_(0)
+  #if defined(__WXMSW__)
+    , file(nullptr), mapping(nullptr)
+  #else
+    , fd(-1)
+  #endif
+{}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool MappedFile::open(const String& filename) {
+  close();
+  #if defined(__WXMSW__)
+    HANDLE f = CreateFileW(filename.wc_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+      CloseHandle(f);
+      return false;
+    }
+    HANDLE m = CreateFileMappingW(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) {
+      CloseHandle(f);
+      return false;
+    }
+    void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!p) {
+      CloseHandle(m);
+      CloseHandle(f);
+      return false;
+    }
+    file    = f;
+    mapping = m;
+    size_   = (size_t)size.QuadPart;
+  #else
+    int f = ::open(filename.fn_str(), O_RDONLY);
+    if (f < 0) return false;
+    struct stat st;
+    if (fstat(f, &st) != 0 || st.st_size == 0) {
+      ::close(f);
+      return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, f, 0);
+    if (p == MAP_FAILED) {
+      ::close(f);
+      return false;
+    }
+    fd    = f;
+    size_ = (size_t)st.st_size;
+  #endif
+  data_ = (const Byte*)p;
+  return true;
+}
+
+void MappedFile::close() {
+  if (!data_) return;
+  #if defined(__WXMSW__)
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    file = mapping = nullptr;
+  #else
+    munmap((void*)data_, size_);
+    ::close(fd);
+    fd = -1;
+  #endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+// ----------------------------------------------------------------------------- : Cache file format
+
+// The file starts with a magic string, followed by records. Each record is
+//    key size (4 bytes), data size (4 bytes), modification time (8 bytes), format (1 byte), key (utf8), data
+// Numbers are stored big endian.
+
+const Byte THUMBNAIL_CACHE_MAGIC[] = {'M','S','E','t','h','m','b','1'};
+const size_t THUMBNAIL_RECORD_HEADER_SIZE = 17;
+const UInt THUMBNAIL_MAX_KEY_SIZE = 65536; // larger keys mean the file is damaged
+
+/// How images are stored in the cache file
+enum ThumbnailFormat {
+  THUMBNAIL_QOI = 0,
+  THUMBNAIL_PNG = 1, // files from the old cache directory, copied without decoding
+};
+
+const size_t DEFAULT_THUMBNAIL_CACHE_BYTES = 64 * 1024 * 1024;
+
+static inline void write_32(Byte* out, UInt x) {
+  out[0] = (Byte)(x >> 24);
+  out[1] = (Byte)(x >> 16);
+  out[2] = (Byte)(x >>  8);
+  out[3] = (Byte)(x);
+}
+static inline UInt read_32(const Byte* in) {
+  return (UInt(in[0]) << 24) | (UInt(in[1]) << 16) | (UInt(in[2]) << 8) | UInt(in[3]);
+}
+
+/// Write a record to a file, returns the position of the data relative to the start of the record, or 0 on failure
+/** The record is written with a single call, so records appended by other instances of the program
+ *  end up before or after it, not in the middle.
+ */
+static size_t write_record(wxFile& file, const String& name, wxLongLong modified, Byte format, const Byte* data, UInt size) {
+  wxScopedCharBuffer key = name.utf8_str();
+  size_t header_size = THUMBNAIL_RECORD_HEADER_SIZE + key.length();
+  vector<Byte> record(header_size + size);
+  write_32(&record[0], (UInt)key.length());
+  write_32(&record[4], size);
+  write_32(&record[8],  (UInt)modified.GetHi());
+  write_32(&record[12], (UInt)modified.GetLo());
+  record[16] = format;
+  memcpy(&record[THUMBNAIL_RECORD_HEADER_SIZE], key.data(), key.length());
+  if (size > 0) memcpy(&record[header_size], data, size);
+  if (file.Write(&record[0], record.size()) != record.size()) return 0;
+  return header_size;
+}
+
+// ----------------------------------------------------------------------------- : Lock file
+
+/// A lock file next to the cache file, held while the cache file is rewritten
+/** The file is created exclusively, so only one instance of the program can hold it.
+ *  A lock file that is older than ten minutes was left behind by an instance that crashed.
+ */
+class CacheFileLock {
+public:
+  CacheFileLock(const String& cache_filename)
+    : filename(cache_filename + _(".lock"))
+  {
+    wxLogNull no_errors; // failing is expected when another instance holds the lock
+    is_locked = create();
+    wxDateTime modified;
+    if (!is_locked && wxFileName(filename).GetTimes(nullptr, &modified, nullptr)
+                   && wxDateTime::Now() - modified > wxTimeSpan::Minutes(10)) {
+      wxRemoveFile(filename);
+      is_locked = create();
+    }
+  }
+  ~CacheFileLock() {
+    if (is_locked) wxRemoveFile(filename);
+  }
+  inline bool locked() const { return is_locked; }
+
+private:
+  String filename;
+  bool   is_locked;
+
+  bool create() {
+    wxFile f;
+    return f.Create(filename, false);
+  }
+};
+
+// ----------------------------------------------------------------------------- : ThumbnailCacheMaintenance
+
+/// Thread that migrates and compacts the cache file, so that the program doesn't have to wait for that
+class ThumbnailCacheMaintenance : public wxThread {
+public:
+  ThumbnailCacheMaintenance(ThumbnailCache& cache) : wxThread(wxTHREAD_JOINABLE), cache(cache) {}
+
+  ExitCode Entry() override {
+    cache.maintain();
+    return 0;
+  }
+
+private:
+  ThumbnailCache& cache;
+};
+
+// ----------------------------------------------------------------------------- : ThumbnailCache
+
+ThumbnailCache thumbnail_cache;
+
+ThumbnailCache::ThumbnailCache()
+  : opened(false)
+  , generation(0)
+  , file_bytes(0)
+  , live_bytes(0)
+  , max_bytes(DEFAULT_THUMBNAIL_CACHE_BYTES)
+  , counters()
+  , needs_migration(false)
+  , needs_compaction(false)
+  , maintenance(nullptr)
+  , maintenance_running(false)
+  , stop_maintenance(false)
+{}
+
+ThumbnailCache::~ThumbnailCache() {
+  close();
+}
+
+void ThumbnailCache::close() {
+  // stop the maintenance thread first, it needs the lock to finish
+  wxThread* thread;
+  {
+    wxMutexLocker l(lock);
+    stop_maintenance = true;
+    thread = maintenance;
+    maintenance = nullptr;
+  }
+  if (thread) {
+    thread->Wait();
+    delete thread;
+  }
+  wxMutexLocker l(lock);
+  stop_maintenance = false;
+  maintenance_running = false;
+  reset();
+}
+
+void ThumbnailCache::reset() {
+  mapped.close();
+  if (out.IsOpened()) out.Close();
+  index.clear();
+  lru.clear();
+  file_bytes = live_bytes = 0;
+  opened = false;
+  generation += 1;
+}
+
+bool ThumbnailCache::open() {
+  if (opened) return true;
+  filename = image_cache_dir() + _("thumbnails.cache");
+  bool exists = wxFileExists(filename);
+  if (!exists) {
+    wxFile f(filename, wxFile::write);
+    if (!f.IsOpened() || f.Write(THUMBNAIL_CACHE_MAGIC, sizeof(THUMBNAIL_CACHE_MAGIC)) != sizeof(THUMBNAIL_CACHE_MAGIC)) {
+      return false;
+    }
+  }
+  if (!out.Open(filename, wxFile::write_append)) return false;
+  opened = true;
+  file_bytes = (size_t)out.Length();
+  if (!exists) {
+    needs_migration = true;
+  } else if (!mapped.open(filename) || !readIndex()) {
+    // the file is damaged (for instance because the program was killed while writing),
+    // keep the records that could be read
+    needs_compaction = true;
+  }
+  if (file_bytes > max_bytes) {
+    needs_compaction = true;
+  }
+  startMaintenance();
+  return opened;
+}
+
+bool ThumbnailCache::readIndex() {
+  const Byte* data = mapped.data();
+  size_t size = mapped.size();
+  if (size < sizeof(THUMBNAIL_CACHE_MAGIC) || memcmp(data, THUMBNAIL_CACHE_MAGIC, sizeof(THUMBNAIL_CACHE_MAGIC)) != 0) {
+    return false;
+  }
+  size_t pos = sizeof(THUMBNAIL_CACHE_MAGIC);
+  while (pos < size) {
+    if (size - pos < THUMBNAIL_RECORD_HEADER_SIZE) return false;
+    const Byte* rec = data + pos;
+    UInt key_size = read_32(rec);
+    UInt data_size = read_32(rec + 4);
+    if (key_size > THUMBNAIL_MAX_KEY_SIZE) return false;
+    size_t record_size = THUMBNAIL_RECORD_HEADER_SIZE + key_size + (size_t)data_size;
+    if (size - pos < record_size) return false;
+    Entry e;
+    e.offset      = pos + THUMBNAIL_RECORD_HEADER_SIZE + key_size;
+    e.size        = data_size;
+    e.record_size = (UInt)record_size;
+    e.format      = rec[16];
+    e.modified    = wxLongLong((long)read_32(rec + 8), (unsigned long)read_32(rec + 12));
+    // records later in the file are more recent, addEntry puts them at the front
+    addEntry(String::FromUTF8((const char*)rec + THUMBNAIL_RECORD_HEADER_SIZE, key_size), e);
+    pos += record_size;
+  }
+  return true;
+}
+
+void ThumbnailCache::addEntry(const String& name, const Entry& entry) {
+  auto it = index.find(name);
+  if (it != index.end()) {
+    // replaces an older record, that one is now dead space in the file
+    live_bytes -= it->second.record_size;
+    lru.erase(it->second.lru_pos);
+    it->second = entry;
+  } else {
+    it = index.insert(make_pair(name, entry)).first;
+  }
+  lru.push_front(name);
+  it->second.lru_pos = lru.begin();
+  live_bytes += entry.record_size;
+}
+
+bool ThumbnailCache::append(const String& name, wxLongLong modified, Byte format, const Byte* data, UInt size) {
+  size_t header_size = write_record(out, name, modified, format, data, size);
+  // other instances of the program may have appended records as well, so the position of our record
+  // is only known after writing it: it ends where the file position is now
+  wxFileOffset end = header_size ? out.Tell() : wxInvalidOffset;
+  if (end == wxInvalidOffset) {
+    // a partial record may have been written, the next time the file is opened it is dropped
+    reset();
+    return false;
+  }
+  Entry e;
+  e.offset      = (size_t)end - size;
+  e.size        = size;
+  e.record_size = (UInt)(header_size + size);
+  e.format      = format;
+  e.modified    = modified;
+  addEntry(name, e);
+  file_bytes = max(file_bytes, (size_t)end);
+  return true;
+}
+
+bool ThumbnailCache::recordMatches(const String& name, const Entry& e) const {
+  wxScopedCharBuffer key = name.utf8_str();
+  size_t header_size = e.record_size - e.size;
+  if (header_size != THUMBNAIL_RECORD_HEADER_SIZE + key.length() || e.offset < header_size) return false;
+  const Byte* header = mapped.data() + e.offset - header_size;
+  return read_32(header) == key.length() && read_32(header + 4) == e.size && header[16] == e.format
+      && memcmp(header + THUMBNAIL_RECORD_HEADER_SIZE, key.data(), key.length()) == 0;
+}
+
+bool ThumbnailCache::fileReplaced() const {
+  #if defined(__WXMSW__)
+    HANDLE f = CreateFileW(filename.wc_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return true;
+    BY_HANDLE_FILE_INFORMATION a, b;
+    bool same = GetFileInformationByHandle(f, &a) && GetFileInformationByHandle((HANDLE)_get_osfhandle(out.fd()), &b)
+             && a.dwVolumeSerialNumber == b.dwVolumeSerialNumber
+             && a.nFileIndexHigh == b.nFileIndexHigh && a.nFileIndexLow == b.nFileIndexLow;
+    CloseHandle(f);
+    return !same;
+  #else
+    struct stat a, b;
+    if (stat(filename.fn_str(), &a) != 0 || fstat(out.fd(), &b) != 0) return true;
+    return a.st_ino != b.st_ino || a.st_dev != b.st_dev;
+  #endif
+}
+
+bool ThumbnailCache::mapRange(size_t offset, size_t size) {
+  if (offset + size <= mapped.size()) return true;
+  // records were appended after the file was mapped
+  return mapped.open(filename) && offset + size <= mapped.size();
+}
+
+void ThumbnailCache::startMaintenance() {
+  if (!needs_migration && !needs_compaction) return;
+  if (maintenance) {
+    if (maintenance_running || stop_maintenance) return;
+    // the previous thread is done, or about to return
+    maintenance->Wait();
+    delete maintenance;
+    maintenance = nullptr;
+  }
+  maintenance = new ThumbnailCacheMaintenance(*this);
+  maintenance_running = true;
+  if (maintenance->Run() != wxTHREAD_NO_ERROR) {
+    delete maintenance;
+    maintenance = nullptr;
+    maintenance_running = false;
+  }
+}
+
+void ThumbnailCache::maintain() {
+  String cache_filename;
+  bool migration;
+  {
+    wxMutexLocker l(lock);
+    cache_filename = filename;
+    migration = needs_migration;
+  }
+  {
+    // if another instance is rewriting the file, try again later
+    CacheFileLock file_lock(cache_filename);
+    if (file_lock.locked()) {
+      if (migration) migrate();
+      compact();
+    }
+  }
+  wxMutexLocker l(lock);
+  maintenance_running = false;
+}
+
+void ThumbnailCache::migrate() {
+  wxArrayString files;
+  wxDir::GetAllFiles(image_cache_dir(), &files, _("*.png"), wxDIR_FILES);
+  FOR_EACH(f, files) {
+    wxFileName fn(f);
+    wxDateTime modified;
+    if (!fn.GetTimes(0, &modified, 0)) continue;
+    vector<Byte> data;
+    {
+      wxFile in(f);
+      if (!in.IsOpened()) continue;
+      data.resize((size_t)in.Length());
+      if (data.empty() || in.Read(&data[0], data.size()) != (ssize_t)data.size()) continue;
+    }
+    // the old file name is safe_filename(name), which is also the key used in the cache file
+    wxMutexLocker l(lock);
+    if (stop_maintenance || !opened) return;
+    if (!append(fn.GetName(), modified.GetValue(), THUMBNAIL_PNG, &data[0], (UInt)data.size())) return;
+    wxRemoveFile(f);
+    counters.migrated += 1;
+  }
+  wxMutexLocker l(lock);
+  needs_migration = false;
+  if (file_bytes > max_bytes) needs_compaction = true;
+}
+
+void ThumbnailCache::compact() {
+  // which entries to keep?
+  vector<pair<String,Entry>> keep; // most recently used first
+  String cache_filename;
+  UInt   old_generation;
+  size_t old_bytes;
+  {
+    wxMutexLocker l(lock);
+    if (!needs_compaction || !opened || stop_maintenance) return;
+    size_t target_bytes = max_bytes * 3 / 4;
+    size_t bytes = sizeof(THUMBNAIL_CACHE_MAGIC);
+    FOR_EACH(name, lru) {
+      auto it = index.find(name);
+      if (bytes + it->second.record_size > target_bytes) break;
+      keep.push_back(*it);
+      bytes += it->second.record_size;
+    }
+    cache_filename = filename;
+    old_generation = generation;
+    old_bytes      = file_bytes;
+  }
+  // write them to a new file, least recently used first.
+  // Records are never changed once written, so they can be read from a mapping of our own, without the lock.
+  String temp_name = cache_filename + _(".new");
+  map<String,Entry> new_index;
+  size_t new_bytes = sizeof(THUMBNAIL_CACHE_MAGIC);
+  MappedFile source;
+  wxFile temp(temp_name, wxFile::write);
+  bool ok = source.open(cache_filename) && temp.IsOpened()
+         && temp.Write(THUMBNAIL_CACHE_MAGIC, sizeof(THUMBNAIL_CACHE_MAGIC)) == sizeof(THUMBNAIL_CACHE_MAGIC);
+  for (auto it = keep.rbegin() ; ok && it != keep.rend() ; ++it) {
+    const Entry& e = it->second;
+    if (e.offset + e.size > source.size()) continue;
+    size_t header_size = write_record(temp, it->first, e.modified, e.format, source.data() + e.offset, e.size);
+    ok = header_size != 0;
+    Entry ne = e;
+    ne.offset = new_bytes + header_size;
+    new_index[it->first] = ne;
+    new_bytes += e.record_size;
+  }
+  source.close();
+  // replace the file
+  wxMutexLocker l(lock);
+  if (!ok || stop_maintenance || generation != old_generation) {
+    // can't write the new file, or the cache was closed in the meantime, try again another time
+    temp.Close();
+    wxRemoveFile(temp_name);
+    if (!ok) needs_compaction = false;
+    return;
+  }
+  // thumbnails stored while the new file was written
+  FOR_EACH(entry, index) {
+    const Entry& e = entry.second;
+    if (e.offset < old_bytes || !mapRange(e.offset, e.size)) continue;
+    size_t header_size = write_record(temp, entry.first, e.modified, e.format, mapped.data() + e.offset, e.size);
+    if (header_size == 0) break;
+    Entry ne = e;
+    ne.offset = new_bytes + header_size;
+    new_index[entry.first] = ne;
+    new_bytes += e.record_size;
+  }
+  temp.Close();
+  // keep the order of use
+  list<String> new_lru;
+  FOR_EACH(name, lru) {
+    auto it = new_index.find(name);
+    if (it == new_index.end()) continue;
+    new_lru.push_back(name);
+    it->second.lru_pos = --new_lru.end();
+  }
+  reset();
+  needs_compaction = false;
+  if (!wxRenameFile(temp_name, filename, true)) {
+    wxRemoveFile(temp_name);
+    return;
+  }
+  if (!out.Open(filename, wxFile::write_append)) return;
+  index.swap(new_index);
+  lru.swap(new_lru);
+  file_bytes = new_bytes;
+  // like addEntry
+  FOR_EACH(entry, index) {
+    live_bytes += entry.second.record_size;
+  }
+  opened = true;
+}
+
+bool ThumbnailCache::load(const String& name, const wxDateTime& modified, Image& img) {
+  String key = safe_filename(name);
+  vector<Byte> data;
+  Byte format;
+  {
+    wxMutexLocker l(lock);
+    if (!open()) return false;
+    auto it = index.find(key);
+    if (it == index.end() || it->second.modified < modified.GetValue()) {
+      counters.misses += 1;
+      return false;
+    }
+    Entry& e = it->second;
+    if (e.size == 0 || !mapRange(e.offset, e.size)) {
+      counters.misses += 1;
+      return false;
+    }
+    if (!recordMatches(key, e)) {
+      // another instance of the program has rewritten the file, read the new index next time
+      reset();
+      counters.misses += 1;
+      return false;
+    }
+    // copy the data, so decoding can happen outside the lock
+    data.assign(mapped.data() + e.offset, mapped.data() + e.offset + e.size);
+    format = e.format;
+    lru.splice(lru.begin(), lru, e.lru_pos);
+    counters.hits += 1;
+  }
+  if (format == THUMBNAIL_QOI) {
+    return qoi_decode(&data[0], data.size(), img);
+  } else if (format == THUMBNAIL_PNG) {
+    wxMemoryInputStream stream(&data[0], data.size());
+    return img.LoadFile(stream, wxBITMAP_TYPE_PNG);
+  } else {
+    return false;
+  }
+}
+
+void ThumbnailCache::store(const String& name, const wxDateTime& modified, const Image& img) {
+  if (!img.Ok()) return;
+  vector<Byte> data;
+  qoi_encode(img, data);
+  wxMutexLocker l(lock);
+  if (opened && fileReplaced()) {
+    // another instance of the program has rewritten the file, our handle still refers to the old one
+    reset();
+  }
+  if (!open()) return;
+  if (!append(safe_filename(name), modified.GetValue(), THUMBNAIL_QOI, &data[0], (UInt)data.size())) return;
+  if (file_bytes > max_bytes) {
+    needs_compaction = true;
+    startMaintenance();
+  }
+}
+
+void ThumbnailCache::setMaxBytes(size_t max_bytes) {
+  wxMutexLocker l(lock);
+  this->max_bytes = max_bytes;
+  if (opened && file_bytes > max_bytes) {
+    needs_compaction = true;
+    startMaintenance();
+  }
+}
+
+ThumbnailCache::Stats ThumbnailCache::stats() const {
+  wxMutexLocker l(lock);
+  Stats s = counters;
+  s.entries    = index.size();
+  s.live_bytes = live_bytes;
+  s.file_bytes = file_bytes;
+  s.max_bytes  = max_bytes;
+  return s;
+}
+
@@ -0,0 +1,153 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <wx/datetime.h>
+#include <wx/thread.h>
+#include <wx/file.h>
+#include <list>
+
+/// The directory in which cached images are stored, ends in a slash
+String image_cache_dir();
+
+// ----------------------------------------------------------------------------- : MappedFile
+
+/// A file that is mapped into memory for reading
+class MappedFile {
+public:
+  MappedFile();
+  ~MappedFile();
+
+  /// Map the whole file, returns false on failure
+  bool open(const String& filename);
+  void close();
+
+  inline const Byte* data() const { return data_; }
+  inline size_t      size() const { return size_; }
+
+private:
+  const Byte* data_;
+  size_t      size_;
+  #if defined(__WXMSW__)
+    void* file;    ///< HANDLE of the file
+    void* mapping; ///< HANDLE of the file mapping
+  #else
+    int fd;
+  #endif
+};
+
+// ----------------------------------------------------------------------------- : ThumbnailCache
+
+/// The on-disk cache of generated thumbnails
+/** All thumbnails are stored in a single file, "thumbnails.cache" in the image_cache_dir().
+ *  The file is a sequence of records, each containing a name, a modification time and the image,
+ *  stored in the QOI format. New thumbnails are appended at the end, an index in memory maps
+ *  names to records. Reads go through a memory mapping of the file.
+ *
+ *  When the file grows beyond the maximum size it is rewritten, keeping only the most recently used
+ *  thumbnails. The records are written in order of last use, so that order is kept between sessions.
+ *
+ *  Earlier versions stored each thumbnail in its own PNG file. These files are moved into
+ *  the cache file the first time it is created.
+ *
+ *  Moving the old files and rewriting the file can take a while, so they are done by a separate thread,
+ *  which only holds the lock for short times. A lock file next to the cache file makes sure that only
+ *  one instance of the program rewrites the file at a time. Other instances can still append records,
+ *  each record is written with a single write call. Before appending they check that the file has not been
+ *  replaced by a rewritten one, otherwise they would append to the old file.
+ *
+ *  Thumbnails can be loaded and stored from any thread.
+ */
+class ThumbnailCache {
+public:
+  ThumbnailCache();
+  ~ThumbnailCache();
+
+  /// Load a thumbnail, if it is in the cache and it is not older than modified
+  bool load(const String& name, const wxDateTime& modified, Image& img);
+  /// Store a thumbnail in the cache
+  void store(const String& name, const wxDateTime& modified, const Image& img);
+
+  /// Change the maximum size of the cache file
+  void setMaxBytes(size_t max_bytes);
+  /// Close the cache file, it is opened again when needed
+  void close();
+
+  /// Statistics, for profiling
+  struct Stats {
+    size_t hits, misses;
+    size_t entries;    ///< Number of thumbnails in the cache
+    size_t live_bytes; ///< Bytes in the file used by current thumbnails
+    size_t file_bytes; ///< Size of the file, including replaced thumbnails
+    size_t max_bytes;
+    size_t migrated;   ///< Number of old PNG files that were moved into the cache
+  };
+  Stats stats() const;
+
+private:
+  /// A record in the cache file
+  struct Entry {
+    size_t         offset;      ///< Position of the image data in the file
+    UInt           size;        ///< Size of the image data
+    UInt           record_size; ///< Size of the whole record
+    Byte           format;      ///< How the image is stored, a ThumbnailFormat
+    wxLongLong     modified;    ///< Modification time, in milliseconds
+    list<String>::iterator lru_pos; ///< Position in the lru list
+  };
+
+  mutable wxMutex lock;
+  bool            opened;
+  UInt            generation;   ///< Incremented when the file is closed
+  String          filename;
+  MappedFile      mapped;       ///< Mapping of the file, may be shorter than the file if records were added later
+  wxFile          out;          ///< The file, opened for appending
+  size_t          file_bytes;
+  size_t          live_bytes;   ///< Total record_size of the entries in the index
+  size_t          max_bytes;
+  map<String,Entry> index;      ///< Entries by name
+  list<String>    lru;          ///< Names of the entries in order of use, most recently used first
+  Stats           counters;
+  bool            needs_migration;     ///< Should the PNG files of earlier versions be moved into the file?
+  bool            needs_compaction;    ///< Is the file too large or damaged?
+  wxThread*       maintenance;         ///< Thread that migrates and compacts, if one was started
+  bool            maintenance_running; ///< Is that thread still working?
+  bool            stop_maintenance;    ///< Should that thread stop as soon as possible?
+
+  friend class ThumbnailCacheMaintenance;
+
+  /// Open the cache file, creating it if necessary. Call with lock held
+  bool open();
+  /// Forget the index and close the file. Call with lock held
+  void reset();
+  /// Read the records in the mapped file, returns false if the file is damaged
+  bool readIndex();
+  /// Is the record of an entry still in the mapped file? Call with lock held, after mapRange
+  bool recordMatches(const String& name, const Entry& e) const;
+  /// Start a thread for migrating and compacting, if that is needed. Call with lock held
+  void startMaintenance();
+  /// Migrate and compact, called from the maintenance thread. Call without the lock
+  void maintain();
+  /// Move the PNG files of earlier versions into the cache file. Call without the lock
+  void migrate();
+  /// Append a record to the file. Call with lock held
+  bool append(const String& name, wxLongLong modified, Byte format, const Byte* data, UInt size);
+  /// Add an entry to the index, replacing older entries with the same name
+  void addEntry(const String& name, const Entry& entry);
+  /// Has the file been replaced or removed since we opened it? Call with lock held
+  bool fileReplaced() const;
+  /// Make sure that the mapping includes the given range of the file
+  bool mapRange(size_t offset, size_t size);
+  /// Rewrite the file with only the most recently used entries that fit in 3/4 of the maximum size. Call without the lock
+  void compact();
+};
+
+/// The global thumbnail cache
+extern ThumbnailCache thumbnail_cache;
+
@@ -8,160 +8,154 @@
 
 #include <util/prec.hpp>
 #include <gui/thumbnail_thread.hpp>
+#include <gui/thumbnail_cache.hpp>
 #include <util/platform.hpp>
 #include <util/error.hpp>
 #include <wx/thread.h>
+#include <wx/time.h>
 
-// ----------------------------------------------------------------------------- : Image Cache
+// ----------------------------------------------------------------------------- : ThumbnailRequest
 
-String user_settings_dir();
-String image_cache_dir() {
-  String dir = user_settings_dir() + _("/cache");
-  if (!wxDirExists(dir)) wxMkdir(dir);
-  return dir + _("/");
+bool ThumbnailRequestNameOrder::operator () (const ThumbnailRequestP& a, const ThumbnailRequestP& b) const {
+  if (a->owner < b->owner) return true;
+  if (a->owner > b->owner) return false;
+  return a->cache_name < b->cache_name;
 }
 
-/// A name that is safe to use as a filename, for the cache
-String safe_filename(const String& str) {
-  String ret; ret.reserve(str.size());
-  FOR_EACH_CONST(c, str) {
-    if (isAlnum(c)) {
-      ret += c;
-    } else if (c==_(' ') || c==_('-')) {
-      ret += _('-');
-    } else {
-      ret += _('_');
-    }
-  }
-  return ret;
+bool ThumbnailRequestQueueOrder::operator () (const ThumbnailRequestP& a, const ThumbnailRequestP& b) const {
+  if (a->priority != b->priority) return a->priority > b->priority;
+  return a->sequence > b->sequence;
 }
 
 // ----------------------------------------------------------------------------- : ThumbnailThreadWorker
 
+/// A worker in the pool, handles requests until the queue is empty
 class ThumbnailThreadWorker : public wxThread {
 public:
-  ThumbnailThreadWorker(ThumbnailThread* parent);
+  ThumbnailThreadWorker(ThumbnailThread* parent) : parent(parent) {}
   
   ExitCode Entry() override;
   
-  ThumbnailRequestP current; ///< Request we are working on
-  ThumbnailThread*  parent;
-  bool              stop; ///< Suspend computation
+  ThumbnailThread* parent;
 };
 
-ThumbnailThreadWorker::ThumbnailThreadWorker(ThumbnailThread* parent)
-  : parent(parent)
-  , stop(false)
-{}
-
 wxThread::ExitCode ThumbnailThreadWorker::Entry() {
   while (true) {
-    do {
-      Sleep(1);
-    } while (stop);
     // get a request
+    ThumbnailRequestP current;
     {
       wxMutexLocker lock(parent->mutex);
       if (parent->open_requests.empty()) {
-        parent->worker = nullptr;
+        parent->workers -= 1;
         return 0; // No more requests
       }
-      current = parent->open_requests.front();
-      parent->open_requests.pop_front();
+      current = *parent->open_requests.begin();
+      parent->open_requests.erase(parent->open_requests.begin());
+      parent->running_requests.push_back(current);
+      // queue latency
+      double latency = (wxGetUTCTimeMillis() - current->queued_at).ToDouble();
+      parent->counters.started += 1;
+      parent->counters.total_latency += latency;
+      parent->counters.max_latency = max(parent->counters.max_latency, latency);
     }
     // perform request
-    Image img;
-    try {
-      img = current->generate();
-    } catch (const Error& e) {
-      handle_error(e);
-    } catch (...) {
-    }
-    // store in cache
-    if (img.Ok()) {
-      String filename = image_cache_dir() + safe_filename(current->cache_name) + _(".png");
-      img.SaveFile(filename, wxBITMAP_TYPE_PNG);
-      // set modification time
-      wxFileName fn(filename);
-      fn.SetTimes(0, &current->modified, 0);
-    }
+    Image img = ThumbnailThread::generate(*current);
     // store result in closed request list
     {
       wxMutexLocker lock(parent->mutex);
+      auto& running = parent->running_requests;
+      running.erase(find(running.begin(), running.end(), current));
       parent->closed_requests.push_back(make_pair(current,img));
-      current = ThumbnailRequestP();
-      parent->completed.Signal();
+      parent->completed.Broadcast();
     }
   }
 }
 
-bool operator < (const ThumbnailRequestP& a, const ThumbnailRequestP& b) {
-  if (a->owner < b->owner) return true;
-  if (a->owner > b->owner) return false;
-  return a->cache_name < b->cache_name;
-}
-
 // ----------------------------------------------------------------------------- : ThumbnailThread
 
 ThumbnailThread thumbnail_thread;
 
 ThumbnailThread::ThumbnailThread()
   : completed(mutex)
-  , worker(nullptr)
+  , sequence(0)
+  , workers(0)
+  , max_workers(0)
+  , counters()
 {}
 
+Image ThumbnailThread::generate(ThumbnailRequest& request) {
+  Image img;
+  try {
+    img = request.generate();
+  } catch (const Error& e) {
+    handle_error(e);
+  } catch (...) {
+  }
+  // store in cache
+  thumbnail_cache.store(request.cache_name, request.modified, img);
+  return img;
+}
+
+void ThumbnailThread::startWorkers() {
+  if (max_workers == 0) {
+    // thumbnails are mostly disk (or network) bound, so a few more threads than processors don't hurt
+    max_workers = max(2, min(8, wxThread::GetCPUCount()));
+  }
+  while (workers < max_workers && workers < open_requests.size() + running_requests.size()) {
+    ThumbnailThreadWorker* worker = new ThumbnailThreadWorker(this);
+    if (worker->Run() != wxTHREAD_NO_ERROR) {
+      delete worker;
+      break;
+    }
+    workers += 1;
+  }
+}
+
 void ThumbnailThread::request(const ThumbnailRequestP& request) {
   assert(wxThread::IsMain());
+  {
+    wxMutexLocker lock(mutex);
+    counters.requests += 1;
+  }
   // Is the request in progress?
-  if (request_names.find(request) != request_names.end()) {
+  auto existing = request_names.find(request);
+  if (existing != request_names.end()) {
+    // if it is still waiting, move it to the front of its priority class
+    wxMutexLocker lock(mutex);
+    auto it = open_requests.find(*existing);
+    if (it != open_requests.end()) {
+      ThumbnailRequestP r = *it;
+      open_requests.erase(it);
+      r->priority = max(r->priority, request->priority);
+      r->sequence = ++sequence;
+      open_requests.insert(r);
+    }
     return;
   }
   // Is the image in the cache?
-  String filename = image_cache_dir() + safe_filename(request->cache_name) + _(".png");
-  wxFileName fn(filename);
-  if (fn.FileExists()) {
-    wxDateTime modified;
-    if (fn.GetTimes(0, &modified, 0) && modified >= request->modified) {
-      // yes it is
-      Image img(filename);
-      request->store(img);
-      return;
-    }
+  Image img;
+  if (thumbnail_cache.load(request->cache_name, request->modified, img)) {
+    // yes it is
+    request->store(img);
+    wxMutexLocker lock(mutex);
+    counters.disk_hits += 1;
+    return;
   }
   if (request->threadSafe()) {
     request_names.insert(request);
     // request generation
-    {
-      wxMutexLocker lock(mutex);
-      open_requests.push_back(request);
-    }
-    // is there a worker?
-    if (!worker) {
-      worker = new ThumbnailThreadWorker(this);
-      worker->Create();
-      worker->Run();
-    }
+    wxMutexLocker lock(mutex);
+    request->sequence  = ++sequence;
+    request->queued_at = wxGetUTCTimeMillis();
+    open_requests.insert(request);
+    counters.generated += 1;
+    startWorkers();
   } else {
-    Image img;
-    try {
-      img = request->generate();
-    } catch (const Error& e) {
-      handle_error(e);
-    } catch (...) {
-    }
-    // store in cache
-    if (img.Ok()) {
-      String filename = image_cache_dir() + safe_filename(request->cache_name) + _(".png");
-      img.SaveFile(filename, wxBITMAP_TYPE_PNG);
-      // set modification time
-      wxFileName fn(filename);
-      fn.SetTimes(0, &request->modified, 0);
-    }
-    {
-      wxMutexLocker lock(mutex);
-      closed_requests.push_back(make_pair(request,img));
-      completed.Signal();
-    }
+    Image img = generate(*request);
+    wxMutexLocker lock(mutex);
+    counters.generated += 1;
+    closed_requests.push_back(make_pair(request,img));
+    completed.Broadcast();
   }
 }
 
@@ -193,51 +187,51 @@ bool ThumbnailThread::done(void* owner) {
 
 void ThumbnailThread::abort(void* owner) {
   assert(wxThread::IsMain());
-  mutex.Lock();
-  if (worker && worker->current && worker->current->owner == owner) {
-    // a request for this owner is in progress, wait until it is done
-    worker->stop = true;
-    completed.Wait();
-    mutex.Lock();
-    worker->stop = false;
+  wxMutexLocker lock(mutex);
+  // remove open requests for this owner, request_names is sorted by owner, so we only visit the requests of this owner
+  for (auto it = request_names.lower_bound(owner) ; it != request_names.end() && (*it)->owner == owner ; ) {
+    if (open_requests.erase(*it)) {
+      counters.aborted += 1;
+    }
+    it = request_names.erase(it);
   }
-  // remove open requests for this owner
-  for (size_t i = 0 ; i < open_requests.size() ; ) {
-    if (open_requests[i]->owner == owner) {
-      // remove
-      request_names.erase(open_requests[i]);
-      open_requests.erase(open_requests.begin() + i, open_requests.begin() + i + 1);
-    } else {
-      ++i;
+  // requests for this owner that are in progress use the owner, wait until they are done
+  while (true) {
+    bool busy = false;
+    FOR_EACH(r, running_requests) {
+      if (r->owner == owner) busy = true;
     }
+    if (!busy) break;
+    completed.Wait();
   }
   // remove closed requests for this owner
   for (size_t i = 0 ; i < closed_requests.size() ; ) {
     if (closed_requests[i].first->owner == owner) {
-      // remove
-      request_names.erase(closed_requests[i].first);
       closed_requests.erase(closed_requests.begin() + i, closed_requests.begin() + i + 1);
     } else {
       ++i;
     }
   }
-  mutex.Unlock();
 }
 
 void ThumbnailThread::abortAll() {
   assert(wxThread::IsMain());
-  mutex.Lock();
+  wxMutexLocker lock(mutex);
+  counters.aborted += open_requests.size();
   open_requests.clear();
-  closed_requests.clear();
   request_names.clear();
-  // end worker
-  if (worker && worker->current) {
+  // wait for the workers to finish their current request, after that they find the queue empty and end
+  while (!running_requests.empty()) {
     completed.Wait();
-  } else {
-    mutex.Unlock();
   }
-  // There may still be a worker, but if there is, it has no current object, so it is
-  // in, before or after the stop loop. It can do nothing but end.
-  // An unfortunate side effect is that we might leak some memory (of the worker object),
-  // when the thread gets Kill()ed by wx.
+  closed_requests.clear();
+}
+
+ThumbnailThread::Stats ThumbnailThread::stats() const {
+  wxMutexLocker lock(mutex);
+  Stats s = counters;
+  s.queued      = open_requests.size();
+  s.workers     = workers;
+  s.max_workers = max_workers;
+  return s;
 }
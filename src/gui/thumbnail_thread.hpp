@@ -11,7 +11,7 @@
 #include <util/prec.hpp>
 #include <wx/datetime.h>
 #include <wx/filename.h>
-#include <queue>
+#include <wx/thread.h>
 
 DECLARE_POINTER_TYPE(ThumbnailRequest);
 class ThumbnailThreadWorker;
@@ -21,8 +21,8 @@ class ThumbnailThreadWorker;
 /// A request for some kind of thumbnail
 class ThumbnailRequest : public IntrusivePtrVirtualBase {
 public:
-  ThumbnailRequest(void* owner, const String& cache_name, const wxDateTime& modified)
-    : owner(owner), cache_name(cache_name), modified(modified) {}
+  ThumbnailRequest(void* owner, const String& cache_name, const wxDateTime& modified, int priority = 0)
+    : owner(owner), cache_name(cache_name), modified(modified), priority(priority), sequence(0) {}
   
   virtual ~ThumbnailRequest() {}
   
@@ -40,14 +40,37 @@ public:
   String cache_name;
   /// Modification time for the object of which the thumnail is generated
   wxDateTime modified;
+  /// Requests with a higher priority are generated first, e.g. for items that are currently visible
+  int priority;
+  
+private:
+  friend class ThumbnailThread;
+  friend class ThumbnailThreadWorker;
+  friend struct ThumbnailRequestQueueOrder;
+  UInt       sequence;  ///< Order in which requests were (re)made, among requests with the same priority the newest goes first
+  wxLongLong queued_at; ///< Time at which the request was put in the queue, in milliseconds
+};
+
+/// Order of requests by owner, then by name
+/** Requests can also be compared to just an owner, to find all requests of that owner */
+struct ThumbnailRequestNameOrder {
+  typedef void is_transparent;
+  bool operator () (const ThumbnailRequestP& a, const ThumbnailRequestP& b) const;
+  inline bool operator () (const ThumbnailRequestP& a, void* owner) const { return a->owner < owner; }
+  inline bool operator () (void* owner, const ThumbnailRequestP& b) const { return owner < b->owner; }
+};
+/// Order in which requests are handled: highest priority first, then most recent first
+struct ThumbnailRequestQueueOrder {
+  bool operator () (const ThumbnailRequestP& a, const ThumbnailRequestP& b) const;
 };
 
 // ----------------------------------------------------------------------------- : ThumbnailThread
 
-/// A (generic) class that generates thumbnails in another thread
+/// A (generic) class that generates thumbnails in other threads
 /** All requests have an 'owner', the object that requested the thumbnail.
  *  This object should regularly call "done(this)".
- *  Multiple requests can be open at the same time.
+ *  Multiple requests can be open at the same time, they are handled by a pool of worker threads,
+ *  highest priority first. Requests that are not threadSafe() are generated on the main thread.
  *  Thumbnails are cached, and need not be generated in a thread
  */
 class ThumbnailThread {
@@ -55,6 +78,9 @@ public:
   ThumbnailThread();
   
   /// Request a thumbnail, it may be store()d immediatly if the thumbnail is cached
+  /** If the same thumbnail is already waiting in the queue, it is moved forward instead,
+   *  so items that are requested again (because they are still visible) are handled first.
+   */
   void request(const ThumbnailRequestP& request);
   /// Is one or more thumbnail for the given owner finished?
   /** If so, call their store() functions */
@@ -65,15 +91,40 @@ public:
   /** *must* be called at application exit */
   void abortAll();
   
+  /// Statistics, for profiling
+  struct Stats {
+    size_t requests;      ///< Number of calls to request()
+    size_t disk_hits;     ///< Requests that were satisfied from the image cache
+    size_t generated;     ///< Requests that were not in the image cache, so they had to be generated
+    size_t aborted;       ///< Requests that were removed from the queue before they were started
+    size_t queued;        ///< Requests currently waiting in the queue
+    size_t workers;       ///< Number of running worker threads
+    size_t max_workers;
+    double total_latency; ///< Total time requests spent in the queue before a worker started on them, in milliseconds
+    double max_latency;   ///< Longest time spent in the queue, in milliseconds
+    size_t started;       ///< Number of requests that were started by a worker
+    inline double averageLatency() const { return started ? total_latency / started : 0; }
+  };
+  Stats stats() const;
+  
 private:
-  wxMutex     mutex;  ///< Mutex used by the worker when accessing the request lists or the thread pointer
+  mutable wxMutex mutex; ///< Mutex used by the workers when accessing the request lists or the worker count
   wxCondition completed; ///< Event signaled when a request is completed
   
-  deque<ThumbnailRequestP>                open_requests;    ///< Requests on which work hasn't finished
-  vector<pair<ThumbnailRequestP,Image>>  closed_requests;  ///< Requests for which work is completed
-  set<ThumbnailRequestP>                  request_names;    ///< Requests that haven't been stored yet, to prevent duplicates
+  set<ThumbnailRequestP,ThumbnailRequestQueueOrder> open_requests;   ///< Requests on which work hasn't started
+  vector<ThumbnailRequestP>                         running_requests;///< Requests that a worker is working on
+  vector<pair<ThumbnailRequestP,Image>>             closed_requests; ///< Requests for which work is completed
+  set<ThumbnailRequestP,ThumbnailRequestNameOrder>  request_names;   ///< Requests that haven't been stored yet, to prevent duplicates (main thread only)
+  UInt   sequence;    ///< Counter for ThumbnailRequest::sequence
+  size_t workers;     ///< Number of worker threads. invariant: no open requests ==> workers are about to end
+  size_t max_workers;
+  Stats  counters;    ///< Statistics, protected by the mutex
   friend class ThumbnailThreadWorker;
-  ThumbnailThreadWorker* worker;                ///< The worker thread. invariant: no requests ==> worker==nullptr
+  
+  /// Start workers as long as there are more open requests than workers to handle them, call with mutex locked
+  void startWorkers();
+  /// Generate the image for a request and save it in the image cache, called from any thread
+  static Image generate(ThumbnailRequest& request);
 };
 
 /// The global thumbnail generator thread
@@ -21,7 +21,7 @@ const double min_item_size = thumbnail_size;
 
 class ChoiceThumbnailRequest : public ThumbnailRequest {
 public:
-  ChoiceThumbnailRequest(ValueViewer* cve, int id, bool from_disk, bool thread_safe);
+  ChoiceThumbnailRequest(ValueViewer* cve, int id, bool from_disk, const ScriptableImage& img);
   Image generate() override;
   void store(const Image&) override;
 
@@ -29,28 +29,28 @@ public:
   bool threadSafe() const override {return isThreadSafe;}
 private:
   int id;
+  /// The image to generate, taken from the style on the main thread, the style's choice_images can change while workers run
+  ScriptableImage image;
   
   inline ChoiceStyle& style()  { return *static_cast<ChoiceStyle*>(viewer().getStyle().get()); }
   inline ValueViewer& viewer() { return *static_cast<ValueViewer*>(owner); }
 };
 
-ChoiceThumbnailRequest::ChoiceThumbnailRequest(ValueViewer* viewer, int id, bool from_disk, bool thread_safe)
+ChoiceThumbnailRequest::ChoiceThumbnailRequest(ValueViewer* viewer, int id, bool from_disk, const ScriptableImage& img)
   : ThumbnailRequest(
     static_cast<void*>(viewer),
     viewer->getStylePackage().name() + _("/") + viewer->getField()->name + _("/") << id,
     from_disk ? viewer->getStylePackage().lastModified()
               : wxDateTime::Now()
   )
-  , isThreadSafe(thread_safe)
+  , isThreadSafe(img.threadSafe())
   , id(id)
+  , image(img)
 {}
 
 Image ChoiceThumbnailRequest::generate() {
-  ChoiceStyle& s = style();
-  String name = canonical_name_form(s.field().choices->choiceName(id));
-  ScriptableImage& img = s.choice_images[name];
-  return img.isReady()
-    ? img.generate(GeneratedImage::Options(thumbnail_size, thumbnail_size, &viewer().getStylePackage(), &viewer().getLocalPackage(), ASPECT_BORDER, true))
+  return image.isReady()
+    ? image.generate(GeneratedImage::Options(thumbnail_size, thumbnail_size, &viewer().getStylePackage(), &viewer().getLocalPackage(), ASPECT_BORDER, true))
     : wxImage();
 }
 
@@ -178,7 +178,7 @@ void DropDownChoiceListBase::generateThumbnailImages() {
       } else if (img.isReady()) {
         // request this thumbnail
         thumbnail_thread.request(make_intrusive<ChoiceThumbnailRequest>(
-            &cve, i, thumbnail.status == THUMB_NOT_MADE && !img.local(), img.threadSafe()
+            &cve, i, thumbnail.status == THUMB_NOT_MADE && !img.local(), img
           ));
       }
     }
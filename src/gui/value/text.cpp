@@ -20,6 +20,7 @@
 #include <util/window_id.hpp>
 #include <wx/clipbrd.h>
 #include <wx/caret.h>
+#include <wx/time.h>
 
 #undef small // some evil windows header defines this
 
@@ -308,6 +309,16 @@ void DropDownWordList::redrawArrowOnParent() {
   tve.redrawWordListIndicators(true);
 }
 
+// ----------------------------------------------------------------------------- : Typing latency
+
+TypingLatency typing_latency;
+
+void TypingLatency::add(double ms) {
+  count += 1;
+  total_ms += ms;
+  max_ms = max(max_ms, ms);
+}
+
 // ----------------------------------------------------------------------------- : TextValueEditor
 
 IMPLEMENT_VALUE_EDITOR(Text)
@@ -316,6 +327,7 @@ IMPLEMENT_VALUE_EDITOR(Text)
   , selecting(false), select_words(false)
   , scrollbar(nullptr), scroll_with_cursor(false)
   , hovered_words(nullptr)
+  , edit_time(0)
 {
   if (nativeLook() && field().multi_line) {
     scrollbar = new TextValueEditorScrollBar(*this);
@@ -546,6 +558,10 @@ void TextValueEditor::onLoseFocus() {
   wxCaret* caret = editor().GetCaret();
   assert(caret);
   if (caret->IsVisible()) caret->Hide();
+  // the user is done typing here
+  typed_value.clear();
+  SetP set = editor().getSetForActions();
+  if (set) set->updateDelayedTyping(0);
   // hide selection
   //selection_start   = selection_end   = 0;
   //selection_start_i = selection_end_i = 0;
@@ -647,6 +663,11 @@ void TextValueEditor::draw(RotatedDC& dc) {
   if (nativeLook()) {
     dc.DestroyClippingRegion();
   }
+  // the result of typing is visible now
+  if (edit_time != 0) {
+    typing_latency.add((wxGetUTCTimeUSec() - edit_time).ToDouble() / 1000);
+    edit_time = 0;
+  }
 }
 
 void TextValueEditor::redrawSelection(size_t old_selection_start_i, size_t old_selection_end_i, bool old_drop_down_shown) {
@@ -750,6 +771,14 @@ void TextValueEditor::onAction(const Action& action, bool undone) {
     selection_end   = action.selection_end;
     fixSelection(TYPE_CURSOR);
   }
+  TYPE_CASE_(action, ScriptValueEvent) {
+    // a delayed script changed our value, find the cursor again
+    if (!typed_value.empty() && selection_start == selection_end) {
+      selection_end = selection_start = best_cursor_position(selection_end, typed_value, untag_for_cursor(value().value()));
+      fixSelection(TYPE_CURSOR, MOVE_RIGHT);
+    }
+    typed_value.clear();
+  }
 }
 
 // ----------------------------------------------------------------------------- : Clipboard
@@ -964,11 +993,51 @@ size_t match_cursor_position(size_t pos1, const String& text1, size_t pos2, cons
   return score;
 }
 
+/// Find the cursor position in real_value that best matches expected_cursor in expected_value
+/** Used when scripts change the text around the cursor */
+size_t best_cursor_position(size_t expected_cursor, const String& expected_value, const String& real_value) {
+  // where real and expected value are the same, nothing has happend, so don't look there
+  size_t start, end_min;
+  for (start = 0 ; start < min(real_value.size(), expected_value.size()) ; ++start) {
+    if (real_value.GetChar(start) != expected_value.GetChar(start)) break;
+  }
+  for (end_min = 0 ; end_min < min(real_value.size(), expected_value.size()) ; ++end_min) {
+    if (real_value.GetChar(real_value.size() - end_min - 1) !=
+      expected_value.GetChar(expected_value.size() - end_min - 1)) break;
+  }
+  // what is the best cursor position?
+  size_t best_cursor = expected_cursor;
+  if (real_value.size() < expected_value.size()
+    && expected_cursor < expected_value.size()
+    && start < real_value.size()
+    && expected_value.GetChar(expected_cursor) == UNTAG_SEP
+    && real_value.GetChar(start)               == UNTAG_SEP
+    && real_value.size() - end_min == start) {
+    // exception for type-over separators
+    best_cursor = start + 1;
+  } else {
+    // try to find the best match to what text we expected to be around the cursor
+    size_t best_match  = 0;
+    size_t begin = min(start, expected_cursor);
+    size_t end   = min(real_value.size() + 1, max(real_value.size() - end_min, expected_cursor) + 1);
+    for (size_t i = begin ; i < end ; ++i) {
+      size_t match = match_cursor_position(expected_cursor, expected_value, i, real_value);
+      if (match > best_match || (match == best_match && abs((int)expected_cursor - (int)i) < abs((int)expected_cursor - (int)best_cursor))) {
+        best_match = match;
+        best_cursor = i;
+      }
+    }
+  }
+  return best_cursor;
+}
+
 void TextValueEditor::replaceSelection(const String& replacement, const String& name, bool allow_auto_replace, bool select_on_undo) {
   if (replacement.empty() && selection_start == selection_end) {
     // no text selected, nothing to delete
     return;
   }
+  if (edit_time == 0) edit_time = wxGetUTCTimeUSec();
+  typed_value.clear();
   // fix the selection, it may be changed by undo/redo
   if (selection_end < selection_start) swap(selection_end, selection_start);
   fixSelection();
@@ -980,6 +1049,9 @@ void TextValueEditor::replaceSelection(const String& replacement, const String&
     moveSelection(TYPE_CURSOR, selection_end);
     return;
   }
+  // scripts that depend on this value can be updated when the user stops typing
+  bool delay = settings.typing_script_delay > 0;
+  action->delay_dependents = delay;
   // what we would expect if no scripts take place
   String expected_value  = untag_for_cursor(action->newValue());
   size_t expected_cursor = min(selection_start, selection_end) + untag_for_cursor(replacement).size();
@@ -987,43 +1059,10 @@ void TextValueEditor::replaceSelection(const String& replacement, const String&
   // NOTE: this calls our onAction, invalidating the text viewer and moving the selection around the new text
   addAction(std::move(action));
   // move cursor
-  {
-    String real_value = untag_for_cursor(value().value());
-    // where real and expected value are the same, nothing has happend, so don't look there
-    size_t start, end_min;
-    for (start = 0 ; start < min(real_value.size(), expected_value.size()) ; ++start) {
-      if (real_value.GetChar(start) != expected_value.GetChar(start)) break;
-    }
-    for (end_min = 0 ; end_min < min(real_value.size(), expected_value.size()) ; ++end_min) {
-      if (real_value.GetChar(real_value.size() - end_min - 1) !=
-        expected_value.GetChar(expected_value.size() - end_min - 1)) break;
-    }
-    // what is the best cursor position?
-    size_t best_cursor = expected_cursor;
-    if (real_value.size() < expected_value.size()
-      && expected_cursor < expected_value.size()
-      && start < real_value.size()
-      && expected_value.GetChar(expected_cursor) == UNTAG_SEP
-      && real_value.GetChar(start)               == UNTAG_SEP
-      && real_value.size() - end_min == start) {
-      // exception for type-over separators
-      best_cursor = start + 1;
-    } else {
-      // try to find the best match to what text we expected to be around the cursor
-      size_t best_match  = 0;
-      size_t begin = min(start, expected_cursor);
-      size_t end   = min(real_value.size() + 1, max(real_value.size() - end_min, expected_cursor) + 1);
-      for (size_t i = begin ; i < end ; ++i) {
-        size_t match = match_cursor_position(expected_cursor, expected_value, i, real_value);
-        if (match > best_match || (match == best_match && abs((int)expected_cursor - (int)i) < abs((int)expected_cursor - (int)best_cursor))) {
-          best_match = match;
-          best_cursor = i;
-        }
-      }
-    }
-    selection_end = selection_start = best_cursor;
-    fixSelection(TYPE_CURSOR, MOVE_RIGHT);
-  }
+  selection_end = selection_start = best_cursor_position(expected_cursor, expected_value, untag_for_cursor(value().value()));
+  fixSelection(TYPE_CURSOR, MOVE_RIGHT);
+  // scripts that depend on this value may change it later, then we need the cursor again
+  if (delay) typed_value = untag_for_cursor(value().value());
   // auto replace after typing?
   if (allow_auto_replace) tryAutoReplace();
   // scroll with next update
@@ -1034,20 +1073,29 @@ void TextValueEditor::tryAutoReplace() {
   size_t end = selection_start_i;
   GameSettings& gs = settings.gameSettingsFor(parent.getGame());
   if (!gs.use_auto_replace) return;
-  FOR_EACH(ar, gs.auto_replaces) {
-    if (ar->enabled && ar->match.size() <= end) {
-      size_t start = end - ar->match.size();
-      if (is_substr(value().value(), start, ar->match) &&
-          (!ar->whole_word || (isWordBoundary(start) && isWordBoundary(end)))
-         ) {
-        // replace
-        selection_start_i = start;
-        selection_end_i   = end;
-        fixSelection(TYPE_INDEX);
-        replaceSelection(ar->replace, _ACTION_("auto replace"), false, false);
-        end = selection_start_i;
-      }
+  // Entries are tried in order, each against the text before the cursor as left by earlier replacements.
+  // The index gives the entries that match there, only their whole word rules still have to be checked.
+  const AutoReplaceIndex& index = gs.autoReplaceIndex();
+  vector<size_t> matches;
+  size_t next = 0; // first entry that has not been tried yet
+  while (true) {
+    index.find(value().value(), end, matches);
+    auto it = matches.begin();
+    for ( ; it != matches.end() ; ++it) {
+      if (*it < next) continue;
+      const AutoReplace& ar = *gs.auto_replaces[*it];
+      size_t start = end - ar.match.size();
+      if (!ar.whole_word || (isWordBoundary(start) && isWordBoundary(end))) break;
     }
+    if (it == matches.end()) break;
+    // replace
+    const AutoReplace& ar = *gs.auto_replaces[*it];
+    selection_start_i = end - ar.match.size();
+    selection_end_i   = end;
+    fixSelection(TYPE_INDEX);
+    replaceSelection(ar.replace, _ACTION_("auto replace"), false, false);
+    end  = selection_start_i;
+    next = *it + 1;
   }
 }
 
@@ -17,6 +17,20 @@ class TextValueEditorScrollBar;
 DECLARE_POINTER_TYPE(WordListPos);
 DECLARE_SHARED_POINTER_TYPE(DropDownWordList);
 
+// ----------------------------------------------------------------------------- : Typing latency
+
+/// Time between editing text and drawing the result, for profiling
+struct TypingLatency {
+  size_t count;
+  double total_ms, max_ms;
+  
+  void add(double ms);
+  inline double average() const { return count ? total_ms / count : 0; }
+};
+
+/// Latency of all text editors
+extern TypingLatency typing_latency;
+
 // ----------------------------------------------------------------------------- : TextValueEditor
 
 enum IndexType
@@ -105,6 +119,8 @@ private:
   TextValueEditorScrollBar* scrollbar;       ///< Scrollbar for multiline fields in native look
   bool scroll_with_cursor;                   ///< When the cursor moves, should the scrollposition change?
   vector<WordListPosP> word_lists;           ///< Word lists in the text
+  String typed_value;                        ///< Untagged value after typing, while scripts depending on it are delayed
+  wxLongLong edit_time;                      ///< Time at which an edit started that hasn't been drawn yet, in microseconds
   
   // --------------------------------------------------- : Selection / movement
   
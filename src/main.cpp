@@ -9,14 +9,19 @@
 #include <util/prec.hpp>
 #include <util/io/package_manager.hpp>
 #include <util/spell_checker.hpp>
+#include <util/parallel.hpp>
 #include <data/game.hpp>
 #include <data/set.hpp>
 #include <data/settings.hpp>
 #include <data/locale.hpp>
+#include <data/symbol_font.hpp>
 #include <data/installer.hpp>
 #include <data/format/formats.hpp>
+#include <gfx/generated_image.hpp>
+#include <render/symbol/filter.hpp>
 #include <cli/cli_main.hpp>
 #include <cli/text_io_handler.hpp>
+#include <cli/self_test.hpp>
 #include <gui/welcome_window.hpp>
 #include <gui/onboarding_window.hpp>
 #include <gui/update_checker.hpp>
@@ -24,6 +29,8 @@
 #include <gui/set/window.hpp>
 #include <gui/symbol/window.hpp>
 #include <gui/thumbnail_thread.hpp>
+#include <gui/value/text.hpp>
+#include <gui/thumbnail_cache.hpp>
 #include <wx/fs_inet.h>
 #include <wx/wfstream.h>
 #include <wx/txtstrm.h>
@@ -83,6 +90,7 @@ int MSE::OnRun() {
   try {
     SetAppName(_("MSE3"));
     wxInitAllImageHandlers();
+    init_qoi_image_handler();
     wxFileSystem::AddHandler(new wxInternetFSHandler); // needed for update checker
     wxSocketBase::Initialize();
     init_script_variables();
@@ -192,9 +200,12 @@ int MSE::OnRun() {
           cli << _("\n\n  ") << BRIGHT << _("--export") << NORMAL << PARAM << _(" TEMPLATE SETFILE ") << NORMAL << _(" [") << PARAM << _("OUTFILE") << NORMAL << _("]");
           cli << _("\n         \tExport a set using an export template.");
           cli << _("\n         \tIf no output filename is specified, the result is written to stdout.");
-          cli << _("\n\n  ") << BRIGHT << _("--export-images") << NORMAL << PARAM << _(" FILE") << NORMAL << _(" [") << PARAM << _("IMAGE") << NORMAL << _("]");
+          cli << _("\n\n  ") << BRIGHT << _("--export-images") << NORMAL << PARAM << _(" FILE") << NORMAL << _(" [") << PARAM << _("IMAGE") << NORMAL << _("] [")
+                             << BRIGHT << _("-j") << NORMAL << PARAM << _(" N") << NORMAL << _("]");
           cli << _("\n         \tExport the cards in a set to image files,");
           cli << _("\n         \tIMAGE is the same format as for 'export all card images'.");
+          cli << _("\n         \tThe file type is determined by the extension of IMAGE: png, jpg, bmp, tif or qoi.");
+          cli << _("\n         \tUse ") << BRIGHT << _("-j") << NORMAL << _(" or ") << BRIGHT << _("--jobs") << NORMAL << _(" to set the number of threads writing the image files, 0 for one per processor.");
           cli << _("\n\n  ") << BRIGHT << _("--cli") << NORMAL << _(" [")
                              << PARAM << _("FILE") << NORMAL << _("] [")
                              << BRIGHT << _("--quiet") << NORMAL << _("] [")
@@ -202,6 +213,10 @@ int MSE::OnRun() {
           cli << _("\n         \tStart the command line interface for performing commands on the set file.");
           cli << _("\n         \tUse ") << BRIGHT << _("-q") << NORMAL << _(" or ") << BRIGHT << _("--quiet") << NORMAL << _(" to supress the startup banner and prompts.");
           cli << _("\n         \tUse ") << BRIGHT << _("-raw") << NORMAL << _(" for raw output mode.");
+          cli << _("\n\n  ") << BRIGHT << _("--self-test") << NORMAL << _(" [") << PARAM << _("TEST") << NORMAL << _(" ...]");
+          cli << _("\n         \tCheck optimized image code against the straightforward implementations.");
+          cli << _("\n\n  ") << BRIGHT << _("--benchmark") << NORMAL << _(" [") << PARAM << _("NAME") << NORMAL << _(" [") << PARAM << _("ARGS") << NORMAL << _("]]");
+          cli << _("\n         \tRun a benchmark, without a name the benchmarks are listed.");
           cli << _("\n\nRaw output mode is intended for use by other programs:");
           cli << _("\n    - The only output is only in response to commands.");
           cli << _("\n    - For each command a single 'record' is written to the standard output.");
@@ -242,10 +257,20 @@ int MSE::OnRun() {
             return EXIT_FAILURE;
           }
           SetP set = import_set(args[1]);
+          // options
+          String out;
+          int jobs = settings.images_export_jobs;
+          for (size_t i = 2 ; i < args.size() ; ++i) {
+            if (args[i] == _("-j") || args[i] == _("--jobs")) {
+              if (i + 1 < args.size()) jobs = wxAtoi(args[++i]);
+            } else if (starts_with(args[i], _("-j"))) {
+              jobs = wxAtoi(args[i].substr(2));
+            } else if (!starts_with(args[i], _("--")) && out.empty()) {
+              out = args[i];
+            }
+          }
+          if (out.empty()) out = settings.gameSettingsFor(*set->game).images_export_filename;
           // path
-          String out = args.size() >= 3 && !starts_with(args[2], _("--"))
-            ? args[2]
-            : settings.gameSettingsFor(*set->game).images_export_filename;
           String path = _(".");
           size_t pos = out.find_last_of(_("/\\"));
           if (pos != String::npos) {
@@ -255,8 +280,14 @@ int MSE::OnRun() {
             out = out.substr(pos + 1);
           }
           // export
-          export_images(set, set->cards, path, out, CONFLICT_NUMBER_OVERWRITE);
+          export_images(set, set->cards, path, out, CONFLICT_NUMBER_OVERWRITE, jobs);
           return EXIT_SUCCESS;
+        } else if (arg == _("--self-test")) {
+          bool ok = run_self_tests(vector<String>(args.begin() + 1, args.end()));
+          return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (arg == _("--benchmark")) {
+          bool ok = run_benchmark(vector<String>(args.begin() + 1, args.end()));
+          return ok ? EXIT_SUCCESS : EXIT_FAILURE;
         } else if (args[0] == _("--export")) {
           if (args.size() < 2) {
             throw Error(_("No export template specified for --export"));
@@ -294,10 +325,36 @@ int MSE::runGUI() {
 
 // ----------------------------------------------------------------------------- : Exit
 
+/// Write how the caches, the background thumbnail generation and typing performed to the debug log
+void log_stats() {
+  GeneratedImageCache::Stats g = generated_image_cache.stats();
+  wxLogDebug(_("Generated images: %d hits, %d misses, %d entries using %d KB"),
+             (int)g.hits, (int)g.misses, (int)g.entries, (int)(g.bytes >> 10));
+  SymbolRenderCache::Stats r = symbol_render_cache.stats();
+  wxLogDebug(_("Rendered symbols: %d hits, %d misses, %d entries using %d KB"),
+             (int)r.hits, (int)r.misses, (int)r.entries, (int)(r.bytes >> 10));
+  ThumbnailThread::Stats t = thumbnail_thread.stats();
+  wxLogDebug(_("Thumbnails: %d requests, %d from the image cache, %d generated, %d aborted, %d workers"),
+             (int)t.requests, (int)t.disk_hits, (int)t.generated, (int)t.aborted, (int)t.max_workers);
+  wxLogDebug(_("Thumbnail queue latency: %.1f ms average, %.1f ms max"), t.averageLatency(), t.max_latency);
+  ThumbnailCache::Stats c = thumbnail_cache.stats();
+  wxLogDebug(_("Thumbnail cache: %d hits, %d misses, %d entries, %d of %d KB used, %d old files moved"),
+             (int)c.hits, (int)c.misses, (int)c.entries, (int)(c.live_bytes >> 10), (int)(c.file_bytes >> 10), (int)c.migrated);
+  if (typing_latency.count) {
+    wxLogDebug(_("Typing latency: %d edits, %.1f ms average, %.1f ms max"),
+               (int)typing_latency.count, typing_latency.average(), typing_latency.max_ms);
+  }
+}
+
 int MSE::OnExit() {
+  log_stats();
   thumbnail_thread.abortAll();
+  thumbnail_cache.close();
   settings.write();
   package_manager.destroy();
+  generated_image_cache.clear();
+  glyph_atlas.clear();
+  stop_parallel_threads();
   SpellChecker::destroyAll();
   return 0;
 }
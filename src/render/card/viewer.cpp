@@ -31,6 +31,7 @@ void DataViewer::draw(DC& dc) {
   StyleSheetSettings& ss = settings.stylesheetSettingsFor(*stylesheet);
   RotatedDC rdc(dc, getRotation(),
                 nativeLook() ? QUALITY_LOW : (ss.card_anti_alias() ? QUALITY_AA : QUALITY_SUB_PIXEL));
+  rdc.useCompositingSurface(useCompositingSurface());
   draw(rdc, stylesheet->card_background);
 }
 void DataViewer::draw(RotatedDC& dc, const Color& background) {
@@ -38,6 +39,29 @@ void DataViewer::draw(RotatedDC& dc, const Color& background) {
   WITH_DYNAMIC_ARG(drawing_card, true);
   // fill with background color
   clearDC(dc.getDC(), background);
+  prepareViewers(dc);
+  // draw viewers
+  FOR_EACH(v, viewers) { // draw low z index fields first
+    if (v->isVisible()) {// visible
+      Rotater r(dc, v->getRotation());
+      try {
+        drawViewer(dc, *v);
+      } catch (const Error& e) {
+        handle_error(e);
+      }
+    }
+  }
+}
+void DataViewer::prepare(DC& dc) {
+  if (!set) return;
+  Rotation rotation = getRotation();
+  StyleSheetSettings& ss = settings.stylesheetSettingsFor(*stylesheet);
+  RotatedDC rdc(dc, rotation,
+                nativeLook() ? QUALITY_LOW : (ss.card_anti_alias() ? QUALITY_AA : QUALITY_SUB_PIXEL));
+  WITH_DYNAMIC_ARG(drawing_card, true);
+  prepareViewers(rdc);
+}
+void DataViewer::prepareViewers(RotatedDC& dc) {
   // update style scripts
   updateStyles(false);
   // prepare viewers
@@ -57,17 +81,6 @@ void DataViewer::draw(RotatedDC& dc, const Color& background) {
   if (changed_content_properties) {
     updateStyles(true);
   }
-  // draw viewers
-  FOR_EACH(v, viewers) { // draw low z index fields first
-    if (v->isVisible()) {// visible
-      Rotater r(dc, v->getRotation());
-      try {
-        drawViewer(dc, *v);
-      } catch (const Error& e) {
-        handle_error(e);
-      }
-    }
-  }
 }
 void DataViewer::drawViewer(RotatedDC& dc, ValueViewer& v) {
   v.draw(dc);
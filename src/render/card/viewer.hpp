@@ -33,8 +33,13 @@ public:
   virtual void draw(DC& dc);
   /// Draw the current (card/data) to the given dc
   virtual void draw(RotatedDC& dc, const Color& background);
+  /// Update the styles and prepare the viewers as draw() would, without drawing anything
+  void prepare(DC& dc);
   /// Draw a single viewer
   virtual void drawViewer(RotatedDC& dc, ValueViewer& v);
+  /// Can images with combine modes be composited in memory? See RotatedDC::useCompositingSurface
+  /** false by default, should only be true if nothing else draws on the dc while drawing */
+  virtual bool useCompositingSurface() const { return false; }
   
   // --------------------------------------------------- : Utility for ValueViewers
   
@@ -97,6 +102,9 @@ protected:
   /// Notification that the size of the viewer may have changed
   virtual void onChangeSize() {}
   
+  /// Update the styles and prepare the visible viewers
+  void prepareViewers(RotatedDC& dc);
+  
   vector<ValueViewerP> viewers; ///< The viewers for the different values in the data
   CardP card; ///< The card that is currently displayed, if any
   mutable StyleSheetP stylesheet; ///< Stylesheet being used
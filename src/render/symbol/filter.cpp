@@ -11,10 +11,11 @@
 #include <render/symbol/viewer.hpp>
 #include <gfx/gfx.hpp>
 #include <util/error.hpp>
+#include <util/hash.hpp>
 
 // ----------------------------------------------------------------------------- : Symbol filtering
 
-void filter_symbol(Image& symbol, const SymbolFilter& filter) {
+void filter_symbol(Image& symbol, const SymbolFilter& filter, bool blend_edges) {
   Byte* data  = symbol.GetData();
   Byte* alpha = symbol.GetAlpha();
   UInt width = symbol.GetWidth(), height = symbol.GetHeight();
@@ -31,6 +32,28 @@ void filter_symbol(Image& symbol, const SymbolFilter& filter) {
       //  green+red=white -> border
       if (data[0] != data[2]) {
         // yellow/blue = editing hint, leave alone
+      } else if (blend_edges && !(data[0] == 0 && (data[1] == 0 || data[1] == 128)) && !(data[0] == 255 && data[1] == 255)) {
+        // partially covered: the color is a mix of green (0,128,0), white and black
+        double x_ = (double)x / width, y_ = (double)y / height;
+        double border  = data[0] / 255.;
+        double outside = min(1 - border, max(0, data[1] - data[0]) / 128.);
+        double inside  = 1 - border - outside;
+        // mix with premultiplied alpha
+        double r = 0, g = 0, b = 0, a = 0;
+        SymbolSet sets[]    = {SYMBOL_BORDER, SYMBOL_OUTSIDE, SYMBOL_INSIDE};
+        double    weights[] = {border, outside, inside};
+        for (int i = 0 ; i < 3 ; ++i) {
+          if (weights[i] <= 0) continue;
+          Color c = filter.color(x_, y_, sets[i]);
+          double wa = weights[i] * c.Alpha();
+          r += wa * c.Red(); g += wa * c.Green(); b += wa * c.Blue(); a += wa;
+        }
+        if (a > 0) {
+          data[0] = (Byte)(r / a + 0.5);
+          data[1] = (Byte)(g / a + 0.5);
+          data[2] = (Byte)(b / a + 0.5);
+        }
+        alpha[0] = (Byte)(a + 0.5);
       } else {
         SymbolSet point = data[1] ? (data[0] ? SYMBOL_BORDER : SYMBOL_OUTSIDE) : SYMBOL_INSIDE;
         // Call filter
@@ -49,8 +72,11 @@ void filter_symbol(Image& symbol, const SymbolFilter& filter) {
 }
 
 Image render_symbol(const SymbolP& symbol, const SymbolFilter& filter, double border_radius, int width, int height, bool edit_hints, bool allow_smaller) {
+  if (!edit_hints) {
+    return symbol_render_cache.render(symbol, filter, border_radius, width, height, allow_smaller);
+  }
   Image i = render_symbol(symbol, border_radius, width, height, edit_hints, allow_smaller);
-  filter_symbol(i, filter);
+  filter_symbol(i, filter, !edit_hints);
   return i;
 }
 
@@ -85,6 +111,11 @@ intrusive_ptr<SymbolFilter> read_new<SymbolFilter>(Reader& reader) {
 
 // ----------------------------------------------------------------------------- : SolidFillSymbolFilter
 
+/// Hash of a color, including the alpha channel
+inline UInt color_hash(const Color& c) {
+  return c.Red() | (c.Green() << 8) | (c.Blue() << 16) | ((UInt)c.Alpha() << 24);
+}
+
 String SolidFillSymbolFilter::fillType() const { return _("solid"); }
 
 Color SolidFillSymbolFilter::color(double x, double y, SymbolSet point) const {
@@ -93,12 +124,23 @@ Color SolidFillSymbolFilter::color(double x, double y, SymbolSet point) const {
   else                             return Color(0,0,0,0);
 }
 
+SymbolFilterP SolidFillSymbolFilter::clone() const {
+  return make_intrusive<SolidFillSymbolFilter>(*this);
+}
+
 bool SolidFillSymbolFilter::operator == (const SymbolFilter& that) const {
   const SolidFillSymbolFilter* that2 = dynamic_cast<const SolidFillSymbolFilter*>(&that);
   return that2 && fill_color   == that2->fill_color
                && border_color == that2->border_color;
 }
 
+size_t SolidFillSymbolFilter::hash() const {
+  size_t h = hash_start(*this);
+  hash_combine(h, color_hash(fill_color));
+  hash_combine(h, color_hash(border_color));
+  return h;
+}
+
 IMPLEMENT_REFLECTION(SolidFillSymbolFilter) {
   REFLECT_BASE(SymbolFilter);
   REFLECT(fill_color);
@@ -121,6 +163,13 @@ bool GradientSymbolFilter::equal(const GradientSymbolFilter& that) const {
       && border_color_2 == that.border_color_2;
 }
 
+void GradientSymbolFilter::hashColors(size_t& h) const {
+  hash_combine(h, color_hash(fill_color_1));
+  hash_combine(h, color_hash(fill_color_2));
+  hash_combine(h, color_hash(border_color_1));
+  hash_combine(h, color_hash(border_color_2));
+}
+
 IMPLEMENT_REFLECTION(GradientSymbolFilter) {
   REFLECT_BASE(SymbolFilter);
   REFLECT(fill_color_1);
@@ -160,6 +209,10 @@ double LinearGradientSymbolFilter::t(double x, double y) const {
   return min(1.,max(0.,t));
 }
 
+SymbolFilterP LinearGradientSymbolFilter::clone() const {
+  return make_intrusive<LinearGradientSymbolFilter>(*this);
+}
+
 bool LinearGradientSymbolFilter::operator == (const SymbolFilter& that) const {
   const LinearGradientSymbolFilter* that2 = dynamic_cast<const LinearGradientSymbolFilter*>(&that);
   return that2 && equal(*that2)
@@ -167,6 +220,14 @@ bool LinearGradientSymbolFilter::operator == (const SymbolFilter& that) const {
                && center_y == that2->center_y && end_y == that2->end_y;
 }
 
+size_t LinearGradientSymbolFilter::hash() const {
+  size_t h = hash_start(*this);
+  hashColors(h);
+  hash_combine(h, center_x); hash_combine(h, center_y);
+  hash_combine(h, end_x);    hash_combine(h, end_y);
+  return h;
+}
+
 IMPLEMENT_REFLECTION(LinearGradientSymbolFilter) {
   REFLECT_BASE(GradientSymbolFilter);
   REFLECT(center_x); REFLECT(center_y);
@@ -185,7 +246,118 @@ double RadialGradientSymbolFilter::t(double x, double y) const {
   return sqrt( (sqr(x - 0.5) + sqr(y - 0.5)) * 2); 
 }
 
+SymbolFilterP RadialGradientSymbolFilter::clone() const {
+  return make_intrusive<RadialGradientSymbolFilter>(*this);
+}
+
 bool RadialGradientSymbolFilter::operator == (const SymbolFilter& that) const {
   const RadialGradientSymbolFilter* that2 = dynamic_cast<const RadialGradientSymbolFilter*>(&that);
   return that2 && equal(*that2);
 }
+
+size_t RadialGradientSymbolFilter::hash() const {
+  size_t h = hash_start(*this);
+  hashColors(h);
+  return h;
+}
+
+// ----------------------------------------------------------------------------- : SymbolRenderCache
+
+SymbolRenderCache symbol_render_cache;
+
+SymbolRenderCache::SymbolRenderCache(size_t max_bytes)
+  : max_bytes(max_bytes), bytes(0), hits(0), misses(0)
+{}
+
+bool SymbolRenderCache::Key::operator == (const Key& that) const {
+  return symbol_hash  == that.symbol_hash  && filter_hash   == that.filter_hash
+      && aspect_ratio == that.aspect_ratio && border_radius == that.border_radius
+      && width        == that.width        && height        == that.height
+      && allow_smaller == that.allow_smaller
+      && (symbol == that.symbol || symbol->sameContent(*that.symbol))
+      && (filter == that.filter || *filter == *that.filter);
+}
+size_t SymbolRenderCache::Key::hash() const {
+  size_t h = symbol_hash;
+  hash_combine(h, filter_hash);
+  hash_combine(h, aspect_ratio);
+  hash_combine(h, border_radius);
+  hash_combine(h, width);
+  hash_combine(h, height);
+  hash_combine(h, allow_smaller);
+  return h;
+}
+
+Image SymbolRenderCache::render(const SymbolP& symbol, const SymbolFilter& filter, double border_radius, int width, int height, bool allow_smaller) {
+  Key key = { symbol->contentHash(), filter.hash(), symbol.get(), &filter, symbol->aspectRatio(), border_radius, width, height, allow_smaller };
+  size_t h = key.hash();
+  {
+    wxMutexLocker l(lock);
+    auto range = index.equal_range(h);
+    for (auto it = range.first ; it != range.second ; ++it) {
+      if (it->second->key == key) {
+        ++hits;
+        entries.splice(entries.begin(), entries, it->second); // most recently used
+        return it->second->result.Copy();
+      }
+    }
+    ++misses;
+  }
+  // render without holding the lock
+  Image result = render_symbol(symbol, border_radius, width, height, false, allow_smaller);
+  filter_symbol(result, filter, true);
+  size_t result_bytes = (size_t)result.GetWidth() * result.GetHeight() * 4;
+  if (result_bytes > max_bytes / 4) return result; // too large to cache
+  // the entry keeps copies, the key of the request refers to objects owned by the caller
+  SymbolPartP   content     = symbol->clone();
+  SymbolFilterP filter_copy = filter.clone();
+  {
+    wxMutexLocker l(lock);
+    auto range = index.equal_range(h);
+    for (auto it = range.first ; it != range.second ; ++it) {
+      if (it->second->key == key) return result; // already added by another thread
+    }
+    Entry e = { key, content, filter_copy, symbol.get(), result.Copy(), result_bytes };
+    e.key.symbol = content.get();
+    e.key.filter = filter_copy.get();
+    entries.push_front(e);
+    index.insert(make_pair(h, entries.begin()));
+    bytes += result_bytes;
+    while (bytes > max_bytes && !entries.empty()) {
+      remove(--entries.end());
+    }
+  }
+  return result;
+}
+
+void SymbolRenderCache::remove(EntryIt it) {
+  auto range = index.equal_range(it->key.hash());
+  for (auto i = range.first ; i != range.second ; ++i) {
+    if (i->second == it) {
+      index.erase(i);
+      break;
+    }
+  }
+  bytes -= it->bytes;
+  entries.erase(it);
+}
+
+void SymbolRenderCache::forget(const Symbol& symbol) {
+  wxMutexLocker l(lock);
+  for (EntryIt it = entries.begin() ; it != entries.end() ; ) {
+    EntryIt next = it; ++next;
+    if (it->symbol == &symbol) remove(it);
+    it = next;
+  }
+}
+
+void SymbolRenderCache::clear() {
+  wxMutexLocker l(lock);
+  while (!entries.empty()) remove(entries.begin());
+}
+
+SymbolRenderCache::Stats SymbolRenderCache::stats() const {
+  wxMutexLocker l(lock);
+  Stats s = { hits, misses, entries.size(), bytes };
+  return s;
+}
@@ -11,8 +11,11 @@
 #include <util/prec.hpp>
 #include <util/reflect.hpp>
 #include <gfx/color.hpp>
+#include <list>
 
 DECLARE_POINTER_TYPE(Symbol);
+DECLARE_POINTER_TYPE(SymbolPart);
+DECLARE_POINTER_TYPE(SymbolFilter);
 class SymbolFilter;
 
 // ----------------------------------------------------------------------------- : Symbol filtering
@@ -20,8 +23,10 @@ class SymbolFilter;
 /// Filter a symbol-image.
 /** Filtering means that each pixel will be determined by the specified function.
  *  The result is stored in the symbol parameter.
+ *  If blend_edges, then pixels that are partially border/outside/inside (from anti aliasing)
+ *  get a mix of the colors, otherwise every pixel is put in a single set.
  */
-void filter_symbol(Image& symbol, const SymbolFilter& filter);
+void filter_symbol(Image& symbol, const SymbolFilter& filter, bool blend_edges = false);
 
 /// Render a Symbol to an Image and filter it
 Image render_symbol(const SymbolP& symbol, const SymbolFilter& filter, double border_radius = 0.05, int width = 100, int height = 100, bool edit_hints = false, bool allow_smaller = false);
@@ -46,6 +51,10 @@ public:
   virtual String fillType() const = 0;
   /// Comparision
   virtual bool operator == (const SymbolFilter& that) const = 0;
+  /// Hash code, filters that are equal have the same hash
+  virtual size_t hash() const = 0;
+  /// Make a copy of this filter
+  virtual SymbolFilterP clone() const = 0;
   
   DECLARE_REFLECTION_VIRTUAL();
 };
@@ -65,6 +74,8 @@ public:
   Color color(double x, double y, SymbolSet point) const override;
   String fillType() const override;
   bool operator == (const SymbolFilter& that) const override;
+  size_t hash() const override;
+  SymbolFilterP clone() const override;
 private:
   Color fill_color, border_color;
   DECLARE_REFLECTION_OVERRIDE();
@@ -84,6 +95,7 @@ protected:
   template <typename T>
   Color color(double x, double y, SymbolSet point, const T* t) const;
   bool equal(const GradientSymbolFilter& that) const;
+  void hashColors(size_t& h) const;
   
   DECLARE_REFLECTION_OVERRIDE();
 };
@@ -98,6 +110,8 @@ public:
   Color color(double x, double y, SymbolSet point) const override;
   String fillType() const override;
   bool operator == (const SymbolFilter& that) const override;
+  size_t hash() const override;
+  SymbolFilterP clone() const override;
   
   /// return time on the gradient, used by GradientSymbolFilter::color
   inline double t(double x, double y) const;
@@ -120,8 +134,76 @@ public:
   Color color(double x, double y, SymbolSet point) const override;
   String fillType() const override;
   bool operator == (const SymbolFilter& that) const override;
+  size_t hash() const override;
+  SymbolFilterP clone() const override;
   
   /// return time on the gradient, used by GradientSymbolFilter::color
   inline double t(double x, double y) const;
 };
 
+// ----------------------------------------------------------------------------- : SymbolRenderCache
+
+/// A cache of rendered and filtered symbols, shared by the card viewers, thumbnails and exports
+/** Symbols are found by their content, not by identity, so a symbol file that is loaded
+ *  again for every card is still only rendered once per filter and size.
+ *  Entries keep a copy of the symbol and the filter, to compare them when the hashes are equal.
+ *  When the images take up more than the memory budget, the least recently used ones are discarded.
+ *
+ *  The cache can be used from multiple threads. It returns copies, so the images can be modified.
+ */
+class SymbolRenderCache {
+public:
+  SymbolRenderCache(size_t max_bytes = 32 << 20);
+  
+  /// Render and filter a symbol, or get it from the cache; like render_symbol without editing hints
+  Image render(const SymbolP& symbol, const SymbolFilter& filter, double border_radius, int width, int height, bool allow_smaller);
+  
+  /// Remove the images rendered from a symbol object, call this when the symbol is modified
+  /** Images of the modified symbol would no longer be found anyway, this frees the memory sooner */
+  void forget(const Symbol& symbol);
+  /// Remove all images from the cache
+  void clear();
+  
+  /// Statistics about the use of the cache
+  struct Stats {
+    size_t hits;    ///< Number of symbols found in the cache
+    size_t misses;  ///< Number of symbols that had to be rendered
+    size_t entries; ///< Number of images currently in the cache
+    size_t bytes;   ///< Memory used by those images
+  };
+  Stats stats() const;
+  
+private:
+  struct Key {
+    size_t symbol_hash, filter_hash;
+    const SymbolPart*   symbol; ///< Symbols with the same hash are compared by content
+    const SymbolFilter* filter;
+    double aspect_ratio, border_radius;
+    int width, height;
+    bool allow_smaller;
+    bool operator == (const Key& that) const;
+    size_t hash() const;
+  };
+  struct Entry {
+    Key           key;     ///< The symbol and filter of the key point to the copies below
+    SymbolPartP   content; ///< Copy of the parts of the symbol, the symbol itself can be edited
+    SymbolFilterP filter;  ///< Copy of the filter
+    const Symbol* symbol;  ///< Only used for forget(), may no longer exist
+    Image         result;
+    size_t        bytes;
+  };
+  typedef list<Entry>::iterator EntryIt;
+  
+  mutable wxMutex lock;
+  list<Entry> entries;                      ///< Most recently used first
+  unordered_multimap<size_t,EntryIt> index; ///< Entries by hash of the key
+  size_t max_bytes;
+  size_t bytes;
+  size_t hits, misses;
+  
+  /// Remove an entry. Lock must be held.
+  void remove(EntryIt it);
+};
+
+/// The global symbol render cache
+extern SymbolRenderCache symbol_render_cache;
@@ -13,10 +13,10 @@
 
 // ----------------------------------------------------------------------------- : Simple rendering
 
-Image render_symbol(const SymbolP& symbol, double border_radius, int width, int height, bool editing_hints, bool allow_smaller) {
-  SymbolViewer viewer(symbol, editing_hints, width, border_radius);
+/// Determine the size of the image and the zoom and origin to use for rendering a symbol
+void symbol_render_size(const Symbol& symbol, double& border_radius, int& width, int& height, bool allow_smaller, double& zoom, Vector2D& origin) {
   // limit width/height ratio to aspect ratio of symbol
-  double ar  = symbol->aspectRatio();
+  double ar  = symbol.aspectRatio();
   double par = (double)width/height;
   if (par > ar && (ar > 1 || (allow_smaller && height < width))) {
     width  = int(height * ar);
@@ -24,14 +24,34 @@ Image render_symbol(const SymbolP& symbol, double border_radius, int width, int
     height = int(width / ar);
   }
   if (width > height) {
-    viewer.setZoom(width);
-    viewer.setOrigin(Vector2D(0,-(width-height) * 0.5));
-    viewer.border_radius *= (double)height / width;
+    zoom = width;
+    origin = Vector2D(0,-(width-height) * 0.5);
+    border_radius *= (double)height / width;
   } else {
-    viewer.setZoom(height);
-    viewer.setOrigin(Vector2D(-(height-width) * 0.5,0));
-    viewer.border_radius *= (double)width / height;
+    zoom = height;
+    origin = Vector2D(-(height-width) * 0.5,0);
+    border_radius *= (double)width / height;
+  }
+}
+
+Image render_symbol(const SymbolP& symbol, double border_radius, int width, int height, bool editing_hints, bool allow_smaller) {
+  if (editing_hints) {
+    return render_symbol_with_dc(symbol, border_radius, width, height, editing_hints, allow_smaller);
   }
+  double zoom;
+  Vector2D origin;
+  symbol_render_size(*symbol, border_radius, width, height, allow_smaller, zoom, origin);
+  SymbolRasterizer rasterizer(zoom, origin, border_radius * zoom);
+  return rasterizer.render(*symbol, width, height);
+}
+
+Image render_symbol_with_dc(const SymbolP& symbol, double border_radius, int width, int height, bool editing_hints, bool allow_smaller) {
+  double zoom;
+  Vector2D origin;
+  symbol_render_size(*symbol, border_radius, width, height, allow_smaller, zoom, origin);
+  SymbolViewer viewer(symbol, editing_hints, width, border_radius);
+  viewer.setZoom(zoom);
+  viewer.setOrigin(origin);
   Bitmap bmp(width, height);
   wxMemoryDC dc;
   dc.SelectObject(bmp);
@@ -65,6 +85,44 @@ void SymbolViewer::setOrigin(const Vector2D& origin) {
 
 // ----------------------------------------------------------------------------- : Drawing : Combining
 
+/// Determine the matrix and origin for copy i of the parts in a symmetry
+/** b is twice the angle of the symmetry handle, old_m and old_o are the current matrix and origin
+ */
+void symmetry_copy_transform(const SymbolSymmetry& s, int i, int copies, Radians b, const Matrix2D& old_m, const Vector2D& old_o, Matrix2D& multiply, Vector2D& origin) {
+  double a = i * 2 * M_PI / copies;
+  if (s.kind == SYMMETRY_ROTATION || i % 2 == 0) {
+    // set matrix
+    // Calling:
+    //  - p  the input point
+    //  - p' the output point
+    //  - rot our rotation matrix
+    //  - d   out origin
+    //  - o   the current origin (old_o)
+    //  - m   the current matrix (old_m)
+    // We want:
+    //   p' = ((p - d) * rot + d) * m + o
+    //      =  (p * rot - d * rot + d) * m + o
+    //      =  p * rot * m + (d - d * rot) * m + o
+    Matrix2D rot(cos(a),-sin(a), sin(a),cos(a));
+    multiply = rot * old_m;
+    origin = old_o + (s.center - s.center * rot) * old_m;
+  } else {
+    // reflection
+    //  Calling angle = b
+    // Matrix2D ref(cos(b),sin(b), sin(b),-cos(b));
+    // Matrix2D rot(cos(a),-sin(a), sin(a),cos(a));
+    // 
+    //  ref * rot
+    //    [ cos b   sin b !  [ cos a  -sin a !
+    //  = ! sin b  -cos b ]  ! sin a   cos a ]
+    //  = [ cos(a+b)  sin(a+b) !
+    //    ! sin(a+b) -cos(a+b) ]
+    Matrix2D rot(cos(a+b),sin(a+b), sin(a+b),-cos(a+b));
+    multiply = rot * old_m;
+    origin = old_o + (s.center - s.center * rot) * old_m;
+  }
+}
+
 typedef shared_ptr<wxMemoryDC> MemoryDCP;
 
 // Return a temporary DC with the same size as the parameter
@@ -160,38 +218,7 @@ void SymbolViewer::combineSymbolPart(DC& dc, const SymbolPart& part, bool& paint
         if (s->clip) {
           // todo: clip
         }
-        double a = i * 2 * M_PI / copies;
-        if (s->kind == SYMMETRY_ROTATION || i % 2 == 0) {
-          // set matrix
-          // Calling:
-          //  - p  the input point
-          //  - p' the output point
-          //  - rot our rotation matrix
-          //  - d   out origin
-          //  - o   the current origin (old_o)
-          //  - m   the current matrix (old_m)
-          // We want:
-          //   p' = ((p - d) * rot + d) * m + o
-          //      =  (p * rot - d * rot + d) * m + o
-          //      =  p * rot * m + (d - d * rot) * m + o
-          Matrix2D rot(cos(a),-sin(a), sin(a),cos(a));
-          multiply = rot * old_m;
-          origin = old_o + (s->center - s->center * rot) * old_m;
-        } else {
-          // reflection
-          //  Calling angle = b
-          // Matrix2D ref(cos(b),sin(b), sin(b),-cos(b));
-          // Matrix2D rot(cos(a),-sin(a), sin(a),cos(a));
-          // 
-          //  ref * rot
-          //    [ cos b   sin b !  [ cos a  -sin a !
-          //  = ! sin b  -cos b ]  ! sin a   cos a ]
-          //  = [ cos(a+b)  sin(a+b) !
-          //    ! sin(a+b) -cos(a+b) ]
-          Matrix2D rot(cos(a+b),sin(a+b), sin(a+b),-cos(a+b));
-          multiply = rot * old_m;
-          origin = old_o + (s->center - s->center * rot) * old_m;
-        }
+        symmetry_copy_transform(*s, i, copies, b, old_m, old_o, multiply, origin);
         // draw rotated copy
         combineSymbolPart(dc, *p, paintedSomething, buffersFilled, allow_overlap && i == copies - 1, borderDC, interiorDC);
       }
@@ -373,3 +400,136 @@ void SymbolViewer::highlightPart(DC& dc, const SymbolGroup& group, HighlightStyl
 void SymbolViewer::drawEditingHints(DC& dc) {
   // TODO?
 }
+
+// ----------------------------------------------------------------------------- : SymbolRasterizer
+
+// This mirrors the drawing code of SymbolViewer, see there for how the buffers are used
+
+SymbolRasterizer::SymbolRasterizer(double zoom, const Vector2D& origin, double border_width)
+  : border_width(border_width)
+  , multiply(zoom,0,0,zoom)
+  , origin(origin)
+{}
+
+/// Combine the temporary canvases with the main canvas
+/** Unlike the DC version this blends by coverage: a half covered border pixel on the green background
+ *  must become half white and half green, which is what filter_symbol expects, not the (gray) maximum.
+ */
+void combineBuffers(RasterCanvas& canvas, RasterCanvas* borders, RasterCanvas* interior) {
+  if (borders)  canvas.blendOver(*borders,  RGB(255));
+  if (interior) canvas.blendOver(*interior, RGB(0));
+}
+
+Image SymbolRasterizer::render(const Symbol& symbol, int width, int height) {
+  RasterCanvas canvas(width, height, RGB(0,128,0));
+  bool paintedSomething = false;
+  bool buffersFilled    = false;
+  RasterCanvasP borders, interior;
+  // Check if we can paint directly to the canvas
+  FOR_EACH_CONST(p, symbol.parts) {
+    if (SymbolShape* s = p->isSymbolShape()) {
+      if (s->combine == SYMBOL_COMBINE_INTERSECTION) {
+        paintedSomething = true;
+        break;
+      }
+    }
+  }
+  combineSymbolPart(canvas, symbol, paintedSomething, buffersFilled, true, borders, interior);
+  if (buffersFilled) {
+    combineBuffers(canvas, borders.get(), interior.get());
+  }
+  return canvas.toImage();
+}
+
+void SymbolRasterizer::combineSymbolPart(RasterCanvas& canvas, const SymbolPart& part, bool& paintedSomething, bool& buffersFilled, bool allow_overlap, RasterCanvasP& borders, RasterCanvasP& interior) {
+  if (const SymbolShape* s = part.isSymbolShape()) {
+    if (s->combine == SYMBOL_COMBINE_OVERLAP && buffersFilled && allow_overlap) {
+      // We will be overlapping some previous parts, write them to the canvas
+      combineBuffers(canvas, borders.get(), interior.get());
+      buffersFilled = false;
+      paintedSomething = true;
+      if (borders) borders->clear(RGB(0));
+      interior->clear(RGB(0));
+    }
+    if (!interior) interior = make_unique<RasterCanvas>(canvas.getWidth(), canvas.getHeight());
+    if (!paintedSomething) {
+      // No need to buffer
+      combineSymbolShape(*s, canvas, *interior, true);
+    } else {
+      if (!borders) borders = make_unique<RasterCanvas>(canvas.getWidth(), canvas.getHeight());
+      combineSymbolShape(*s, *borders, *interior, false);
+    }
+    buffersFilled = true;
+  } else if (const SymbolSymmetry* s = part.isSymbolSymmetry()) {
+    // Draw all parts, in reverse order (bottom to top), also draw rotated copies
+    Radians b = 2 * s->handle.angle();
+    Matrix2D old_m = multiply;
+    Vector2D old_o = origin;
+    int copies = s->kind == SYMMETRY_REFLECTION ? s->copies / 2 * 2 : s->copies;
+    FOR_EACH_CONST_REVERSE(p, s->parts) {
+      for (int i = copies - 1 ; i >= 0 ; --i) {
+        symmetry_copy_transform(*s, i, copies, b, old_m, old_o, multiply, origin);
+        combineSymbolPart(canvas, *p, paintedSomething, buffersFilled, allow_overlap && i == copies - 1, borders, interior);
+      }
+    }
+    multiply = old_m;
+    origin   = old_o;
+  } else if (const SymbolGroup* g = part.isSymbolGroup()) {
+    // Draw all parts, in reverse order (bottom to top)
+    FOR_EACH_CONST_REVERSE(p, g->parts) {
+      combineSymbolPart(canvas, *p, paintedSomething, buffersFilled, allow_overlap, borders, interior);
+    }
+  }
+}
+
+void SymbolRasterizer::combineSymbolShape(const SymbolShape& shape, RasterCanvas& border, RasterCanvas& interior, bool directB) {
+  switch(shape.combine) {
+    case SYMBOL_COMBINE_OVERLAP:
+    case SYMBOL_COMBINE_MERGE: {
+      drawSymbolShape(shape, &border, &interior, 255, 255, directB, false);
+      break;
+    } case SYMBOL_COMBINE_SUBTRACT: {
+      drawSymbolShape(shape, &border, &interior, 0, 0, directB, false);
+      break;
+    } case SYMBOL_COMBINE_INTERSECTION: {
+      RasterCanvas keepBorder  (border.getWidth(),   border.getHeight());
+      RasterCanvas keepInterior(interior.getWidth(), interior.getHeight());
+      drawSymbolShape(shape, &keepBorder, &keepInterior, 255, 255, false, false);
+      border  .blit(keepBorder,   wxAND);
+      interior.blit(keepInterior, wxAND);
+      break;
+    } case SYMBOL_COMBINE_DIFFERENCE: {
+      drawSymbolShape(shape, &border, &interior, 0, 255, directB, true);
+      break;
+    } case SYMBOL_COMBINE_BORDER: {
+      // draw border as interior
+      drawSymbolShape(shape, nullptr, &border, 0, 255, false, false);
+      break;
+    }
+  }
+}
+
+void SymbolRasterizer::drawSymbolShape(const SymbolShape& shape, RasterCanvas* border, RasterCanvas* interior, Byte borderCol, Byte interiorCol, bool directB, bool clear) {
+  // The logical functions used by SymbolViewer::combineSymbolShape
+  wxRasterOperationMode border_func   = shape.combine == SYMBOL_COMBINE_SUBTRACT   ? wxAND : wxCOPY;
+  wxRasterOperationMode interior_func = shape.combine == SYMBOL_COMBINE_DIFFERENCE ? wxXOR : wxCOPY;
+  // create point list
+  vector<Vector2D> points;
+  size_t size = shape.points.size();
+  for(size_t i = 0 ; i < size ; ++i) {
+    segment_subdivide(*shape.getPoint((int)i), *shape.getPoint((int)i+1), origin, multiply, points);
+  }
+  // draw border
+  if (border && border_width > 0) {
+    // white/black or, if directB white/green
+    border->fillPolygon(points, RGB(borderCol, (directB && borderCol == 0 ? 128 : borderCol), borderCol), border_func);
+    border->strokePolygon(points, border_width, RGB(255), border_func);
+    if (clear) {
+      border->fillPolygon(points, RGB(0, (directB ? 128 : 0), 0));
+    }
+  }
+  // draw interior
+  if (interior) {
+    interior->fillPolygon(points, RGB(interiorCol), interior_func);
+  }
+}
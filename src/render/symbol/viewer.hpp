@@ -12,11 +12,16 @@
 #include <util/rotation.hpp>
 #include <data/symbol.hpp>
 #include <gfx/bezier.hpp>
+#include <gfx/rasterizer.hpp>
 
 // ----------------------------------------------------------------------------- : Simple rendering
 
 /// Render a Symbol to an Image
+/** Without editing hints this does not use a DC, so it can be called from worker threads. */
 Image render_symbol(const SymbolP& symbol, double border_radius = 0.05, int width = 100, int height = 100, bool editing_hints = false, bool allow_smaller = false);
+/// Render a Symbol to an Image by drawing it on a DC with a SymbolViewer, like the symbol editor does
+/** This is what render_symbol uses for editing hints. It is not anti-aliased, and only works on the main thread. */
+Image render_symbol_with_dc(const SymbolP& symbol, double border_radius = 0.05, int width = 100, int height = 100, bool editing_hints = false, bool allow_smaller = false);
 
 // ----------------------------------------------------------------------------- : Symbol Viewer
 
@@ -96,3 +101,31 @@ private:
   void calcBezierOpt(const BezierCurve& c, const Vector2D& p0, const Vector2D& p1, double t0, double t1, wxPoint*& p_out, UInt count);
 */};
 
+// ----------------------------------------------------------------------------- : Symbol Rasterizer
+
+/// Draws a symbol on a RasterCanvas, with anti aliasing
+/** The result uses the same colors as SymbolViewer: green outside, white for the border and black inside.
+ *  Shapes are combined exactly like SymbolViewer does it, only with canvases instead of DCs.
+ *  Editing hints are not supported.
+ *
+ *  A rasterizer does not listen to the symbol and uses no GDI objects,
+ *  so symbols can be rendered in worker threads (as long as the symbol is not modified at the same time).
+ */
+class SymbolRasterizer {
+public:
+  /// Rasterizer that scales the symbol by zoom and moves it by origin, border_width is in pixels
+  SymbolRasterizer(double zoom, const Vector2D& origin, double border_width);
+  
+  /// Render a symbol to an image of the given size
+  Image render(const Symbol& symbol, int width, int height);
+  
+private:
+  typedef unique_ptr<RasterCanvas> RasterCanvasP;
+  double   border_width; ///< Width of the border pen, in pixels
+  Matrix2D multiply;     ///< Scaling/rotation of actual parts
+  Vector2D origin;       ///< Origin of parts
+  
+  void combineSymbolPart(RasterCanvas& canvas, const SymbolPart& part, bool& paintedSomething, bool& buffersFilled, bool allow_overlap, RasterCanvasP& border, RasterCanvasP& interior);
+  void combineSymbolShape(const SymbolShape& shape, RasterCanvas& border, RasterCanvas& interior, bool directB);
+  void drawSymbolShape(const SymbolShape& shape, RasterCanvas* border, RasterCanvas* interior, Byte borderCol, Byte interiorCol, bool directB, bool clear);
+};
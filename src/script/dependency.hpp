@@ -19,6 +19,8 @@ enum DependencyType
 ,  DEP_SET_FIELD      ///< dependency of a script in a "set"   field
 ,  DEP_CARD_STYLE      ///< dependency of a script in a "style" property, data gives the stylesheet
 ,  DEP_EXTRA_CARD_FIELD  ///< dependency of a script in an extra stylesheet specific card field
+,  DEP_CARD_STATS      ///< dependency of a statistics dimension on a card, index gives the dimension
+,  DEP_CARDS_STATS      ///< dependency of a statistics dimension for all cards
 ,  DEP_CARD_COPY_DEP    ///< copy the dependencies from a card field
 ,  DEP_SET_COPY_DEP    ///< copy the dependencies from a set  field
 ,  DEP_DUMMY        ///< used for other purposes, index and data can be anything
@@ -38,7 +40,9 @@ public:
   
   /// This dependency, but dependent on all cards instead of just one
   inline Dependency makeCardIndependend() const {
-    return Dependency(type == DEP_CARD_FIELD ? DEP_CARDS_FIELD : type, index, data);
+    return Dependency(type == DEP_CARD_FIELD ? DEP_CARDS_FIELD
+                    : type == DEP_CARD_STATS ? DEP_CARDS_STATS
+                    : type, index, data);
   }
   
   inline bool operator == (const Dependency& d) const {
@@ -415,12 +415,16 @@ SCRIPT_FUNCTION(write_image_file) {
   Image image;
   GeneratedImage::Options options(width, height, ei.export_template.get(), ei.set.get());
   if (card) {
-    image = conform_image(export_bitmap(ei.set, card->getValue()).ConvertToImage(), options);
+    if (!ei.card_exporter || ei.card_exporter->getSet() != ei.set) {
+      ei.card_exporter = make_shared<CardExporter>(ei.set);
+    }
+    image = conform_image(ei.card_exporter->exportBitmap(card->getValue()).ConvertToImage(), options);
   } else {
     image = input->toImage()->generateConform(options);
   }
   if (!image.Ok()) throw Error(_("Unable to generate image for file ") + file);
   // write
+  set_export_image_options(image);
   image.SaveFile(out_path);
   ei.exported_images.insert(make_pair(file, wxSize(image.GetWidth(), image.GetHeight())));
   SCRIPT_RETURN(file);
@@ -16,10 +16,12 @@
 #include <data/game.hpp>
 #include <data/card.hpp>
 #include <data/field.hpp>
+#include <data/statistics.hpp>
 #include <data/action/set.hpp>
 #include <data/action/value.hpp>
 #include <data/action/keyword.hpp>
 #include <util/error.hpp>
+#include <wx/time.h>
 
 // ----------------------------------------------------------------------------- : SetScriptContext : initialization
 
@@ -111,6 +113,15 @@ void SetScriptManager::initDependencies(Context& ctx, Game& game) {
   FOR_EACH(f, game.set_fields) {
     f->initDependencies(ctx, Dependency(DEP_SET_FIELD, f->index));
   }
+  // find dependencies of statistics dimensions
+  //  these are not updated here, but they are used to invalidate the StatsValueCache of the set
+  for (size_t i = 0 ; i < game.statistics_dimensions.size() ; ++i) {
+    try {
+      game.statistics_dimensions[i]->script.initDependencies(ctx, Dependency(DEP_CARD_STATS, i));
+    } catch (const Error& e) {
+      handle_error(e);
+    }
+  }
 }
 
 
@@ -140,6 +151,23 @@ void SetScriptManager::initDependencies(Context& ctx, StyleSheet& stylesheet) {
 // ----------------------------------------------------------------------------- : ScriptManager : updating
 
 void SetScriptManager::onAction(const Action& action, bool undone) {
+  TYPE_CASE_(action, ScriptValueEvent) {
+    return; // Don't go into an infinite loop because of our own events
+  }
+  TYPE_CASE_(action, DelayedScriptsEvent) {
+    return;
+  }
+  TYPE_CASE(action, TextValueAction) {
+    if (action.delay_dependents && action.card) {
+      // typing, only update the value itself now
+      updateValue(*action.valueP, action.card, true);
+      return;
+    }
+  }
+  // everything else should see the results of what was typed
+  if (delay & DELAY_TYPING) {
+    updateDelayedTyping();
+  }
   TYPE_CASE(action, ValueAction) {
     if (action.card) {
       updateValue(*action.valueP, action.card);
@@ -163,9 +191,6 @@ void SetScriptManager::onAction(const Action& action, bool undone) {
       updateValue(*action.valueP, CardP());
     }
   }
-  TYPE_CASE_(action, ScriptValueEvent) {
-    return; // Don't go into an infinite loop because of our own events
-  }
   TYPE_CASE(action, AddCardAction) {
     if (action.action.adding != undone) {
       // update the added cards specificly
@@ -240,20 +265,67 @@ void SetScriptManager::updateStyles(Context& ctx, const IndexMap<FieldP,StyleP>&
 }
 
 void SetScriptManager::updateDelayed() {
+  if (delay & DELAY_TYPING) {
+    updateDelayedTyping();
+  }
   if (delay & DELAY_KEYWORDS) {
     updateAllDependend(set.game->dependent_scripts_keywords);
   }
   delay = 0;
 }
 
-void SetScriptManager::updateValue(Value& value, const CardP& card) {
+long SetScriptManager::updateDelayedTyping(long idle_ms) {
+  if (!(delay & DELAY_TYPING)) return 0;
+  long waited = (wxGetUTCTimeMillis() - delayed_since).ToLong();
+  if (waited < idle_ms) return idle_ms - waited;
+  updateDelayedTyping();
+  return 0;
+}
+
+void SetScriptManager::updateDelayedTyping() {
+  delay &= ~DELAY_TYPING;
+  vector<ToUpdate> values;
+  swap(values, delayed_values);
+  #ifdef LOG_UPDATES
+    wxLogDebug(_("Delayed dependencies"));
+  #endif
+  // values that were typed in are newer than delayed_age, so they count as already updated,
+  // just like they would have if their dependencies were updated right away
+  deque<ToUpdate> to_update;
+  FOR_EACH(u, values) {
+    alsoUpdate(to_update, u.value->fieldP->dependent_scripts, u.card);
+  }
+  updateRecursive(to_update, delayed_age);
+  #ifdef LOG_UPDATES
+    wxLogDebug(_("-------------------------------\n"));
+  #endif
+  // things that show the results of scripts may need to be refreshed
+  DelayedScriptsEvent event;
+  set.actions.tellListeners(event, false);
+}
+
+void SetScriptManager::updateValue(Value& value, const CardP& card, bool delay_dependents) {
   Age starting_age; // the start of the update process
   deque<ToUpdate> to_update;
+  if (delay_dependents && !(delay & DELAY_TYPING)) {
+    delayed_age = starting_age;
+  }
   // execute script for initial changed value
   value.update(getContext(card));
   #ifdef LOG_UPDATES
     wxLogDebug(_("Start:     %s"), value.fieldP->name);
   #endif
+  if (delay_dependents) {
+    // remember to update the dependent scripts later
+    bool known = false;
+    FOR_EACH(u, delayed_values) {
+      if (u.value == &value) known = true;
+    }
+    if (!known) delayed_values.push_back(ToUpdate(&value, card));
+    delay |= DELAY_TYPING;
+    delayed_since = wxGetUTCTimeMillis();
+    return;
+  }
   // update dependent scripts
   alsoUpdate(to_update, value.fieldP->dependent_scripts, card);
   updateRecursive(to_update, starting_age);
@@ -384,6 +456,9 @@ void SetScriptManager::alsoUpdate(deque<ToUpdate>& to_update, const vector<Depen
           }
         }*/
         break;
+      } case DEP_CARD_STATS: case DEP_CARDS_STATS: {
+        // statistics are not stored in the set, the StatsValueCache handles these
+        break;
       } case DEP_CARD_COPY_DEP: {
         // propagate dependencies from another field
         FieldP f = set.game->card_fields[d.index];
@@ -63,6 +63,11 @@ public:
   
   /// Update expensive things that were previously delayed
   void updateDelayed();
+  /// Update the scripts that depend on typed text, if nothing has been typed for at least idle_ms milliseconds
+  /** Returns the number of milliseconds to wait before calling this function again,
+   *  or 0 if there is nothing (left) to update.
+   */
+  long updateDelayedTyping(long idle_ms);
   
   /// Update all fields of all cards
   /** Update all set info fields
@@ -80,7 +85,8 @@ private:
   void updateStyles(Context& ctx, const IndexMap<FieldP,StyleP>& styles, bool only_content_dependent);
   /// Updates scripts, starting at some value
   /** if the value changes any dependend values are updated as well */
-  void updateValue(Value& value, const CardP& card);
+  /** if delay_dependents, the dependent values are only updated by updateDelayed() */
+  void updateValue(Value& value, const CardP& card, bool delay_dependents = false);
   // Update all values with a specific dependency
   void updateAllDependend(const vector<Dependency>& dependent_scripts, const CardP& card = CardP());
   
@@ -102,9 +108,16 @@ private:
   enum Delay
   {  DELAY_KEYWORDS = 0x01
   ,  DELAY_CARDS    = 0x02
+  ,  DELAY_TYPING   = 0x04 ///< scripts depending on values in delayed_values
   };
   int delay;
   
+  vector<ToUpdate> delayed_values; ///< Typed in values, of which the dependent scripts have not been updated yet
+  Age              delayed_age;    ///< Age from before the first of delayed_values was updated
+  wxLongLong       delayed_since;  ///< Time at which the last of delayed_values was updated, in milliseconds
+  /// Update the scripts that depend on delayed_values
+  void updateDelayedTyping();
+  
 protected:
   /// Respond to actions by updating scripts
   void onAction(const Action&, bool undone) override;
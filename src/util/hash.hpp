@@ -0,0 +1,26 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <functional>
+#include <typeinfo>
+
+// ----------------------------------------------------------------------------- : Hashing
+
+/// Combine a hash value with the hash of x
+template <typename T>
+inline void hash_combine(size_t& seed, const T& x) {
+  seed ^= std::hash<T>()(x) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+/// Start the hash for an object of type T, so objects of different types hash differently
+template <typename T>
+inline size_t hash_start(const T&) {
+  return typeid(T).hash_code();
+}
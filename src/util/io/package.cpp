@@ -10,6 +10,7 @@
 #include <util/io/package.hpp>
 #include <util/io/package_manager.hpp>
 #include <util/error.hpp>
+#include <gfx/generated_image.hpp> // generated_image_cache
 #include <script/to_value.hpp> // for reflection
 #include <script/profiler.hpp> // for PROFILER
 #include <wx/wfstream.h>
@@ -26,6 +27,11 @@ Package::Package()
 {}
 
 Package::~Package() {
+  // cached images are keyed on the address of this package
+  // packages with static storage can outlive the cache
+  if (!GeneratedImageCache::destroyed()) {
+    generated_image_cache.forgetPackage(this);
+  }
   // remove any remaining temporary files
   FOR_EACH(f, files) {
     if (f.second.wasWritten()) {
@@ -192,6 +198,7 @@ unique_ptr<wxInputStream> Package::openIn(const String& file) {
     Packaged* p = dynamic_cast<Packaged*>(this);
     return package_manager.openFileFromPackage(p, file).first;
   }
+  wxMutexLocker lock(files_mutex);
   FileInfos::iterator it = files.find(normalize_internal_filename(file));
   if (it == files.end()) {
     // does it look like a relative filename?
@@ -227,6 +234,7 @@ unique_ptr<wxOutputStream> Package::openOut(const String& file) {
 String Package::nameOut(const String& file) {
   assert(wxThread::IsMain()); // Writing should only be done from the main thread
   String name = normalize_internal_filename(file);
+  wxMutexLocker lock(files_mutex);
   FileInfos::iterator it = files.find(name);
   if (it == files.end()) {
     // new file
@@ -249,6 +257,7 @@ LocalFileName Package::newFileName(const String& prefix, const String& suffix) {
   assert(wxThread::IsMain()); // Writing should only be done from the main thread
   String name;
   UInt infix = 0;
+  wxMutexLocker lock(files_mutex);
   while (true) {
     // create filename
     name = prefix;
@@ -217,6 +217,8 @@ public:
 private:
   /// All files in the package
   FileInfos files;
+  /// Lock for looking up and adding files, files are opened for reading from thumbnail workers
+  wxMutex files_mutex;
   /// Filestream/zipstream for reading zip files
   unique_ptr<wxZipInputStream> zipStream;
 
@@ -16,6 +16,7 @@
 #include <data/locale.hpp>
 #include <data/export_template.hpp>
 #include <data/installer.hpp>
+#include <gfx/generated_image.hpp>
 #include <wx/stdpaths.h>
 #include <wx/wfstream.h>
 
@@ -53,10 +54,13 @@ void PackageManager::reinit() {
   global.init(false);
 }
 void PackageManager::destroy() {
+  wxMutexLocker lock(mutex);
   loaded_packages.clear();
 }
 void PackageManager::reset() {
+  wxMutexLocker lock(mutex);
   loaded_packages.clear();
+  generated_image_cache.clear(); // images may refer to the unloaded packages
 }
 
 PackagedP PackageManager::openAny(const String& name_, bool just_header) {
@@ -77,6 +81,7 @@ PackagedP PackageManager::openAny(const String& name_, bool just_header) {
   }
 
   // Is this package already loaded?
+  wxMutexLocker lock(mutex);
   PackagedP& p = loaded_packages[filename];
   if (!p) {
     // load with the right type, based on extension
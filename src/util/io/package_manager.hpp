@@ -182,6 +182,7 @@ public:
   
 private:
   map<String, PackagedP> loaded_packages;
+  wxMutex mutex{wxMUTEX_RECURSIVE}; ///< Lock for loaded_packages, packages can be opened from thumbnail workers, loading a package can open its dependencies
   PackageDirectory local, global;
 };
 
@@ -0,0 +1,152 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <util/parallel.hpp>
+#include <wx/thread.h>
+#include <exception>
+#include <atomic>
+
+// ----------------------------------------------------------------------------- : ParallelPool
+
+/// A parallel_for that is being executed
+struct ParallelJob {
+  const std::function<void(int,int)>& f;
+  int n;
+  int chunks;  ///< Number of ranges
+  int next;    ///< Next range to start
+  int running; ///< Number of ranges that have been started but are not done
+  std::exception_ptr error;
+};
+
+class ParallelPoolThread;
+
+/// The threads used by parallel_for, created the first time they are needed
+/** There is at most one job at a time, parallel_for claims the pool with parallel_pool_busy.
+ *  The thread that calls parallel_for works on the job as well.
+ */
+class ParallelPool {
+public:
+  ParallelPool() : work(lock), done(lock), job(nullptr), stopping(false) {}
+  
+  /// Run a job, returns when all its ranges are done
+  void run(ParallelJob& job);
+  /// Stop all threads
+  void stop();
+  
+private:
+  friend class ParallelPoolThread;
+  wxMutex lock;
+  wxCondition work; ///< Signaled when there is a new job, or when stopping
+  wxCondition done; ///< Signaled when the last range of a job is done
+  ParallelJob* job; ///< The current job, if any
+  bool stopping;
+  vector<ParallelPoolThread*> threads;
+  
+  /// Run the next range of the job, if there is one. The lock must be held.
+  bool runNext(ParallelJob& job);
+};
+
+/// A thread of the ParallelPool
+class ParallelPoolThread : public wxThread {
+public:
+  ParallelPoolThread(ParallelPool& pool) : wxThread(wxTHREAD_JOINABLE), pool(pool) {}
+  
+  ExitCode Entry() override {
+    wxMutexLocker l(pool.lock);
+    while (!pool.stopping) {
+      if (pool.job && pool.runNext(*pool.job)) continue;
+      pool.work.Wait();
+    }
+    return 0;
+  }
+  
+private:
+  ParallelPool& pool;
+};
+
+bool ParallelPool::runNext(ParallelJob& job) {
+  if (job.next >= job.chunks) return false;
+  int i = job.next++;
+  job.running++;
+  lock.Unlock();
+  std::exception_ptr error;
+  try {
+    job.f(int((long long)job.n * i / job.chunks), int((long long)job.n * (i+1) / job.chunks));
+  } catch (...) {
+    error = std::current_exception();
+  }
+  lock.Lock();
+  if (error && !job.error) job.error = error;
+  if (--job.running == 0 && job.next >= job.chunks) {
+    done.Broadcast();
+  }
+  return true;
+}
+
+void ParallelPool::run(ParallelJob& new_job) {
+  wxMutexLocker l(lock);
+  if (threads.empty() && !stopping) {
+    // the calling thread is one of the workers
+    for (int i = 1 ; i < wxThread::GetCPUCount() ; ++i) {
+      ParallelPoolThread* thread = new ParallelPoolThread(*this);
+      if (thread->Run() != wxTHREAD_NO_ERROR) {
+        delete thread;
+        break;
+      }
+      threads.push_back(thread);
+    }
+  }
+  job = &new_job;
+  work.Broadcast();
+  while (runNext(new_job)) {}
+  while (new_job.running > 0) done.Wait();
+  job = nullptr;
+}
+
+void ParallelPool::stop() {
+  {
+    wxMutexLocker l(lock);
+    stopping = true;
+    work.Broadcast();
+  }
+  for (ParallelPoolThread* thread : threads) {
+    thread->Wait();
+    delete thread;
+  }
+  threads.clear();
+}
+
+ParallelPool parallel_pool;
+std::atomic<bool> parallel_pool_busy(false); ///< Is a parallel_for using the pool?
+
+// ----------------------------------------------------------------------------- : parallel_for
+
+void parallel_for(int n, int min_chunk, const std::function<void(int,int)>& f) {
+  if (n <= 0) return;
+  int chunks = min(max(1, wxThread::GetCPUCount()), n / max(1, min_chunk));
+  bool idle = false;
+  if (chunks <= 1 || !parallel_pool_busy.compare_exchange_strong(idle, true)) {
+    // not worth it, or the pool is used by another call (from another thread, or we are inside that call)
+    f(0, n);
+    return;
+  }
+  ParallelJob job = { f, n, chunks, 0, 0, nullptr };
+  try {
+    parallel_pool.run(job);
+  } catch (...) {
+    parallel_pool_busy = false;
+    throw;
+  }
+  parallel_pool_busy = false;
+  if (job.error) std::rethrow_exception(job.error);
+}
+
+void stop_parallel_threads() {
+  parallel_pool.stop();
+}
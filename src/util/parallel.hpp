@@ -0,0 +1,29 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+#include <functional>
+
+// ----------------------------------------------------------------------------- : parallel_for
+
+/// Call f(begin,end) for disjoint ranges that together cover [0..n), using all processors
+/** Ranges contain at least min_chunk items, so for small n everything is done on the calling thread.
+ *  f is called from multiple threads at once, so it must only touch data belonging to its range.
+ *  Returns when all ranges are done. If f throws, the exception is rethrown after that.
+ *
+ *  The work is spread over a shared set of threads, one per processor, that is created on first use.
+ *  Calls from any thread can use them, but only one call at a time. When they are busy, for instance
+ *  in nested calls or when several thumbnail or export threads run side by side,
+ *  everything is done on the calling thread.
+ */
+void parallel_for(int n, int min_chunk, const std::function<void(int begin, int end)>& f);
+
+/// Stop the threads used by parallel_for, on exit
+void stop_parallel_threads();
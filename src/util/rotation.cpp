@@ -172,14 +172,18 @@ Rotater::~Rotater() {
 
 RotatedDC::RotatedDC(DC& dc, Radians angle, const RealRect& rect, double zoom, RenderQuality quality, RotationFlags flags)
   : Rotation(angle, rect, zoom, 1.0, flags)
-  , dc(dc), quality(quality)
+  , dc(dc), quality(quality), compositing(false)
 {}
 
 RotatedDC::RotatedDC(DC& dc, const Rotation& rotation, RenderQuality quality)
   : Rotation(rotation)
-  , dc(dc), quality(quality)
+  , dc(dc), quality(quality), compositing(false)
 {}
 
+RotatedDC::~RotatedDC() {
+  flushSurface();
+}
+
 // ----------------------------------------------------------------------------- : RotatedDC : Drawing
 
 void RotatedDC::DrawText(const String& text, const RealPoint& pos, int blur_radius, int boldness, double stretch_) {
@@ -189,6 +193,7 @@ void RotatedDC::DrawText(const String& text, const RealPoint& pos, int blur_radi
 void RotatedDC::DrawText(const String& text, const RealPoint& pos, Color color, int blur_radius, int boldness, double stretch_) {
   if (text.empty()) return;
   if (color.Alpha() == 0) return;
+  invalidateSurface();
   if (quality >= QUALITY_AA) {
     RealRect r(pos, GetTextExtent(text));
     RealRect r_ext = trRectToBB(r);
@@ -225,6 +230,7 @@ void RotatedDC::DrawTextWithShadow(const String& text, const Font& font, const R
 
 void RotatedDC::DrawBitmap(const Bitmap& bitmap, const RealPoint& pos) {
   if (is_rad0(angle)) {
+    invalidateSurface();
     RealPoint p_ext = tr(pos);
     dc.DrawBitmap(bitmap, to_int(p_ext.x), to_int(p_ext.y), true);
   } else {
@@ -236,20 +242,32 @@ void RotatedDC::DrawImage(const Image& image, const RealPoint& pos, ImageCombine
   DrawPreRotatedImage(rotated, RealRect(pos,trInvS(RealSize(image))), combine);
 }
 void RotatedDC::DrawPreRotatedBitmap(const Bitmap& bitmap, const RealRect& rect) {
+  invalidateSurface();
   RealPoint p_ext = tr(rect.position()) + boundingBoxCorner(rect.size());
   dc.DrawBitmap(bitmap, to_int(p_ext.x), to_int(p_ext.y), true);
 }
 void RotatedDC::DrawPreRotatedImage (const Image& image, const RealRect& rect, ImageCombine combine) {
   RealPoint p_ext = tr(rect.position()) + boundingBoxCorner(rect.size());
-  draw_combine_image(dc, to_int(p_ext.x), to_int(p_ext.y), image, combine);
+  int x = to_int(p_ext.x), y = to_int(p_ext.y);
+  if (compositing && combine > COMBINE_NORMAL && !isClipped()) {
+    wxRect r(x, y, image.GetWidth(), image.GetHeight());
+    readSurface(r);
+    combine_image_at(surface, image, x - surface_rect.x, y - surface_rect.y, combine);
+    surface_dirty = surface_dirty.IsEmpty() ? r : surface_dirty.Union(r);
+  } else {
+    invalidateSurface();
+    draw_combine_image(dc, x, y, image, combine);
+  }
 }
 
 void RotatedDC::DrawLine  (const RealPoint& p1,  const RealPoint& p2) {
+  invalidateSurface();
   wxPoint p1_ext = tr(p1), p2_ext = tr(p2);
   dc.DrawLine(p1_ext.x, p1_ext.y, p2_ext.x, p2_ext.y);
 }
 
 void RotatedDC::DrawRectangle(const RealRect& r) {
+  invalidateSurface();
   if (is_straight(angle)) {
     wxRect r_ext = trRectToBB(r);
     dc.DrawRectangle(r_ext.x, r_ext.y, r_ext.width, r_ext.height);
@@ -263,6 +281,7 @@ void RotatedDC::DrawRectangle(const RealRect& r) {
 }
 
 void RotatedDC::DrawRoundedRectangle(const RealRect& r, double radius) {
+  invalidateSurface();
   if (is_straight(angle)) {
     wxRect r_ext = trRectToBB(r);
     dc.DrawRoundedRectangle(r_ext.x, r_ext.y, r_ext.width, r_ext.height, trS(radius));
@@ -273,21 +292,25 @@ void RotatedDC::DrawRoundedRectangle(const RealRect& r, double radius) {
 }
 
 void RotatedDC::DrawCircle(const RealPoint& center, double radius) {
+  invalidateSurface();
   wxPoint p = tr(center);
   dc.DrawCircle(p.x + 1, p.y + 1, int(trS(radius)));
 }
 
 void RotatedDC::DrawEllipse(const RealPoint& center, const RealSize& size) {
+  invalidateSurface();
   wxPoint c_ext = tr(center - size/2);
   wxSize  s_ext = trSizeToBB(size);
   dc.DrawEllipse(c_ext.x, c_ext.y, s_ext.x, s_ext.y);
 }
 void RotatedDC::DrawEllipticArc(const RealPoint& center, const RealSize& size, Radians start, Radians end) {
+  invalidateSurface();
   wxPoint c_ext = tr(center - size/2);
   wxSize  s_ext = trSizeToBB(size);
   dc.DrawEllipticArc(c_ext.x, c_ext.y, s_ext.x, s_ext.y, rad_to_deg(start + angle), rad_to_deg(end + angle));
 }
 void RotatedDC::DrawEllipticSpoke(const RealPoint& center, const RealSize& size, Radians angle) {
+  invalidateSurface();
   wxPoint c_ext = tr(center - size/2);
   wxSize  s_ext = trSizeToBB(size);
   Radians rot_angle = angle + this->angle;
@@ -307,7 +330,7 @@ void RotatedDC::DrawEllipticSpoke(const RealPoint& center, const RealSize& size,
 void RotatedDC::SetPen(const wxPen& pen)              { dc.SetPen(pen); }
 void RotatedDC::SetBrush(const wxBrush& brush)        { dc.SetBrush(brush); }
 void RotatedDC::SetTextForeground(const Color& color) { dc.SetTextForeground(color); }
-void RotatedDC::SetLogicalFunction(wxRasterOperationMode function)      { dc.SetLogicalFunction(function); }
+void RotatedDC::SetLogicalFunction(wxRasterOperationMode function)      { flushSurface(); dc.SetLogicalFunction(function); }
 
 void RotatedDC::SetFont(const wxFont& font) {
   if (quality == QUALITY_LOW && zoomX == 1 && zoomY == 1) {
@@ -366,15 +389,18 @@ double RotatedDC::GetCharHeight() const {
 }
 
 void RotatedDC::SetClippingRegion(const RealRect& rect) {
+  flushSurface();
   dc.SetDeviceClippingRegion(trRectToRegion(rect));
 }
 void RotatedDC::DestroyClippingRegion() {
+  flushSurface();
   dc.DestroyClippingRegion();
 }
 
 // ----------------------------------------------------------------------------- : Other
 
 Bitmap RotatedDC::GetBackground(const RealRect& r) {
+  flushSurface();
   wxRect wr = trRectToBB(r);
   Bitmap background(wr.width, wr.height);
   wxMemoryDC mdc;
@@ -383,3 +409,45 @@ Bitmap RotatedDC::GetBackground(const RealRect& r) {
   mdc.SelectObject(wxNullBitmap);
   return background;
 }
+
+// ----------------------------------------------------------------------------- : Compositing surface
+
+void RotatedDC::useCompositingSurface(bool use) {
+  if (!use) invalidateSurface();
+  compositing = use;
+}
+
+void RotatedDC::flushSurface() {
+  if (surface_dirty.IsEmpty()) return;
+  wxRect d = surface_dirty;
+  surface_dirty = wxRect();
+  Image changed = surface.GetSubImage(wxRect(d.x - surface_rect.x, d.y - surface_rect.y, d.width, d.height));
+  dc.DrawBitmap(Bitmap(changed), d.x, d.y);
+}
+
+void RotatedDC::invalidateSurface() {
+  flushSurface();
+  surface_rect = wxRect();
+}
+
+void RotatedDC::readSurface(const wxRect& r) {
+  if (!surface_rect.IsEmpty() && surface_rect.Contains(r)) return;
+  // the dc must be up to date before reading it back
+  flushSurface();
+  wxRect area = surface_rect.IsEmpty() ? r : surface_rect.Union(r);
+  Bitmap bitmap(area.width, area.height);
+  wxMemoryDC mdc;
+  mdc.SelectObject(bitmap);
+  mdc.Blit(0, 0, area.width, area.height, &dc, area.x, area.y);
+  mdc.SelectObject(wxNullBitmap);
+  surface = bitmap.ConvertToImage();
+  surface_rect = area;
+}
+
+bool RotatedDC::isClipped() const {
+  wxCoord x, y, w, h;
+  dc.GetClippingBox(&x, &y, &w, &h);
+  if (w == 0 && h == 0) return false; // no clipping region
+  wxSize size = dc.GetSize();
+  return x > 0 || y > 0 || w < size.x || h < size.y;
+}
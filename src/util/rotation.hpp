@@ -153,6 +153,7 @@ class RotatedDC : public Rotation {
 public:
   RotatedDC(DC& dc, Radians angle, const RealRect& rect, double zoom, RenderQuality quality, RotationFlags flags = ROTATION_NORMAL);
   RotatedDC(DC& dc, const Rotation& rotation, RenderQuality quality);
+  ~RotatedDC();
   
   // --------------------------------------------------- : Drawing
   
@@ -209,10 +210,35 @@ public:
   /// Get the current contents of the given ractangle, for later restoring
   Bitmap GetBackground(const RealRect& r);
   
-  inline wxDC& getDC() { return dc; }
+  /// Composite images with a combine mode in memory
+  /** Drawing such an image needs the pixels that are already in the dc.
+   *  Normally these are read back from the dc for every image, combined, and drawn back.
+   *  With a compositing surface a copy of the pixels is kept in memory instead,
+   *  consecutive images are combined there, and the result is drawn to the dc only once,
+   *  before anything else is drawn on the dc.
+   *  Not used when the dc has a clipping region, the surface doesn't know about clipping.
+   */
+  void useCompositingSurface(bool use);
+  
+  /// The actual dc, the caller may draw on it
+  inline wxDC& getDC() { invalidateSurface(); return dc; }
   
 private:
   wxDC& dc;        ///< The actual dc
   RenderQuality quality;  ///< Quality of the text
+  
+  bool   compositing;   ///< Use the compositing surface?
+  Image  surface;       ///< Copy of the pixels of the dc in surface_rect
+  wxRect surface_rect;  ///< Part of the dc that is in the surface, empty if the surface is not up to date
+  wxRect surface_dirty; ///< Part of the surface that is changed but not yet drawn to the dc
+  
+  /// Draw the changed part of the surface to the dc
+  void flushSurface();
+  /// Flush the surface, because the dc is about to be drawn on, after which the surface is out of date
+  void invalidateSurface();
+  /// Make sure that the surface contains the given rectangle of the dc
+  void readSurface(const wxRect& r);
+  /// Does the dc have a clipping region?
+  bool isClipped() const;
 };
 
@@ -0,0 +1,35 @@
+//+----------------------------------------------------------------------------+
+//| Description:  Magic Set Editor - Program to make Magic (tm) cards          |
+//| Copyright:    (C) Twan van Laarhoven and the other MSE developers          |
+//| License:      GNU General Public License 2 or later (see file COPYING)     |
+//+----------------------------------------------------------------------------+
+
+#pragma once
+
+// ----------------------------------------------------------------------------- : Includes
+
+#include <util/prec.hpp>
+
+// ----------------------------------------------------------------------------- : Sorted lists
+
+/// Move an item whose sort key has changed to its new position in a sorted list
+/** The item is taken out of the list if it is in there, and put back in if keep is true.
+ *  before(x,y) tells if x goes before y. It must break ties between equal keys
+ *  (for instance by position in the unsorted list) to give the same order as a stable sort.
+ *  Returns the old and the new position of the item, or -1 where it is not in the list.
+ */
+template <typename T, typename Before>
+pair<long,long> move_sorted_item(vector<T>& list, const T& item, bool keep, Before before) {
+  long old_pos = -1, new_pos = -1;
+  auto it = find(list.begin(), list.end(), item);
+  if (it != list.end()) {
+    old_pos = (long)(it - list.begin());
+    list.erase(it);
+  }
+  if (keep) {
+    it = lower_bound(list.begin(), list.end(), item, before);
+    new_pos = (long)(it - list.begin());
+    list.insert(it, item);
+  }
+  return make_pair(old_pos, new_pos);
+}
@@ -16,5 +16,11 @@ add_test(
   COMMAND magicseteditor ${test_dir}/script/script-functions.mse-script
 )
 
+# Optimized image code against the straightforward implementations
+add_test(
+  NAME self-test
+  COMMAND mse3 --self-test
+)
+
 # Rendering tests
 # TODO